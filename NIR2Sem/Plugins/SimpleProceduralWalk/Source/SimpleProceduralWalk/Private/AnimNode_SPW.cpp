@@ -7,14 +7,25 @@
 #include "Kismet/KismetSystemLibrary.h"
 #include "Curves/CurveFloat.h"
 #include "SimpleProceduralWalkInterface.h"
-#include "Async/Async.h"
+#include "Animation/AnimInstance.h"
 
 // log
 DEFINE_LOG_CATEGORY(LogSimpleProceduralWalk);
 
+// stats
+DEFINE_STAT(STAT_SimpleProceduralWalk_NumLineTraces);
+DEFINE_STAT(STAT_SimpleProceduralWalk_NumFootholdProbes);
+DEFINE_STAT(STAT_SimpleProceduralWalk_NumLegsSolved);
+DEFINE_STAT(STAT_SimpleProceduralWalk_NumIKIterations);
+DECLARE_CYCLE_STAT(TEXT("Evaluate"), STAT_SimpleProceduralWalk_Evaluate, STATGROUP_SimpleProceduralWalk);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Interface Events"), STAT_SimpleProceduralWalk_NumInterfaceEvents, STATGROUP_SimpleProceduralWalk);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Debug Primitives"), STAT_SimpleProceduralWalk_NumDebugPrimitives, STATGROUP_SimpleProceduralWalk);
+
 
 FAnimNode_SPW::FAnimNode_SPW() : Super()
 , bDebug(false)
+, bRecordFrames(false)
+, RecordedFrames(600)
 , SkeletalMeshForwardAxis(ESimpleProceduralWalk_MeshForwardAxis::Y)
 , BodyBone()
 , Legs()
@@ -41,13 +52,34 @@ FAnimNode_SPW::FAnimNode_SPW() : Super()
 , SolverType(ESimpleProceduralWalk_SolverType::ADVANCED)
 , RadiusCheckMultiplier(1.5f)
 , DistanceCheckMultiplier(1.2f)
+, FootholdProbes(8)
+, IKSolverType(ESimpleProceduralWalk_IKSolverType::CCDIK)
 , bStartFromTail()
 , Precision(1.f)
 , MaxIterations(10)
+, bAnalyticSolveLegs(false)
+, bBatchSolveLegs(false)
+, bParallelSolveLegs(false)
+, ParallelSolveMinLegs(8)
+, bWarmStartLegs(false)
+, WarmStartReuseDistance(.5f)
+, WarmStartMaxDistance(10.f)
 , TraceChannel()
 , TraceLength(350.f)
 , bTraceComplex(true)
 , TraceZOffset(50.f)
+, bAsyncTraces(false)
+, bUseFootholdCache(false)
+, bPredictiveFootPlacement(false)
+, PredictiveFootPlacementTolerance(10.f)
+, bEnableLOD(false)
+, LODReducedTraceDistance(2000.f)
+, LODReducedIKDistance(4000.f)
+, LODPhaseOnlyDistance(8000.f)
+, LODTraceRefreshInterval(4)
+, LODReducedMaxIterations(3)
+, bLODPhaseOnlyWhenNotRendered(true)
+, bEnableIdleMode(false)
 {
 #if WITH_EDITOR
 	static ConstructorHelpers::FObjectFinder<UCurveFloat> SpeedCurveObjectFinder(TEXT("/SimpleProceduralWalk/Curves/Curve_StepSpeed.Curve_StepSpeed"));
@@ -63,6 +95,11 @@ FAnimNode_SPW::FAnimNode_SPW() : Super()
 void FAnimNode_SPW::GatherDebugData(FNodeDebugData& DebugData)
 {
 	FString DebugLine = DebugData.GetNodeName(this);
+	DebugLine += FString::Printf(TEXT("(LOD: %s, Idle: %d, Scratch growths: %d, Rig shared by: %d)")
+		, *UEnum::GetDisplayValueAsText(LODTier).ToString()
+		, bIsIdle
+		, ScratchGrowthCount
+		, RigDescriptor.IsValid() ? RigDescriptor.GetSharedReferenceCount() : 0);
 
 	DebugData.AddDebugItem(DebugLine);
 	ComponentPose.GatherDebugData(DebugData);
@@ -78,51 +115,8 @@ void FAnimNode_SPW::InitializeBoneReferences(const FBoneContainer& RequiredBones
 	BodyBone.Initialize(RequiredBones);
 	UE_LOG(LogSimpleProceduralWalk, VeryVerbose, TEXT("Body bone %s initialized."), *BodyBone.BoneName.ToString());
 
-	// bones
-	ParentBones.Reset();
-	TipBones.Reset();
-	EffectorTargets.Reset();
-
-	for (FSimpleProceduralWalk_Leg Leg : Legs)
-	{
-		if (Leg.ParentBone.Initialize(RequiredBones))
-		{
-			// CCDIK exclude the parent bone from the solver, so in order to keep a simple UX in selecting the bones,
-			// we have to add the parent's parent here.
-			// NB: the fact that the parent bone is NOT root is ensured by the validation in the AnimGraphNode.
-			const FCompactPoseBoneIndex ParentParentIndex = RequiredBones.GetParentBoneIndex(Leg.ParentBone.GetCompactPoseIndex(RequiredBones));
-			FBoneReference ParentParentBone = RequiredBones.GetReferenceSkeleton().GetBoneName(ParentParentIndex.GetInt());
-
-			if (ParentParentBone.Initialize(RequiredBones))
-			{
-				ParentBones.Emplace(ParentParentBone);
-				UE_LOG(LogSimpleProceduralWalk, VeryVerbose, TEXT("%s bone's parent initialized."), *Leg.ParentBone.BoneName.ToString());
-			}
-			else
-			{
-				UE_LOG(LogSimpleProceduralWalk, Error, TEXT("Could not initialize %s bone's parent."), *Leg.ParentBone.BoneName.ToString());
-			}
-
-			// init effector target
-			FBoneSocketTarget EffectorTarget = FBoneSocketTarget(ParentParentBone.BoneName);
-			EffectorTarget.InitializeBoneReferences(RequiredBones);
-			EffectorTargets.Emplace(EffectorTarget);
-		}
-		else
-		{
-			UE_LOG(LogSimpleProceduralWalk, Error, TEXT("Could not initialize bone %s."), *Leg.ParentBone.BoneName.ToString());
-		}
-
-		if (Leg.TipBone.Initialize(RequiredBones))
-		{
-			TipBones.Emplace(Leg.TipBone);
-			UE_LOG(LogSimpleProceduralWalk, VeryVerbose, TEXT("%s bone initialized."), *Leg.TipBone.BoneName.ToString());
-		}
-		else
-		{
-			UE_LOG(LogSimpleProceduralWalk, Error, TEXT("Could not initialize bone %s."), *Leg.TipBone.BoneName.ToString());
-		}
-	}
+	// bones & chains of the legs
+	Initialize_LegChains(RequiredBones);
 }
 
 bool FAnimNode_SPW::IsValidToEvaluate(const USkeleton* Skeleton, const FBoneContainer& RequiredBones)
@@ -138,6 +132,14 @@ bool FAnimNode_SPW::IsValidToEvaluate(const USkeleton* Skeleton, const FBoneCont
 		}
 	}
 
+	if (!RigDescriptor.IsValid())
+	{
+		UE_LOG(LogSimpleProceduralWalk, Warning, TEXT("IsValidToEvaluate: bones are not initialized."));
+		return false;
+	}
+
+	const TArray<FBoneReference>& ParentBones = RigDescriptor->ParentBones;
+	const TArray<FBoneReference>& TipBones = RigDescriptor->TipBones;
 	for (int BoneIndex = 0; BoneIndex < ParentBones.Num(); BoneIndex++)
 	{
 		if (!ParentBones[BoneIndex].IsValidToEvaluate(RequiredBones))
@@ -246,6 +248,7 @@ void FAnimNode_SPW::Initialize_AnyThread(const FAnimationInitializeContext& Cont
 			Initialize_Computations();
 			UE_LOG(LogSimpleProceduralWalk, Verbose, TEXT("Initializing CCDIK."));
 			Initialize_CCDIK();
+			Initialize_Recording();
 		}
 		else
 		{
@@ -260,9 +263,18 @@ void FAnimNode_SPW::Initialize_AnyThread(const FAnimationInitializeContext& Cont
 	}
 }
 
+void FAnimNode_SPW::PreUpdate(const UAnimInstance* InAnimInstance)
+{
+	Super::PreUpdate(InAnimInstance);
+
+	CaptureGameThreadSnapshot();
+	DispatchInterfaceEvents(InAnimInstance);
+}
+
 void FAnimNode_SPW::EvaluateSkeletalControl_AnyThread(FComponentSpacePoseContext& Output, TArray<FBoneTransform>& OutBoneTransforms)
 {
 	UE_LOG(LogSimpleProceduralWalk, VeryVerbose, TEXT("Entering EvaluateSkeletalControl_AnyThread."));
+	SCOPE_CYCLE_COUNTER(STAT_SimpleProceduralWalk_Evaluate);
 
 	Super::EvaluateSkeletalControl_AnyThread(Output, OutBoneTransforms);
 
@@ -270,54 +282,96 @@ void FAnimNode_SPW::EvaluateSkeletalControl_AnyThread(FComponentSpacePoseContext
 	SkeletalMeshComponent = Output.AnimInstanceProxy->GetSkelMeshComponent();
 	WorldContext = SkeletalMeshComponent->GetWorld();
 
-	if (bIsPlaying)
+	if (bIsPlaying && GameThreadSnapshot.bIsValid)
+	{
+		// what is read from the world in this frame
+		CaptureFrameInputs(Output);
+
+		Evaluate_Frame(Output.Pose, OutBoneTransforms);
+
+		RecordFrame(OutBoneTransforms);
+	}
+	else if (bIsEditorAnimPreview)
+	{
+		EditorDebugShow(SkeletalMeshComponent->GetOwner());
+	}
+
+	FlushDebugDraw();
+}
+
+void FAnimNode_SPW::Evaluate_Frame(FCSPose<FCompactPose>& Pose, TArray<FBoneTransform>& OutBoneTransforms, FSPW_ReplayTimings* OutTimings)
+{
+	// falling events
+	if (bIsInitialized)
 	{
-		// falling events
-		if (bIsInitialized)
+		if (!FrameInputs.HasMovementBase())
 		{
-			if (!IsValid(OwnerPawn->GetMovementBase()))
+			/* -> not standing on a base -> falling */
+			if (!bIsFalling)
 			{
-				/* -> not standing on a base -> falling */
-				if (!bIsFalling)
-				{
-					/* -> triggered once after starting to fall */
-					UE_LOG(LogSimpleProceduralWalk, Warning, TEXT("Pawn started falling."));
-					// reset feet targets & locations
-					ResetFeetTargetsAndLocations();
-					// track falling state
-					bIsFalling = true;
-				}
+				/* -> triggered once after starting to fall */
+				UE_LOG(LogSimpleProceduralWalk, Warning, TEXT("Pawn started falling."));
+				// reset feet targets & locations
+				ResetFeetTargetsAndLocations();
+				// track falling state
+				bIsFalling = true;
 			}
-			else
+		}
+		else
+		{
+			/* -> not falling */
+			if (bIsFalling)
 			{
-				/* -> not falling */
-				if (bIsFalling)
-				{
-					/* -> triggered once after landing on ground */
-					UE_LOG(LogSimpleProceduralWalk, Warning, TEXT("Pawn landed."));
-					// reset falling state
-					bIsFalling = false;
-					// reset feet targets & locations
-					ResetFeetTargetsAndLocations();
-					// interface
-					CallLandedInterfaces();
-				}
+				/* -> triggered once after landing on ground */
+				UE_LOG(LogSimpleProceduralWalk, Warning, TEXT("Pawn landed."));
+				// reset falling state
+				bIsFalling = false;
+				// reset feet targets & locations
+				ResetFeetTargetsAndLocations();
+				// interface
+				CallLandedInterfaces();
 			}
 		}
+	}
+
+	// LOD
+	UpdateLODTier();
+
+	if (!bIsInitialized)
+	{
+		/* -> no output yet */
+		LegsOutputTipLocations = FrameInputs.TipBoneLocations;
+	}
 
-		// compute procedurals
+	// compute procedurals
+	{
+		FSPW_ScopeReplayCycles ScopeCycles(OutTimings != nullptr ? &OutTimings->ComputationsCycles : nullptr);
 		Evaluate_Computations();
+	}
 
+	// tips of the legs that are not solved are output as in the input pose
+	LegsOutputTipLocations = FrameInputs.TipBoneLocations;
+
+	if (LODTier != ESimpleProceduralWalk_LODTier::PHASE_ONLY)
+	{
 		// body
-		Evaluate_BodySolver(Output);
+		{
+			FSPW_ScopeReplayCycles ScopeCycles(OutTimings != nullptr ? &OutTimings->BodySolverCycles : nullptr);
+			Evaluate_BodySolver(Pose, OutBoneTransforms);
+		}
 
 		// legs
-		Evaluate_CCDIKSolver(Output);
-	}
-	else if (bIsEditorAnimPreview)
-	{
-		EditorDebugShow(SkeletalMeshComponent->GetOwner());
+		{
+			FSPW_ScopeReplayCycles ScopeCycles(OutTimings != nullptr ? &OutTimings->CCDIKSolverCycles : nullptr);
+			Evaluate_CCDIKSolver(Pose, OutBoneTransforms);
+		}
+
+		// body & legs are blended at once by the base node
+		SortBoneTransforms(OutBoneTransforms);
 	}
+
+	// scratch buffers growth (not every allocation, see SPW_AllocationTest)
+	TrackScratchGrowth();
 }
 
 void FAnimNode_SPW::UpdateInternal(const FAnimationUpdateContext& Context)
@@ -329,28 +383,133 @@ void FAnimNode_SPW::UpdateInternal(const FAnimationUpdateContext& Context)
 	WorldDeltaSeconds = Context.GetDeltaTime();
 }
 
+void FAnimNode_SPW::SortBoneTransforms(TArray<FBoneTransform>& InOutBoneTransforms)
+{
+	if (InOutBoneTransforms.Num() == 0)
+	{
+		return;
+	}
+
+	// blending requires sorted bones, and legs can share their root bone (which the solver does not move):
+	// the stable sort keeps the order they were added in (body, then legs), so the last one wins as when legs were blended one by one
+	InOutBoneTransforms.StableSort(FCompareBoneTransformIndex());
+
+	int32 NumBoneTransforms = 1;
+	for (int32 Index = 1; Index < InOutBoneTransforms.Num(); Index++)
+	{
+		if (InOutBoneTransforms[Index].BoneIndex == InOutBoneTransforms[NumBoneTransforms - 1].BoneIndex)
+		{
+			/* -> same bone, keep the last one */
+			InOutBoneTransforms[NumBoneTransforms - 1] = InOutBoneTransforms[Index];
+		}
+		else
+		{
+			InOutBoneTransforms[NumBoneTransforms++] = InOutBoneTransforms[Index];
+		}
+	}
+	InOutBoneTransforms.SetNum(NumBoneTransforms, false);
+}
+
+SIZE_T FAnimNode_SPW::GetScratchAllocatedSize() const
+{
+	SIZE_T AllocatedSize = FootHoldHits.GetAllocatedSize()
+		+ FootHoldCandidates.GetAllocatedSize()
+		+ AsyncTraceRequests.GetAllocatedSize()
+		+ GatheredLegIndices.GetAllocatedSize()
+		+ SolvedLegIndices.GetAllocatedSize()
+		+ SortedLegIndices.GetAllocatedSize()
+		+ IKChainBatch.GetAllocatedSize();
+
+	for (const TArray<FBoneTransform>& BoneTransforms : LegsBoneTransforms)
+	{
+		AllocatedSize += BoneTransforms.GetAllocatedSize();
+	}
+	for (const FSPW_IKChain& Chain : LegsChains)
+	{
+		AllocatedSize += Chain.GetAllocatedSize();
+	}
+	for (const FSimpleProceduralWalk_LegIKCacheData& CacheData : LegsIKCacheData)
+	{
+		AllocatedSize += CacheData.LinkLocalRotationDeltas.GetAllocatedSize()
+			+ CacheData.GatheredLinkLocalRotations.GetAllocatedSize()
+			+ CacheData.WarmStartLinkLocalRotations.GetAllocatedSize()
+			+ CacheData.AppliedInputTransforms.GetAllocatedSize();
+	}
+
+	return AllocatedSize;
+}
+
+void FAnimNode_SPW::TrackScratchGrowth()
+{
+	const SIZE_T AllocatedSize = GetScratchAllocatedSize();
+
+	if (AllocatedSize > ScratchAllocatedSize)
+	{
+		/* -> a scratch buffer had to grow during evaluation */
+		++ScratchGrowthCount;
+		ScratchAllocatedSize = AllocatedSize;
+		UE_LOG(LogSimpleProceduralWalk, Verbose, TEXT("Scratch buffers grew to %llu bytes (%d times)."), (uint64)AllocatedSize, ScratchGrowthCount);
+	}
+}
+
 void FAnimNode_SPW::CallLandedInterfaces()
 {
-	UE_LOG(LogSimpleProceduralWalk, Verbose, TEXT("Calling OnLanded interfaces."));
+	if (bIsReplaying)
+	{
+		// no world to notify
+		return;
+	}
+
+	UE_LOG(LogSimpleProceduralWalk, Verbose, TEXT("Queueing OnLanded event."));
+
+	InterfaceEventQueue->Enqueue(FSPW_InterfaceEvent(ESPW_InterfaceEventType::PawnLanded, INDEX_NONE, NAME_None, FrameInputs.GetActorLocation()));
+}
+
+void FAnimNode_SPW::CacheInterfaceImplementers(const UAnimInstance* InAnimInstance)
+{
+	InterfaceImplementers.Reset();
+
 	// pawn
-	if (OwnerPawn->GetClass()->ImplementsInterface(USimpleProceduralWalkInterface::StaticClass()))
+	if (IsValid(OwnerPawn) && OwnerPawn->GetClass()->ImplementsInterface(USimpleProceduralWalkInterface::StaticClass()))
 	{
-		CallLandedInterface(OwnerPawn);
+		InterfaceImplementers.Add(OwnerPawn);
 	}
 	// anim instance
-	if (SkeletalMeshComponent->GetAnimInstance()->GetClass()->ImplementsInterface(USimpleProceduralWalkInterface::StaticClass()))
+	if (IsValid(InAnimInstance) && InAnimInstance->GetClass()->ImplementsInterface(USimpleProceduralWalkInterface::StaticClass()))
+	{
+		InterfaceImplementers.Add(const_cast<UAnimInstance*>(InAnimInstance));
+	}
+
+	bAreInterfaceImplementersCached = true;
+	UE_LOG(LogSimpleProceduralWalk, Verbose, TEXT("%d interface implementers found."), InterfaceImplementers.Num());
+}
+
+void FAnimNode_SPW::DispatchInterfaceEvents(const UAnimInstance* InAnimInstance)
+{
+	if (!InterfaceEventQueue.IsValid())
+	{
+		return;
+	}
+
+	if (!bAreInterfaceImplementersCached)
 	{
-		CallLandedInterface(SkeletalMeshComponent->GetAnimInstance());
+		CacheInterfaceImplementers(InAnimInstance);
 	}
+
+	// events queued by the previous evaluation
+	int32 NumEvents = InterfaceEventQueue->Dispatch(InterfaceImplementers);
+	INC_DWORD_STAT_BY(STAT_SimpleProceduralWalk_NumInterfaceEvents, NumEvents);
 }
 
-void FAnimNode_SPW::CallLandedInterface(UObject* InterfaceOwner)
+void FAnimNode_SPW::FlushDebugDraw()
 {
-	FVector Location = OwnerPawn->GetActorLocation();
+	if (DebugDrawBuffer.Num() == 0)
+	{
+		return;
+	}
 
-	AsyncTask(ENamedThreads::GameThread, [=]() {
-		ISimpleProceduralWalkInterface::Execute_OnPawnLanded(InterfaceOwner, Location);
-	});
+	INC_DWORD_STAT_BY(STAT_SimpleProceduralWalk_NumDebugPrimitives, DebugDrawBuffer.Num());
+	DebugDrawBuffer.Flush(WorldContext);
 }
 
 #if WITH_EDITOR
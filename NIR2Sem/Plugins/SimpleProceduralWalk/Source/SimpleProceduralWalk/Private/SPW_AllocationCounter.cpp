@@ -0,0 +1,105 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#include "SPW_AllocationCounter.h"
+#include "HAL/MemoryBase.h"
+
+#if !UE_BUILD_SHIPPING
+
+namespace SPW_AllocationCounter
+{
+	// the counter of the innermost scope of this thread
+	static thread_local int32* GCounter = nullptr;
+
+	/** Forwards everything to the allocator it wraps, counting the allocations of the threads in a counter scope. */
+	class FCountingMalloc final : public FMalloc
+	{
+	public:
+		explicit FCountingMalloc(FMalloc* InInnerMalloc)
+			: InnerMalloc(InInnerMalloc)
+		{
+		}
+
+		virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+		{
+			CountAllocation();
+			return InnerMalloc->Malloc(Count, Alignment);
+		}
+
+		virtual void* TryMalloc(SIZE_T Count, uint32 Alignment) override
+		{
+			CountAllocation();
+			return InnerMalloc->TryMalloc(Count, Alignment);
+		}
+
+		virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+		{
+			if (Count > 0)
+			{
+				CountAllocation();
+			}
+			return InnerMalloc->Realloc(Original, Count, Alignment);
+		}
+
+		virtual void* TryRealloc(void* Original, SIZE_T Count, uint32 Alignment) override
+		{
+			if (Count > 0)
+			{
+				CountAllocation();
+			}
+			return InnerMalloc->TryRealloc(Original, Count, Alignment);
+		}
+
+		virtual void Free(void* Original) override { InnerMalloc->Free(Original); }
+		virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override { return InnerMalloc->QuantizeSize(Count, Alignment); }
+		virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override { return InnerMalloc->GetAllocationSize(Original, SizeOut); }
+		virtual void Trim(bool bTrimThreadCaches) override { InnerMalloc->Trim(bTrimThreadCaches); }
+		virtual void SetupTLSCachesOnCurrentThread() override { InnerMalloc->SetupTLSCachesOnCurrentThread(); }
+		virtual void ClearAndDisableTLSCachesOnCurrentThread() override { InnerMalloc->ClearAndDisableTLSCachesOnCurrentThread(); }
+		virtual void InitializeStatsMetadata() override { InnerMalloc->InitializeStatsMetadata(); }
+		virtual void UpdateStats() override { InnerMalloc->UpdateStats(); }
+		virtual void GetAllocatorStats(FGenericMemoryStats& OutStats) override { InnerMalloc->GetAllocatorStats(OutStats); }
+		virtual void DumpAllocatorStats(FOutputDevice& Ar) override { InnerMalloc->DumpAllocatorStats(Ar); }
+		virtual bool IsInternallyThreadSafe() const override { return InnerMalloc->IsInternallyThreadSafe(); }
+		virtual bool ValidateHeap() override { return InnerMalloc->ValidateHeap(); }
+		virtual const TCHAR* GetDescriptiveName() override { return InnerMalloc->GetDescriptiveName(); }
+		virtual void OnMallocInitialized() override { InnerMalloc->OnMallocInitialized(); }
+		virtual void OnPreFork() override { InnerMalloc->OnPreFork(); }
+		virtual void OnPostFork() override { InnerMalloc->OnPostFork(); }
+
+	private:
+		FMalloc* InnerMalloc;
+
+		static void CountAllocation()
+		{
+			if (GCounter != nullptr)
+			{
+				++(*GCounter);
+			}
+		}
+	};
+
+	static void InstallCountingMalloc()
+	{
+		// other threads keep calling the allocator they read, which the proxy forwards to: it is never removed
+		static FCountingMalloc* CountingMalloc = [] {
+			FCountingMalloc* Proxy = new FCountingMalloc(GMalloc);
+			GMalloc = Proxy;
+			return Proxy;
+		}();
+	}
+}
+
+FSPW_ScopeAllocationCounter::FSPW_ScopeAllocationCounter()
+{
+	SPW_AllocationCounter::InstallCountingMalloc();
+
+	PreviousCounter = SPW_AllocationCounter::GCounter;
+	SPW_AllocationCounter::GCounter = &NumAllocations;
+}
+
+FSPW_ScopeAllocationCounter::~FSPW_ScopeAllocationCounter()
+{
+	SPW_AllocationCounter::GCounter = PreviousCounter;
+}
+
+#endif
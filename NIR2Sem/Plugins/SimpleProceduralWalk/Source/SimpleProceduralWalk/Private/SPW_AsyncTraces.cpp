@@ -0,0 +1,318 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#include "SPW_AsyncTraces.h"
+#include "AnimNode_SPW.h"
+#include "Engine/World.h"
+#include "Async/Async.h"
+
+// stats
+DECLARE_DWORD_COUNTER_STAT(TEXT("Async Trace Fallbacks"), STAT_SimpleProceduralWalk_NumAsyncTraceFallbacks, STATGROUP_SimpleProceduralWalk);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Async Traces Expired"), STAT_SimpleProceduralWalk_NumAsyncTracesExpired, STATGROUP_SimpleProceduralWalk);
+
+
+// ---------- \/ pending traces ----------
+void FSPW_PendingTraces::Add(const FTraceHandle& Handle)
+{
+	if (Handles[MaxTraces - 1].IsValid())
+	{
+		RemoveUpTo(0);
+	}
+
+	for (FTraceHandle& PendingHandle : Handles)
+	{
+		if (!PendingHandle.IsValid())
+		{
+			PendingHandle = Handle;
+			return;
+		}
+	}
+}
+
+void FSPW_PendingTraces::RemoveUpTo(int32 Index)
+{
+	const int32 NumRemoved = Index + 1;
+	for (int32 HandleIndex = 0; HandleIndex < MaxTraces; HandleIndex++)
+	{
+		Handles[HandleIndex] = HandleIndex + NumRemoved < MaxTraces ? Handles[HandleIndex + NumRemoved] : FTraceHandle();
+	}
+}
+
+
+// ---------- \/ batch ----------
+void FSPW_AsyncTraceBatch::Initialize(int32 NumLegs
+	, int32 InNumProbes
+	, ECollisionChannel InTraceChannel
+	, const FCollisionQueryParams& InQueryParams)
+{
+	FScopeLock Lock(&CriticalSection);
+
+	TraceChannel = InTraceChannel;
+	QueryParams = InQueryParams;
+	NumProbes = InNumProbes;
+
+	LineTraces.Reset();
+	LineTraces.SetNum(NumLegs);
+	LineResults.Reset();
+	LineResults.SetNum(NumLegs);
+	ProbeTraces.Reset();
+	ProbeTraces.SetNum(NumLegs * NumProbes);
+	ProbeResults.Reset();
+	ProbeResults.SetNum(NumLegs * NumProbes);
+
+	// requests are swapped in and out, so both arrays keep room for a full frame
+	PendingRequests.Reset();
+	PendingRequests.Reserve(NumLegs * (1 + NumProbes));
+	bHasPendingRequests = false;
+}
+
+void FSPW_AsyncTraceBatch::QueueRequests(TArray<FSPW_AsyncTraceRequest>& InOutRequests)
+{
+	FScopeLock Lock(&CriticalSection);
+
+	// a batch that has not been submitted yet is superseded by the newer one
+	Swap(PendingRequests, InOutRequests);
+	InOutRequests.Reset();
+	bHasPendingRequests = true;
+}
+
+bool FSPW_AsyncTraceBatch::Submit(UWorld* World)
+{
+	FScopeLock Lock(&CriticalSection);
+
+	if (!bHasPendingRequests)
+	{
+		return false;
+	}
+
+	for (const FSPW_AsyncTraceRequest& Request : PendingRequests)
+	{
+		if (!LineTraces.IsValidIndex(Request.LegIndex))
+		{
+			continue;
+		}
+
+		if (Request.ProbeIndex != INDEX_NONE)
+		{
+			if (Request.ProbeIndex < NumProbes)
+			{
+				ProbeTraces[Request.LegIndex * NumProbes + Request.ProbeIndex].Add(World->AsyncLineTraceByChannel(EAsyncTraceType::Single
+					, Request.StartLocation
+					, Request.EndLocation
+					, TraceChannel
+					, QueryParams));
+			}
+		}
+		else
+		{
+			LineTraces[Request.LegIndex].Add(World->AsyncLineTraceByChannel(EAsyncTraceType::Single
+				, Request.StartLocation
+				, Request.EndLocation
+				, TraceChannel
+				, QueryParams));
+		}
+	}
+
+	PendingRequests.Reset();
+	bHasPendingRequests = false;
+
+	return true;
+}
+
+void FSPW_AsyncTraceBatch::GatherResults(UWorld* World)
+{
+	check(IsInGameThread());
+	FScopeLock Lock(&CriticalSection);
+
+	for (int32 LegIndex = 0; LegIndex < LineTraces.Num(); LegIndex++)
+	{
+		GatherResult(World, LineTraces[LegIndex], LineResults[LegIndex]);
+	}
+	for (int32 ProbeIndex = 0; ProbeIndex < ProbeTraces.Num(); ProbeIndex++)
+	{
+		GatherResult(World, ProbeTraces[ProbeIndex], ProbeResults[ProbeIndex]);
+	}
+}
+
+void FSPW_AsyncTraceBatch::GatherResult(UWorld* World, FSPW_PendingTraces& InOutTraces, FSPW_AsyncTraceResult& OutResult)
+{
+	OutResult.bIsAvailable = false;
+	OutResult.Hit.Reset(1.f, false);
+
+	// the world only keeps the results of its last frames
+	const int32 NumBufferedFrames = UE_ARRAY_COUNT(World->AsyncTraceState.DataBuffer);
+
+	for (int32 HandleIndex = FSPW_PendingTraces::MaxTraces - 1; HandleIndex >= 0; HandleIndex--)
+	{
+		const FTraceHandle& Handle = InOutTraces.Handles[HandleIndex];
+		if (!Handle.IsValid())
+		{
+			continue;
+		}
+
+		if (World->QueryTraceData(Handle, TraceDatum))
+		{
+			/* -> newest done trace, older ones are superseded */
+			const FHitResult* BlockingHit = TraceDatum.OutHits.FindByPredicate([](const FHitResult& Hit) { return Hit.bBlockingHit; });
+			OutResult.bIsAvailable = true;
+			if (BlockingHit != nullptr)
+			{
+				OutResult.Hit = *BlockingHit;
+			}
+			InOutTraces.RemoveUpTo(HandleIndex);
+			return;
+		}
+
+		if (World->AsyncTraceState.CurrentFrame - (int32)Handle._Data.FrameNumber >= NumBufferedFrames)
+		{
+			/* -> its results are gone, as are those of older ones */
+			INC_DWORD_STAT_BY(STAT_SimpleProceduralWalk_NumAsyncTracesExpired, HandleIndex + 1);
+			InOutTraces.RemoveUpTo(HandleIndex);
+			return;
+		}
+
+		/* -> not done yet, kept for the next gathering */
+	}
+}
+
+bool FSPW_AsyncTraceBatch::GetLineResult(int32 LegIndex, FHitResult& OutHit)
+{
+	FScopeLock Lock(&CriticalSection);
+
+	if (!LineResults.IsValidIndex(LegIndex) || !LineResults[LegIndex].bIsAvailable)
+	{
+		return false;
+	}
+
+	OutHit = LineResults[LegIndex].Hit;
+	return true;
+}
+
+void FSPW_AsyncTraceBatch::GetProbeHits(int32 LegIndex, TArray<FHitResult>& OutHits)
+{
+	FScopeLock Lock(&CriticalSection);
+
+	OutHits.Reset();
+	if (!LineResults.IsValidIndex(LegIndex))
+	{
+		return;
+	}
+
+	for (int32 ProbeIndex = LegIndex * NumProbes; ProbeIndex < (LegIndex + 1) * NumProbes; ProbeIndex++)
+	{
+		if (ProbeResults[ProbeIndex].bIsAvailable && ProbeResults[ProbeIndex].Hit.bBlockingHit)
+		{
+			OutHits.Add(ProbeResults[ProbeIndex].Hit);
+		}
+	}
+}
+
+// ---------- \/ node ----------
+void FAnimNode_SPW::Initialize_AsyncTraces()
+{
+	LegsAsyncTraceData.Reset();
+	LegsAsyncTraceData.SetNum(Legs.Num());
+
+	// line + foothold per leg at most
+	AsyncTraceRequests.Reset();
+	AsyncTraceRequests.Reserve(Legs.Num() * (1 + FootholdProbes));
+
+	AsyncTraceBatch = MakeShared<FSPW_AsyncTraceBatch, ESPMode::ThreadSafe>();
+	AsyncTraceBatch->Initialize(Legs.Num(), FootHoldProbeOffsets.Num(), UEngineTypes::ConvertToCollisionChannel(TraceChannel), TraceQueryParams);
+
+	UE_LOG(LogSimpleProceduralWalk, Verbose, TEXT("Async traces initialized."));
+}
+
+bool FAnimNode_SPW::GetAsyncFootTraceResult(int32 LegIndex
+	, FVector StartLocation
+	, FVector EndLocation
+	, FVector StartLocationWithoutZOffset
+	, FHitResult& OutHit
+	, bool& bOutIsUsingBasic)
+{
+	FSimpleProceduralWalk_LegAsyncTraceData& TraceData = LegsAsyncTraceData[LegIndex];
+
+	bool bIsHit = false;
+	bOutIsUsingBasic = true;
+
+	// line result (gathered by the game thread)
+	if (AsyncTraceBatch->GetLineResult(LegIndex, OutHit))
+	{
+		bIsHit = OutHit.bBlockingHit;
+	}
+	else
+	{
+		/* -> result not available (yet), fall back to last hit */
+		INC_DWORD_STAT(STAT_SimpleProceduralWalk_NumAsyncTraceFallbacks);
+		OutHit = LegsData[LegIndex].LastHit;
+		bIsHit = OutHit.bBlockingHit;
+	}
+
+	// foothold result
+	if (SolverType == ESimpleProceduralWalk_SolverType::ADVANCED)
+	{
+		float ZDistanceToLineHit = (StartLocationWithoutZOffset - OutHit.ImpactPoint).Size();
+		bool bIsTooDistant = ZDistanceToLineHit > (LegsData[LegIndex].Length * DistanceCheckMultiplier);
+
+		TraceData.bNeedsFootHoldTrace = !bIsHit || bIsTooDistant;
+
+		if (TraceData.bNeedsFootHoldTrace)
+		{
+			// hits are copied once, indexed as their candidates
+			AsyncTraceBatch->GetProbeHits(LegIndex, FootHoldHits);
+			FootHoldCandidates.Reset(StartLocationWithoutZOffset);
+			for (const FHitResult& ProbeHit : FootHoldHits)
+			{
+				FootHoldCandidates.Add(ProbeHit.ImpactPoint, ProbeHit.ImpactNormal);
+			}
+
+			if (FindFootHoldHit(StartLocationWithoutZOffset, ZDistanceToLineHit, OutHit))
+			{
+				/* -> use foothold */
+				bOutIsUsingBasic = false;
+				bIsHit = true;
+			}
+		}
+	}
+
+	// queue the traces of this frame
+	INC_DWORD_STAT(STAT_SimpleProceduralWalk_NumLineTraces);
+	FSPW_AsyncTraceRequest& LineRequest = AsyncTraceRequests.AddDefaulted_GetRef();
+	LineRequest.LegIndex = LegIndex;
+	LineRequest.StartLocation = StartLocation;
+	LineRequest.EndLocation = EndLocation;
+
+	if (TraceData.bNeedsFootHoldTrace)
+	{
+		for (int32 ProbeIndex = 0; ProbeIndex < FootHoldProbeOffsets.Num(); ProbeIndex++)
+		{
+			INC_DWORD_STAT(STAT_SimpleProceduralWalk_NumFootholdProbes);
+			FSPW_AsyncTraceRequest& ProbeRequest = AsyncTraceRequests.AddDefaulted_GetRef();
+			ProbeRequest.LegIndex = LegIndex;
+			ProbeRequest.ProbeIndex = ProbeIndex;
+			GetFootHoldProbe(ProbeIndex, StartLocation, EndLocation, ProbeRequest.StartLocation, ProbeRequest.EndLocation);
+		}
+	}
+
+	return bIsHit;
+}
+
+void FAnimNode_SPW::SubmitAsyncFootTraces()
+{
+	if (AsyncTraceRequests.Num() == 0)
+	{
+		return;
+	}
+
+	AsyncTraceBatch->QueueRequests(AsyncTraceRequests);
+
+	// a single game thread task for the whole batch
+	TSharedPtr<FSPW_AsyncTraceBatch, ESPMode::ThreadSafe> Batch = AsyncTraceBatch;
+	TWeakObjectPtr<UWorld> World = WorldContext;
+
+	AsyncTask(ENamedThreads::GameThread, [Batch, World]() {
+		if (World.IsValid())
+		{
+			Batch->Submit(World.Get());
+		}
+	});
+}
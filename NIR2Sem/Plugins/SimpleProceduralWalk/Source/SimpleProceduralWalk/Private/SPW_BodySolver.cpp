@@ -4,19 +4,24 @@
 #include "AnimationRuntime.h"
 #include "Components/SkeletalMeshComponent.h"
 #include "DrawDebugHelpers.h"
-#include "Animation/AnimInstanceProxy.h"
-#include "FABRIK.h"
 
+// stats
+DECLARE_CYCLE_STAT(TEXT("Evaluate_BodySolver"), STAT_SimpleProceduralWalk_BodySolver, STATGROUP_SimpleProceduralWalk);
 
-void FAnimNode_SPW::Evaluate_BodySolver(FComponentSpacePoseContext& Output)
+
+void FAnimNode_SPW::Evaluate_BodySolver(FCSPose<FCompactPose>& Pose, TArray<FBoneTransform>& OutBoneTransforms)
 {
+	SCOPE_CYCLE_COUNTER(STAT_SimpleProceduralWalk_BodySolver);
+
+	bIsBodyMoved = false;
+
 	if (bIsInitialized && BodyBone.BoneIndex != INDEX_NONE && !bIsFalling)
 	{
-		const FBoneContainer& BoneContainer = Output.Pose.GetPose().GetBoneContainer();
+		const FBoneContainer& BoneContainer = Pose.GetPose().GetBoneContainer();
 
 		FCompactPoseBoneIndex CompactPoseBoneToModify = BodyBone.GetCompactPoseIndex(BoneContainer);
-		FTransform NewBoneTM = Output.Pose.GetComponentSpaceTransform(CompactPoseBoneToModify);
-		FTransform ComponentTransform = Output.AnimInstanceProxy->GetComponentTransform();
+		FTransform NewBoneTM = Pose.GetComponentSpaceTransform(CompactPoseBoneToModify);
+		FTransform ComponentTransform = FrameInputs.ComponentTransform;
 
 		// \/ location
 		NewBoneTM.AddToTranslation(CurrentBodyRelLocation);
@@ -44,9 +49,11 @@ void FAnimNode_SPW::Evaluate_BodySolver(FComponentSpacePoseContext& Output)
 		const FQuat BoneQuat(BoneRotation);
 		NewBoneTM.SetRotation(BoneQuat * NewBoneTM.GetRotation());
 
-		// merge
-		TArray<FBoneTransform> TempTransforms;
-		TempTransforms.Add(FBoneTransform(BodyBone.GetCompactPoseIndex(BoneContainer), NewBoneTM));
-		Output.Pose.LocalBlendCSBoneTransforms(TempTransforms, 1.f);
+		// delta for the legs that are children of the body
+		BodyDeltaTransform = Pose.GetComponentSpaceTransform(CompactPoseBoneToModify).Inverse() * NewBoneTM;
+		bIsBodyMoved = true;
+
+		// merged with the legs by the caller
+		OutBoneTransforms.Add(FBoneTransform(CompactPoseBoneToModify, NewBoneTM));
 	}
 }
@@ -1,295 +1,499 @@
 // Copyright Epic Games, Inc. and Roberto Ostinelli, 2021. All Rights Reserved.
 
-#include "SPW_CCDIKSolver.h"
 #include "AnimNode_SPW.h"
 #include "DrawDebugHelpers.h"
-#include "Animation/AnimInstanceProxy.h"
+#include "AnimationRuntime.h"
+#include "Async/ParallelFor.h"
+
+// stats
+DECLARE_CYCLE_STAT(TEXT("Evaluate_CCDIKSolver"), STAT_SimpleProceduralWalk_CCDIKSolver, STATGROUP_SimpleProceduralWalk);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Legs Warm Started"), STAT_SimpleProceduralWalk_NumLegsWarmStarted, STATGROUP_SimpleProceduralWalk);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Legs Solved Analytically"), STAT_SimpleProceduralWalk_NumLegsSolvedAnalytically, STATGROUP_SimpleProceduralWalk);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Legs Reused"), STAT_SimpleProceduralWalk_NumLegsReused, STATGROUP_SimpleProceduralWalk);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Legs Frozen"), STAT_SimpleProceduralWalk_NumLegsFrozen, STATGROUP_SimpleProceduralWalk);
+
+// constants
+static const float FROZEN_LEG_TOLERANCE = .01f;
 
 
 void FAnimNode_SPW::Initialize_CCDIK()
 {
-	// resize
-	FeetRotationLimitsPerJoints.SetNum(Legs.Num());
+	// solver storage (chains & rotation limits are set per bone container in Initialize_LegChains)
+	LegsEffectorLocations.SetNum(Legs.Num());
+	LegsOutputTipLocations.SetNumZeroed(Legs.Num());
+	LegsSolveResults.SetNum(Legs.Num());
+	GatheredLegIndices.Reserve(Legs.Num());
+	SolvedLegIndices.Reserve(Legs.Num());
+	SortedLegIndices.Reserve(Legs.Num());
+}
+
+void FAnimNode_SPW::Initialize_LegChains(const FBoneContainer& RequiredBones)
+{
+	// the same creature shares its bones & chains
+	RigDescriptor = FSPW_RigDescriptor::FindOrCreate(Legs, LegGroups, BodyBone, RequiredBones);
+
+	LegsBoneTransforms.SetNum(Legs.Num());
+	LegsChains.SetNum(Legs.Num());
+	LegsIKCacheData.SetNum(Legs.Num());
 
 	for (int LegIndex = 0; LegIndex < Legs.Num(); LegIndex++)
 	{
-		FeetRotationLimitsPerJoints[LegIndex].RotationLimits = Legs[LegIndex].RotationLimitPerJoints;
-
-		// (the fact that this bone has root is checked during saving)
-		FeetRotationLimitsPerJoints[LegIndex].RotationLimits.Insert(0.f, 0);
+		const FSimpleProceduralWalk_LegChainData& ChainData = RigDescriptor->LegsChainData[LegIndex];
+		LegsIKCacheData[LegIndex].bIsValid = false;
+		LegsIKCacheData[LegIndex].bIsApplied = false;
+
+		// scratch
+		LegsBoneTransforms[LegIndex].Reserve(ChainData.BoneIndices.Num());
+		LegsChains[LegIndex].Reserve(ChainData.LinkTransformIndices.Num());
+		LegsIKCacheData[LegIndex].LinkLocalRotationDeltas.Reserve(ChainData.LinkTransformIndices.Num());
+		LegsIKCacheData[LegIndex].GatheredLinkLocalRotations.Reserve(ChainData.LinkTransformIndices.Num());
+		LegsIKCacheData[LegIndex].WarmStartLinkLocalRotations.Reserve(ChainData.LinkTransformIndices.Num());
+		LegsIKCacheData[LegIndex].AppliedInputTransforms.Reserve(ChainData.BoneIndices.Num());
+		IKChainBatch.SetNumLinks(FMath::Max(IKChainBatch.NumLinks, ChainData.LinkTransformIndices.Num()));
 	}
+
+	LegsChainDataSerialNumber = RequiredBones.GetSerialNumber();
+
+	// from now on scratch buffers should not grow
+	ScratchAllocatedSize = GetScratchAllocatedSize();
 }
 
-void FAnimNode_SPW::Evaluate_CCDIKSolver(FComponentSpacePoseContext& Output)
+void FAnimNode_SPW::Evaluate_CCDIKSolver(FCSPose<FCompactPose>& Pose, TArray<FBoneTransform>& OutBoneTransforms)
 {
+	SCOPE_CYCLE_COUNTER(STAT_SimpleProceduralWalk_CCDIKSolver);
+
 	if (bIsInitialized)
 	{
-		// container
-		const FBoneContainer& BoneContainer = Output.Pose.GetPose().GetBoneContainer();
+		// bone container has changed (i.e. LOD)
+		const FBoneContainer& BoneContainer = Pose.GetPose().GetBoneContainer();
+		if (!RigDescriptor.IsValid() || BoneContainer.GetSerialNumber() != LegsChainDataSerialNumber)
+		{
+			Initialize_LegChains(BoneContainer);
+		}
 
-		// partial transforms
-		TArray<FBoneTransform> TempTransforms;
+		const FSPW_IKSolveSettings Settings = CCDIK_GetSolveSettings();
 
-		for (int LegIndex = 0; LegIndex < Legs.Num(); LegIndex++)
-		{
-			TempTransforms.Reset();
+		// gather all legs first (pose reads are not thread safe)
+		GatherLegChains(Pose);
 
-			// do not perform IK if it's disabled
-			if (!LegsData[LegIndex].bEnableIK)
+		// solve
+		if (bBatchSolveLegs && IKSolverType == ESimpleProceduralWalk_IKSolverType::CCDIK)
+		{
+			SolveLegChainsBatched(Settings);
+		}
+		else if (bParallelSolveLegs && SolvedLegIndices.Num() >= ParallelSolveMinLegs)
+		{
+			SolveLegChainsParallel(Settings);
+		}
+		else
+		{
+			for (int32 LegIndex : SolvedLegIndices)
 			{
-				continue;
+				SolveLegChain(LegIndex, Settings);
 			}
+		}
 
-			// Update EffectorLocation if it is based off a bone position
-			FVector EffectorLocation(LegsData[LegIndex].FootLocation);
-			
-			FTransform CSEffectorTransform = CCDIK_GetTargetTransform(Output.AnimInstanceProxy->GetComponentTransform()
-				, Output.Pose
-				, EffectorTargets[LegIndex]
-				, EffectorLocation);
-			FVector const CSEffectorLocation = CSEffectorTransform.GetLocation();
-
-			// Gather all bone indices between root and tip.
-			TArray<FCompactPoseBoneIndex> BoneIndices;
+		// keep the solves to start from next frame
+		for (int32 LegIndex : SolvedLegIndices)
+		{
+			INC_DWORD_STAT(STAT_SimpleProceduralWalk_NumLegsSolved);
+			INC_DWORD_STAT_BY(STAT_SimpleProceduralWalk_NumIKIterations, LegsSolveResults[LegIndex].Iterations);
+			if (bWarmStartLegs)
+			{
+				CacheLegChain(LegIndex);
+			}
+		}
 
+		// apply, all legs are merged with the body by the caller
+		for (int32 LegIndex : GatheredLegIndices)
+		{
+			if (!LegsIKCacheData[LegIndex].bIsFrozen)
 			{
-				const FCompactPoseBoneIndex RootIndex = ParentBones[LegIndex].GetCompactPoseIndex(BoneContainer);
-				FCompactPoseBoneIndex BoneIndex = TipBones[LegIndex].GetCompactPoseIndex(BoneContainer);
-				do
+				ApplyLegChain(Pose, LegIndex);
+				if (bEnableIdleMode)
 				{
-					BoneIndices.Insert(BoneIndex, 0);
-					BoneIndex = Output.Pose.GetPose().GetParentBoneIndex(BoneIndex);
-				} while (BoneIndex != RootIndex);
-				BoneIndices.Insert(BoneIndex, 0);
+					CacheAppliedLegChain(Pose, LegIndex);
+				}
 			}
+			OutBoneTransforms.Append(LegsBoneTransforms[LegIndex]);
 
-			// Gather transforms
-			int32 const NumTransforms = BoneIndices.Num();
-			TempTransforms.AddUninitialized(NumTransforms);
+			const FBoneTransform& TipBoneTransform = LegsBoneTransforms[LegIndex][RigDescriptor->LegsChainData[LegIndex].GetTipTransformIndex()];
+			LegsOutputTipLocations[LegIndex] = FrameInputs.ComponentTransform.TransformPosition(TipBoneTransform.Transform.GetLocation());
+		}
+	}
+}
 
-			// Gather chain links. These are non zero length bones.
-			TArray<FSPW_CCDIKChainLink> Chain;
-			Chain.Reserve(NumTransforms);
-			// Start with Root Bone
-			{
-				const FCompactPoseBoneIndex& RootBoneIndex = BoneIndices[0];
-				const FTransform& LocalTransform = Output.Pose.GetLocalSpaceTransform(RootBoneIndex);
-				const FTransform& BoneCSTransform = Output.Pose.GetComponentSpaceTransform(RootBoneIndex);
+void FAnimNode_SPW::GatherLegChains(FCSPose<FCompactPose>& Pose)
+{
+	GatheredLegIndices.Reset();
+	SolvedLegIndices.Reset();
 
-				TempTransforms[0] = FBoneTransform(RootBoneIndex, BoneCSTransform);
-				Chain.Add(FSPW_CCDIKChainLink(BoneCSTransform, LocalTransform, 0));
-			}
+	for (int LegIndex = 0; LegIndex < Legs.Num(); LegIndex++)
+	{
+		LegsIKCacheData[LegIndex].bIsWarmStarted = false;
+		LegsIKCacheData[LegIndex].bIsFrozen = false;
 
-			// Go through remaining transforms
-			for (int32 TransformIndex = 1; TransformIndex < NumTransforms; TransformIndex++)
-			{
-				const FCompactPoseBoneIndex& BoneIndex = BoneIndices[TransformIndex];
+		// do not perform IK if it's disabled
+		if (!LegsData[LegIndex].bEnableIK || !RigDescriptor->LegsChainData[LegIndex].IsValid())
+		{
+			LegsIKCacheData[LegIndex].bIsValid = false;
+			LegsIKCacheData[LegIndex].bIsApplied = false;
+			continue;
+		}
 
-				const FTransform& LocalTransform = Output.Pose.GetLocalSpaceTransform(BoneIndex);
-				const FTransform& BoneCSTransform = Output.Pose.GetComponentSpaceTransform(BoneIndex);
-				FVector const BoneCSPosition = BoneCSTransform.GetLocation();
+		GatheredLegIndices.Add(LegIndex);
 
-				TempTransforms[TransformIndex] = FBoneTransform(BoneIndex, BoneCSTransform);
+		if (bIsIdle && IsLegChainUnchanged(Pose, LegIndex))
+		{
+			/* -> nothing moved since the last solve, its bone transforms are used as is */
+			LegsIKCacheData[LegIndex].bIsFrozen = true;
+			INC_DWORD_STAT(STAT_SimpleProceduralWalk_NumLegsFrozen);
+			continue;
+		}
 
-				// Calculate the combined length of this segment of skeleton
-				float const BoneLength = FVector::Dist(BoneCSPosition, TempTransforms[TransformIndex - 1].Transform.GetLocation());
+		GatherLegChain(Pose, LegIndex);
 
-				if (!FMath::IsNearlyZero(BoneLength))
-				{
-					Chain.Add(FSPW_CCDIKChainLink(BoneCSTransform, LocalTransform, TransformIndex));
-				}
-				else
-				{
-					// Mark this transform as a zero length child of the last link.
-					// It will inherit position and delta rotation from parent link.
-					FSPW_CCDIKChainLink & ParentLink = Chain[Chain.Num() - 1];
-					ParentLink.ChildZeroLengthTransformIndices.Add(TransformIndex);
-				}
-			}
+		if (bWarmStartLegs && WarmStartLegChain(LegIndex))
+		{
+			/* -> target barely moved, the last solve is used as is */
+			continue;
+		}
+		SolvedLegIndices.Add(LegIndex);
+	}
+}
 
-			// solve
-			bool bBoneLocationUpdated = SolveCCDIK(Chain
-				, CSEffectorLocation
-				, Legs[LegIndex].bEnableRotationLimits
-				, FeetRotationLimitsPerJoints[LegIndex].RotationLimits);
+void FAnimNode_SPW::SolveLegChain(int32 LegIndex, const FSPW_IKSolveSettings& Settings)
+{
+	if (bAnalyticSolveLegs && SolveLegChainAnalytic(LegIndex))
+	{
+		return;
+	}
 
-			// If we moved some bones, update bone transforms.
-			if (bBoneLocationUpdated)
-			{
-				int32 NumChainLinks = Chain.Num();
+	switch (IKSolverType)
+	{
+	case ESimpleProceduralWalk_IKSolverType::FABRIK:
+		LegsSolveResults[LegIndex] = SPW_IK::SolveFABRIK(LegsChains[LegIndex], LegsEffectorLocations[LegIndex], Settings);
+		break;
+	default:
+		LegsSolveResults[LegIndex] = SPW_IK::SolveCCDIK(LegsChains[LegIndex], LegsEffectorLocations[LegIndex], Settings);
+		break;
+	}
+}
 
-				// First step: update bone transform positions from chain links.
-				for (int32 LinkIndex = 0; LinkIndex < NumChainLinks; LinkIndex++)
-				{
-					FSPW_CCDIKChainLink const & ChainLink = Chain[LinkIndex];
-					TempTransforms[ChainLink.TransformIndex].Transform = ChainLink.Transform;
-
-					// If there are any zero length children, update position of those
-					int32 const NumChildren = ChainLink.ChildZeroLengthTransformIndices.Num();
-					for (int32 ChildIndex = 0; ChildIndex < NumChildren; ChildIndex++)
-					{
-						TempTransforms[ChainLink.ChildZeroLengthTransformIndices[ChildIndex]].Transform = ChainLink.Transform;
-					}
-				}
-			}
+bool FAnimNode_SPW::SolveLegChainAnalytic(int32 LegIndex)
+{
+	FSPW_IKSolveResult Result;
+	if (SPW_IK::SolveAnalytic(LegsChains[LegIndex], LegsEffectorLocations[LegIndex], Result))
+	{
+		LegsSolveResults[LegIndex] = Result;
+		INC_DWORD_STAT(STAT_SimpleProceduralWalk_NumLegsSolvedAnalytically);
+		return true;
+	}
+	return false;
+}
 
-			// rotate tip bone
-			FCompactPoseBoneIndex CompactPoseBoneToModify = Legs[LegIndex].TipBone.GetCompactPoseIndex(BoneContainer);
-			FTransform ComponentTransform = Output.AnimInstanceProxy->GetComponentTransform();
-			int32 const TipBoneTransformIndex = TempTransforms.Num() - 1;
+void FAnimNode_SPW::SolveLegChainsParallel(const FSPW_IKSolveSettings& Settings)
+{
+	// each leg only writes its own chain & result
+	ParallelFor(SolvedLegIndices.Num(), [this, &Settings](int32 Index) {
+		SolveLegChain(SolvedLegIndices[Index], Settings);
+	});
+}
 
-			// convert to Bone Space.
-			FAnimationRuntime::ConvertCSTransformToBoneSpace(ComponentTransform, Output.Pose, TempTransforms[TipBoneTransformIndex].Transform, CompactPoseBoneToModify, BCS_ComponentSpace);
+void FAnimNode_SPW::SolveLegChainsBatched(const FSPW_IKSolveSettings& Settings)
+{
+	SortedLegIndices.Reset();
+	for (int32 LegIndex : SolvedLegIndices)
+	{
+		if (!bAnalyticSolveLegs || !SolveLegChainAnalytic(LegIndex))
+		{
+			SortedLegIndices.Add(LegIndex);
+		}
+	}
+
+	// legs with the same number of links are next to each other
+	SortedLegIndices.Sort([this](int32 LegIndexA, int32 LegIndexB) {
+		return LegsChains[LegIndexA].Num() < LegsChains[LegIndexB].Num();
+	});
+
+	// solve in batches
+	for (int32 FirstIndex = 0; FirstIndex < SortedLegIndices.Num(); )
+	{
+		const int32 NumChainLinks = LegsChains[SortedLegIndices[FirstIndex]].Num();
 
-			const FQuat BoneQuat(LegsData[LegIndex].FootTargetRotation);
-			TempTransforms[TipBoneTransformIndex].Transform.SetRotation(BoneQuat * TempTransforms[TipBoneTransformIndex].Transform.GetRotation());
+		FSPW_IKChain* Chains[FSPW_IKChainBatch::NumLanes];
+		FVector TargetPositions[FSPW_IKChainBatch::NumLanes];
+		FSPW_IKSolveResult Results[FSPW_IKChainBatch::NumLanes];
+		int32 NumChains = 0;
 
-			// convert back to Component Space.
-			FAnimationRuntime::ConvertBoneSpaceTransformToCS(ComponentTransform, Output.Pose, TempTransforms[TipBoneTransformIndex].Transform, CompactPoseBoneToModify, BCS_ComponentSpace);
+		while (NumChains < FSPW_IKChainBatch::NumLanes
+			&& FirstIndex + NumChains < SortedLegIndices.Num()
+			&& LegsChains[SortedLegIndices[FirstIndex + NumChains]].Num() == NumChainLinks)
+		{
+			const int32 LegIndex = SortedLegIndices[FirstIndex + NumChains];
+			Chains[NumChains] = &LegsChains[LegIndex];
+			TargetPositions[NumChains] = LegsEffectorLocations[LegIndex];
+			++NumChains;
+		}
+
+		if (NumChains == 1)
+		{
+			// a lone chain does not need the lanes
+			Results[0] = SPW_IK::SolveCCDIK(*Chains[0], TargetPositions[0], Settings);
+		}
+		else
+		{
+			SPW_IK::SolveCCDIKBatch(Chains, TargetPositions, NumChains, Settings, IKChainBatch, Results);
+		}
 
-			// merge before looping
-			Output.Pose.LocalBlendCSBoneTransforms(TempTransforms, 1.f);
+		for (int32 ChainIndex = 0; ChainIndex < NumChains; ++ChainIndex)
+		{
+			LegsSolveResults[SortedLegIndices[FirstIndex + ChainIndex]] = Results[ChainIndex];
 		}
+
+		FirstIndex += NumChains;
 	}
 }
 
-FTransform FAnimNode_SPW::CCDIK_GetTargetTransform(const FTransform& InComponentTransform, FCSPose<FCompactPose>& MeshBases, FBoneSocketTarget& InTarget, const FVector& InOffset)
+void FAnimNode_SPW::GatherLegChain(FCSPose<FCompactPose>& Pose, int32 LegIndex)
 {
-	FTransform OutTransform;
+	// Update EffectorLocation if it is based off a bone position
+	FTransform CSEffectorTransform = CCDIK_GetTargetTransform(FrameInputs.ComponentTransform
+		, Pose
+		, RigDescriptor->EffectorTargets[LegIndex]
+		, LegsData[LegIndex].FootLocation);
+	LegsEffectorLocations[LegIndex] = CSEffectorTransform.GetLocation();
 
-	// parent bone space still goes through this way
-	// if your target is socket, it will try find parents of joint that socket belongs to
-	OutTransform.SetLocation(InOffset);
-	FAnimationRuntime::ConvertBoneSpaceTransformToCS(InComponentTransform, MeshBases, OutTransform, InTarget.GetCompactPoseBoneIndex(), EBoneControlSpace::BCS_WorldSpace);
+	const FSimpleProceduralWalk_LegChainData& ChainData = RigDescriptor->LegsChainData[LegIndex];
 
-	return OutTransform;
+	// gather transforms
+	TArray<FBoneTransform>& TempTransforms = LegsBoneTransforms[LegIndex];
+	TempTransforms.Reset();
+
+	for (const FCompactPoseBoneIndex& BoneIndex : ChainData.BoneIndices)
+	{
+		TempTransforms.Add(FBoneTransform(BoneIndex, Pose.GetComponentSpaceTransform(BoneIndex)));
+	}
+
+	// the body transform is only merged at the end, so move the leg with it here
+	if (bIsBodyMoved && ChainData.bIsChildOfBody)
+	{
+		for (FBoneTransform& BoneTransform : TempTransforms)
+		{
+			BoneTransform.Transform = BoneTransform.Transform * BodyDeltaTransform;
+		}
+	}
+
+	// gather chain links
+	FSPW_IKChain& Chain = LegsChains[LegIndex];
+	Chain.Reset();
+	Chain.bEnableRotationLimits = Legs[LegIndex].bEnableRotationLimits;
+
+	for (int32 LinkIndex = 0; LinkIndex < ChainData.LinkTransformIndices.Num(); LinkIndex++)
+	{
+		const int32 TransformIndex = ChainData.LinkTransformIndices[LinkIndex];
+
+		Chain.AddLink(TempTransforms[TransformIndex].Transform
+			, Pose.GetLocalSpaceTransform(ChainData.BoneIndices[TransformIndex])
+			, TransformIndex
+			, ChainData.LinkRotationLimits[LinkIndex]);
+	}
+
+	// the animated pose that solves are cached against
+	if (bWarmStartLegs)
+	{
+		FSimpleProceduralWalk_LegIKCacheData& CacheData = LegsIKCacheData[LegIndex];
+		CacheData.GatheredLinkLocalRotations.Reset();
+		CacheData.GatheredLinkLocalRotations.Append(Chain.LocalRotations);
+	}
 }
 
-bool FAnimNode_SPW::SolveCCDIK(TArray<FSPW_CCDIKChainLink>& InOutChain, const FVector& TargetPosition, bool bEnableRotationLimit, const TArray<float>& RotationLimitPerJoints)
+void FAnimNode_SPW::ApplyLegChain(FCSPose<FCompactPose>& Pose, int32 LegIndex)
 {
-	struct Local
+	TArray<FBoneTransform>& TempTransforms = LegsBoneTransforms[LegIndex];
+	const FSPW_IKChain& Chain = LegsChains[LegIndex];
+
+	// If we moved some bones, update bone transforms.
+	if (LegsSolveResults[LegIndex].bUpdated || LegsIKCacheData[LegIndex].bIsWarmStarted)
 	{
-		static bool UpdateChainLink(TArray<FSPW_CCDIKChainLink>& Chain, int32 LinkIndex, const FVector& TargetPos, bool bInEnableRotationLimit, const TArray<float>& InRotationLimitPerJoints)
+		int32 const NumChainLinks = Chain.Num();
+
+		for (int32 LinkIndex = 0; LinkIndex < NumChainLinks; LinkIndex++)
 		{
-			int32 const TipBoneLinkIndex = Chain.Num() - 1;
+			const int32 TransformIndex = Chain.TransformIndices[LinkIndex];
+			FTransform& LinkTransform = TempTransforms[TransformIndex].Transform;
+			LinkTransform.SetTranslation(Chain.Positions[LinkIndex]);
+			LinkTransform.SetRotation(Chain.Rotations[LinkIndex]);
+
+			// If there are any zero length children, update position of those
+			const int32 NextLinkTransformIndex = (LinkIndex + 1 < NumChainLinks) ? Chain.TransformIndices[LinkIndex + 1] : TempTransforms.Num();
+			for (int32 ChildTransformIndex = TransformIndex + 1; ChildTransformIndex < NextLinkTransformIndex; ChildTransformIndex++)
+			{
+				TempTransforms[ChildTransformIndex].Transform = LinkTransform;
+			}
+		}
+	}
 
-			ensure(Chain.IsValidIndex(TipBoneLinkIndex));
-			FSPW_CCDIKChainLink& CurrentLink = Chain[LinkIndex];
+	// rotate tip bone
+	int32 const TipBoneTransformIndex = RigDescriptor->LegsChainData[LegIndex].GetTipTransformIndex();
+	FCompactPoseBoneIndex CompactPoseBoneToModify = TempTransforms[TipBoneTransformIndex].BoneIndex;
+	FTransform ComponentTransform = FrameInputs.ComponentTransform;
 
-			// update new tip pos
-			FVector TipPos = Chain[TipBoneLinkIndex].Transform.GetLocation();
+	// convert to Bone Space.
+	FAnimationRuntime::ConvertCSTransformToBoneSpace(ComponentTransform, Pose, TempTransforms[TipBoneTransformIndex].Transform, CompactPoseBoneToModify, BCS_ComponentSpace);
 
-			FTransform& CurrentLinkTransform = CurrentLink.Transform;
-			FVector ToEnd = TipPos - CurrentLinkTransform.GetLocation();
-			FVector ToTarget = TargetPos - CurrentLinkTransform.GetLocation();
+	const FQuat BoneQuat(LegsData[LegIndex].FootTargetRotation);
+	TempTransforms[TipBoneTransformIndex].Transform.SetRotation(BoneQuat * TempTransforms[TipBoneTransformIndex].Transform.GetRotation());
 
-			ToEnd.Normalize();
-			ToTarget.Normalize();
+	// convert back to Component Space.
+	FAnimationRuntime::ConvertBoneSpaceTransformToCS(ComponentTransform, Pose, TempTransforms[TipBoneTransformIndex].Transform, CompactPoseBoneToModify, BCS_ComponentSpace);
+}
 
-			float RotationLimitPerJointInRadian = FMath::DegreesToRadians(InRotationLimitPerJoints[LinkIndex]);
-			float Angle = FMath::ClampAngle(FMath::Acos(FVector::DotProduct(ToEnd, ToTarget)), -RotationLimitPerJointInRadian, RotationLimitPerJointInRadian);
-			bool bCanRotate = (FMath::Abs(Angle) > KINDA_SMALL_NUMBER) && (!bInEnableRotationLimit || RotationLimitPerJointInRadian > CurrentLink.CurrentAngleDelta);
-			if (bCanRotate)
-			{
-				// check rotation limit first, if fails, just abort
-				if (bInEnableRotationLimit)
-				{
-					if (RotationLimitPerJointInRadian < CurrentLink.CurrentAngleDelta + Angle)
-					{
-						Angle = RotationLimitPerJointInRadian - CurrentLink.CurrentAngleDelta;
-						if (Angle <= KINDA_SMALL_NUMBER)
-						{
-							return false;
-						}
-					}
-
-					CurrentLink.CurrentAngleDelta += Angle;
-				}
+bool FAnimNode_SPW::WarmStartLegChain(int32 LegIndex)
+{
+	FSimpleProceduralWalk_LegIKCacheData& CacheData = LegsIKCacheData[LegIndex];
+	FSPW_IKChain& Chain = LegsChains[LegIndex];
 
-				// continue with rotating toward to target
-				FVector RotationAxis = FVector::CrossProduct(ToEnd, ToTarget);
-				if (RotationAxis.SizeSquared() > 0.f)
-				{
-					RotationAxis.Normalize();
-					// Delta Rotation is the rotation to target
-					FQuat DeltaRotation(RotationAxis, Angle);
-
-					FQuat NewRotation = DeltaRotation * CurrentLinkTransform.GetRotation();
-					NewRotation.Normalize();
-					CurrentLinkTransform.SetRotation(NewRotation);
-
-					// if I have parent, make sure to refresh local transform since my current transform has changed
-					if (LinkIndex > 0)
-					{
-						FSPW_CCDIKChainLink const & Parent = Chain[LinkIndex - 1];
-						CurrentLink.LocalTransform = CurrentLinkTransform.GetRelativeTransform(Parent.Transform);
-						CurrentLink.LocalTransform.NormalizeRotation();
-					}
-
-					// now update all my children to have proper transform
-					FTransform CurrentParentTransform = CurrentLinkTransform;
-
-					// now update all chain
-					for (int32 ChildLinkIndex = LinkIndex + 1; ChildLinkIndex <= TipBoneLinkIndex; ++ChildLinkIndex)
-					{
-						FSPW_CCDIKChainLink& ChildIterLink = Chain[ChildLinkIndex];
-						const FTransform LocalTransform = ChildIterLink.LocalTransform;
-						ChildIterLink.Transform = LocalTransform * CurrentParentTransform;
-						ChildIterLink.Transform.NormalizeRotation();
-						CurrentParentTransform = ChildIterLink.Transform;
-					}
-
-					return true;
-				}
-			}
+	if (!CacheData.bIsValid || CacheData.LinkLocalRotationDeltas.Num() != Chain.Num())
+	{
+		return false;
+	}
 
-			return false;
+	// relative to the chain root, so that moving the pawn or the body does not count as a target movement
+	const FVector RootRelTarget = Chain.Rotations[0].UnrotateVector(LegsEffectorLocations[LegIndex] - Chain.Positions[0]);
+	const float TargetDistanceSquared = FVector::DistSquared(RootRelTarget, CacheData.RootRelTarget);
+	if (TargetDistanceSquared > FMath::Square(WarmStartMaxDistance))
+	{
+		/* -> moved too much, solve from the animated pose */
+		CacheData.bIsValid = false;
+		return false;
+	}
+
+	// re-based on the animated pose of this frame
+	CacheData.WarmStartLinkLocalRotations.Reset();
+	for (int32 LinkIndex = 0; LinkIndex < Chain.Num(); LinkIndex++)
+	{
+		FQuat LocalRotation = Chain.LocalRotations[LinkIndex] * CacheData.LinkLocalRotationDeltas[LinkIndex];
+		LocalRotation.Normalize();
+		CacheData.WarmStartLinkLocalRotations.Add(LocalRotation);
+	}
+
+	SPW_IK::SetLocalRotations(Chain, CacheData.WarmStartLinkLocalRotations);
+	CacheData.bIsWarmStarted = true;
+
+	if (TargetDistanceSquared <= FMath::Square(WarmStartReuseDistance))
+	{
+		// keep the cached target, so that small movements do not add up
+		LegsSolveResults[LegIndex] = FSPW_IKSolveResult();
+		INC_DWORD_STAT(STAT_SimpleProceduralWalk_NumLegsReused);
+		return true;
+	}
+
+	INC_DWORD_STAT(STAT_SimpleProceduralWalk_NumLegsWarmStarted);
+	return false;
+}
+
+void FAnimNode_SPW::CacheLegChain(int32 LegIndex)
+{
+	FSimpleProceduralWalk_LegIKCacheData& CacheData = LegsIKCacheData[LegIndex];
+	const FSPW_IKChain& Chain = LegsChains[LegIndex];
+	const FVector& EffectorLocation = LegsEffectorLocations[LegIndex];
+
+	// only converged solves are worth starting from
+	CacheData.bIsValid = FVector::DistSquared(Chain.Positions.Last(), EffectorLocation) <= FMath::Square(Precision)
+		&& CacheData.GatheredLinkLocalRotations.Num() == Chain.Num();
+	if (CacheData.bIsValid)
+	{
+		// relative to the animated pose, so that the next frames re-base it on theirs
+		CacheData.LinkLocalRotationDeltas.Reset();
+		for (int32 LinkIndex = 0; LinkIndex < Chain.Num(); LinkIndex++)
+		{
+			CacheData.LinkLocalRotationDeltas.Add(CacheData.GatheredLinkLocalRotations[LinkIndex].Inverse() * Chain.LocalRotations[LinkIndex]);
 		}
-	};
+		CacheData.RootRelTarget = Chain.Rotations[0].UnrotateVector(EffectorLocation - Chain.Positions[0]);
+	}
+}
+
+bool FAnimNode_SPW::IsLegChainUnchanged(FCSPose<FCompactPose>& Pose, int32 LegIndex)
+{
+	const FSimpleProceduralWalk_LegIKCacheData& CacheData = LegsIKCacheData[LegIndex];
+	if (!CacheData.bIsApplied)
+	{
+		return false;
+	}
 
-	bool bBoneLocationUpdated = false;
-	int32 const NumChainLinks = InOutChain.Num();
+	// target
+	const FVector EffectorLocation = CCDIK_GetTargetTransform(FrameInputs.ComponentTransform
+		, Pose
+		, RigDescriptor->EffectorTargets[LegIndex]
+		, LegsData[LegIndex].FootLocation).GetLocation();
+	if (!EffectorLocation.Equals(CacheData.AppliedEffectorLocation, FROZEN_LEG_TOLERANCE))
+	{
+		return false;
+	}
+
+	// every bone of the chain, as gathered (animations may move any of them)
+	const FSimpleProceduralWalk_LegChainData& ChainData = RigDescriptor->LegsChainData[LegIndex];
+	if (CacheData.AppliedInputTransforms.Num() != ChainData.BoneIndices.Num())
+	{
+		return false;
+	}
 
-	// iterate
+	const bool bIsMovedWithBody = bIsBodyMoved && ChainData.bIsChildOfBody;
+	for (int32 TransformIndex = 0; TransformIndex < ChainData.BoneIndices.Num(); TransformIndex++)
 	{
-		int32 const TipBoneLinkIndex = NumChainLinks - 1;
-
-		// @todo optimize locally if no update, stop?
-		bool bLocalUpdated = false;
-		// check how far
-		const FVector TargetPos = TargetPosition;
-		FVector TipPos = InOutChain[TipBoneLinkIndex].Transform.GetLocation();
-		float Distance = FVector::Dist(TargetPos, TipPos);
-		int32 IterationCount = 0;
-		while ((Distance > Precision) && (IterationCount++ < MaxIterations))
+		FTransform InputTransform = Pose.GetComponentSpaceTransform(ChainData.BoneIndices[TransformIndex]);
+		if (bIsMovedWithBody)
 		{
-			// iterate from tip to root
-			if (bStartFromTail)
-			{
-				for (int32 LinkIndex = TipBoneLinkIndex - 1; LinkIndex > 0; --LinkIndex)
-				{
-					bLocalUpdated |= Local::UpdateChainLink(InOutChain, LinkIndex, TargetPos, bEnableRotationLimit, RotationLimitPerJoints);
-				}
-			}
-			else
-			{
-				for (int32 LinkIndex = 1; LinkIndex < TipBoneLinkIndex; ++LinkIndex)
-				{
-					bLocalUpdated |= Local::UpdateChainLink(InOutChain, LinkIndex, TargetPos, bEnableRotationLimit, RotationLimitPerJoints);
-				}
-			}
+			InputTransform = InputTransform * BodyDeltaTransform;
+		}
 
-			Distance = FVector::Dist(InOutChain[TipBoneLinkIndex].Transform.GetLocation(), TargetPosition);
+		if (!InputTransform.Equals(CacheData.AppliedInputTransforms[TransformIndex], FROZEN_LEG_TOLERANCE))
+		{
+			return false;
+		}
+	}
 
-			bBoneLocationUpdated |= bLocalUpdated;
+	return true;
+}
 
-			// no more update in this iteration
-			if (!bLocalUpdated)
-			{
-				break;
-			}
+void FAnimNode_SPW::CacheAppliedLegChain(FCSPose<FCompactPose>& Pose, int32 LegIndex)
+{
+	FSimpleProceduralWalk_LegIKCacheData& CacheData = LegsIKCacheData[LegIndex];
+	const FSimpleProceduralWalk_LegChainData& ChainData = RigDescriptor->LegsChainData[LegIndex];
+
+	// the pose is only modified by the caller, so it still holds the input transforms
+	const bool bIsMovedWithBody = bIsBodyMoved && ChainData.bIsChildOfBody;
+	CacheData.AppliedInputTransforms.Reset();
+	for (const FCompactPoseBoneIndex& BoneIndex : ChainData.BoneIndices)
+	{
+		FTransform& InputTransform = CacheData.AppliedInputTransforms.Add_GetRef(Pose.GetComponentSpaceTransform(BoneIndex));
+		if (bIsMovedWithBody)
+		{
+			InputTransform = InputTransform * BodyDeltaTransform;
 		}
 	}
+	CacheData.AppliedEffectorLocation = LegsEffectorLocations[LegIndex];
+	CacheData.bIsApplied = true;
+}
+
+FTransform FAnimNode_SPW::CCDIK_GetTargetTransform(const FTransform& InComponentTransform, FCSPose<FCompactPose>& MeshBases, const FBoneSocketTarget& InTarget, const FVector& InOffset)
+{
+	FTransform OutTransform;
+
+	// parent bone space still goes through this way
+	// if your target is socket, it will try find parents of joint that socket belongs to
+	OutTransform.SetLocation(InOffset);
+	FAnimationRuntime::ConvertBoneSpaceTransformToCS(InComponentTransform, MeshBases, OutTransform, InTarget.GetCompactPoseBoneIndex(), EBoneControlSpace::BCS_WorldSpace);
 
-	return bBoneLocationUpdated;
-}
\ No newline at end of file
+	return OutTransform;
+}
+
+FSPW_IKSolveSettings FAnimNode_SPW::CCDIK_GetSolveSettings() const
+{
+	FSPW_IKSolveSettings Settings;
+	Settings.Precision = Precision;
+	Settings.MaxIterations = LODTier >= ESimpleProceduralWalk_LODTier::REDUCED_IK ? FMath::Min(MaxIterations, LODReducedMaxIterations) : MaxIterations;
+	Settings.bStartFromTail = bStartFromTail;
+	return Settings;
+}
@@ -3,17 +3,30 @@
 #include "AnimNode_SPW.h"
 #include "Async/Async.h"
 #include "Curves/CurveFloat.h"
-#include "SimpleProceduralWalkInterface.h"
+#include "SPW_FootholdCacheSubsystem.h"
+#include "SPW_GaitStep.h"
 #include "Kismet/KismetMathLibrary.h"
 #include "GameFramework/Actor.h"
-#include "DrawDebugHelpers.h"
 #include "Kismet/KismetSystemLibrary.h"
+#include "Engine/World.h"
 
 // constants
 static const int FRAMES_TO_SKIP_ON_INIT = 2;
 static const float STEP_PERCENT_AT_BEGINNING = .15f;
 static const float STEP_PERCENT_AT_END = .85f;
-static const float SPEED_THRESHOLD_MIN = 2.f;
+static const float CURVE_TABLE_MAX_ERROR = .01f;
+
+// stats
+DECLARE_CYCLE_STAT(TEXT("UpdatePawnVariables"), STAT_SimpleProceduralWalk_UpdatePawnVariables, STATGROUP_SimpleProceduralWalk);
+DECLARE_CYCLE_STAT(TEXT("SetFeetTargetLocations"), STAT_SimpleProceduralWalk_SetFeetTargetLocations, STATGROUP_SimpleProceduralWalk);
+DECLARE_CYCLE_STAT(TEXT("SetFeetTargetLocations - Line Traces"), STAT_SimpleProceduralWalk_LineTraces, STATGROUP_SimpleProceduralWalk);
+DECLARE_CYCLE_STAT(TEXT("SetFeetTargetLocations - Foothold Probes"), STAT_SimpleProceduralWalk_FootholdProbes, STATGROUP_SimpleProceduralWalk);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Foothold Cache Hits"), STAT_SimpleProceduralWalk_NumFootholdCacheHits, STATGROUP_SimpleProceduralWalk);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Foothold Cache Misses"), STAT_SimpleProceduralWalk_NumFootholdCacheMisses, STATGROUP_SimpleProceduralWalk);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Landings Predicted"), STAT_SimpleProceduralWalk_NumLandingsPredicted, STATGROUP_SimpleProceduralWalk);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Landings Retraced"), STAT_SimpleProceduralWalk_NumLandingsRetraced, STATGROUP_SimpleProceduralWalk);
+DECLARE_CYCLE_STAT(TEXT("ComputeFeet"), STAT_SimpleProceduralWalk_ComputeFeet, STATGROUP_SimpleProceduralWalk);
+DECLARE_CYCLE_STAT(TEXT("ComputeBodyTransform"), STAT_SimpleProceduralWalk_ComputeBodyTransform, STATGROUP_SimpleProceduralWalk);
 
 
 /*
@@ -29,21 +42,107 @@ void FAnimNode_SPW::Initialize_Computations()
 	int32 FeetGroupsSize = LegGroups.Num();
 	GroupsData.SetNum(FeetGroupsSize);
 
-	// init feet groups
-	for (int GroupIndex = 0; GroupIndex < LegGroups.Num(); GroupIndex++)
-	{
-		for (int LegIndex : LegGroups[GroupIndex].LegIndices)
-		{
-			LegsData[LegIndex].GroupIndex = GroupIndex;
-		}
-	}
+	// gait phase hand over (the component is searched on the game thread)
+	GaitStateComponent.Reset();
+	bHasSearchedGaitStateComponent = false;
+	GaitState.GroupsData.Reset(FeetGroupsSize);
+
+	// curves
+	BakeCurveTable(SpeedCurve, SpeedCurveTable);
+	BakeCurveTable(HeightCurve, HeightCurveTable);
 
 	// solver
 	RadiusCheck = RadiusCheckMultiplier * FMath::Max(StepDistanceForward, StepDistanceRight);
 
+	// foothold search (a fixed number of candidates per leg)
+	SPW_Foothold::BuildProbePattern(FootholdProbes, FootHoldProbeOffsets);
+	FootHoldHits.SetNum(FootHoldProbeOffsets.Num());
+	FootHoldCandidates.Reserve(FootholdProbes);
+
+	// LOD (spread the traces refreshes of different nodes over frames)
+	FramesSinceTracesRefresh = FMath::RandHelper(FMath::Max(LODTraceRefreshInterval, 1));
+
+	// trace params (same as the Kismet traces, with the pawn ignored)
+	TraceQueryParams = FCollisionQueryParams(SCENE_QUERY_STAT(SimpleProceduralWalkTrace), bTraceComplex, OwnerPawn);
+	TraceQueryParams.bReturnPhysicalMaterial = true;
+
+	// async traces
+	if (bAsyncTraces)
+	{
+		Initialize_AsyncTraces();
+	}
+
+	// support components (found again when the feet are planted)
+	SupportCompTable.Reset();
+	for (FSimpleProceduralWalk_LegData& LegData : LegsData)
+	{
+		LegData.SupportCompIndex = INDEX_NONE;
+		LegData.bIsSupportCompPending = false;
+	}
+
+	// interface events
+	// a frame has at most an up & down per leg and per group, and a landing
+	InterfaceEventQueue = MakeShared<FSPW_InterfaceEventQueue, ESPMode::ThreadSafe>(2 * (FeetDataSize + FeetGroupsSize) + 1);
+	InterfaceImplementers.Reset();
+	bAreInterfaceImplementersCached = false;
+
+	// foothold cache (async traces results are already a frame late, they are not cached)
+	FootholdCache = (bUseFootholdCache && !bAsyncTraces && WorldContext != nullptr) ? WorldContext->GetSubsystem<USPW_FootholdCacheSubsystem>() : nullptr;
+
 	UE_LOG(LogSimpleProceduralWalk, Verbose, TEXT("Computations initialized."));
 }
 
+void FAnimNode_SPW::BakeCurveTable(const UCurveFloat* Curve, FSPW_CurveTable& OutCurveTable)
+{
+	if (!IsValid(Curve))
+	{
+		bHasErrors = true;
+		UE_LOG(LogSimpleProceduralWalk, Error, TEXT("Speed Curve and Height Curve must be set."));
+		OutCurveTable.SetConstant(0.f);
+		return;
+	}
+
+	OutCurveTable.Bake(Curve->FloatCurve);
+
+	// steps are driven by the table, so make sure it follows the curve
+	const float MaxError = OutCurveTable.GetMaxError(Curve->FloatCurve);
+	if (MaxError > CURVE_TABLE_MAX_ERROR)
+	{
+		UE_LOG(LogSimpleProceduralWalk, Warning, TEXT("Curve %s is sampled with an error of %f, consider smoothing it."), *Curve->GetName(), MaxError);
+	}
+	else
+	{
+		UE_LOG(LogSimpleProceduralWalk, Verbose, TEXT("Curve %s is sampled with an error of %f."), *Curve->GetName(), MaxError);
+	}
+}
+
+void FAnimNode_SPW::RestoreGaitState(const FSimpleProceduralWalk_GaitState& InGaitState)
+{
+	if (InGaitState.GroupsData.Num() != GroupsData.Num() || !GroupsData.IsValidIndex(InGaitState.CurrentGroupIndex))
+	{
+		UE_LOG(LogSimpleProceduralWalk, Warning, TEXT("Ignoring handed over gait state, it does not match the leg groups."));
+		return;
+	}
+
+	UE_LOG(LogSimpleProceduralWalk, Verbose, TEXT("Restoring gait state, next group to unplant: %d."), InGaitState.CurrentGroupIndex);
+
+	CurrentGroupIndex = InGaitState.CurrentGroupIndex;
+	GroupsData = InGaitState.GroupsData;
+
+	// steps in progress continue from where the feet are now
+	for (FSimpleProceduralWalk_LegData& LegData : LegsData)
+	{
+		LegData.FootUnplantLocation = LegData.FootLocation;
+	}
+}
+
+void FAnimNode_SPW::StoreGaitState()
+{
+	// published to the component in the next PreUpdate
+	GaitState.CurrentGroupIndex = CurrentGroupIndex;
+	GaitState.GroupsData = GroupsData;
+}
+
 /*
  * TICK
  */
@@ -60,12 +159,12 @@ void FAnimNode_SPW::Evaluate_Computations()
 		// init feet data after first frames (so that actor is correctly positioned in the world)
 		for (int LegIndex = 0; LegIndex < Legs.Num(); LegIndex++)
 		{
-			FSimpleProceduralWalk_Leg Leg = Legs[LegIndex];
+			const FSimpleProceduralWalk_Leg& Leg = Legs[LegIndex];
 
 			UE_LOG(LogSimpleProceduralWalk, Verbose, TEXT("Initializing %s bone data."), *Leg.TipBone.BoneName.ToString());
 
 			// get relative parent bone position
-			FVector ParentBoneRelLocationWithOffsets = (SkeletalMeshComponent->GetSocketTransform(Leg.ParentBone.BoneName, RTS_Actor)).GetLocation() + Leg.Offset;
+			FVector ParentBoneRelLocationWithOffsets = FrameInputs.GetActorTransform().InverseTransformPosition(FrameInputs.ParentBoneLocations[LegIndex]) + Leg.Offset;
 
 			// compute relative foot position, we assume that feet are located at the edge of the model
 			// (we can use Z since in actor space)
@@ -79,15 +178,13 @@ void FAnimNode_SPW::Evaluate_Computations()
 			LegsData[LegIndex].TipBoneOriginalRelLocation = TipBoneRelLocation;
 
 			// save in world space
-			FVector TipBoneLocation = (FTransform(FRotator(0.f), TipBoneRelLocation, FVector(1.f)) * OwnerPawn->GetActorTransform()).GetLocation();
+			FVector TipBoneLocation = (FTransform(FRotator(0.f), TipBoneRelLocation, FVector(1.f)) * FrameInputs.GetActorTransform()).GetLocation();
 			LegsData[LegIndex].FootTarget = TipBoneLocation;
 			LegsData[LegIndex].FootLocation = TipBoneLocation;
 
 			if (bDebug)
 			{
-				AsyncTask(ENamedThreads::GameThread, [=]() {
-					DrawDebugSphere(WorldContext, TipBoneLocation, 12.f, 12, FColor::Purple, false, 5.f);
-				});
+				DebugDrawBuffer.AddSphere(TipBoneLocation, 12.f, FColor::Purple, 5.f);
 			}
 
 			// Forward / Backward
@@ -120,12 +217,31 @@ void FAnimNode_SPW::Evaluate_Computations()
 		bIsInitialized = true;
 	}
 
+	// continue the gait where its previous owner left it
+	if (GameThreadSnapshot.bHasHandedOverGaitState)
+	{
+		RestoreGaitState(GameThreadSnapshot.HandedOverGaitState);
+	}
+
 	// common
 	UpdatePawnVariables();
 	SetSupportCompDeltas();
 
+	UpdateIdleState();
+
 	// walk
-	SetFeetTargetLocations();
+	if (bIsIdle)
+	{
+		/* -> standing still, feet targets are frozen */
+	}
+	else if (ShouldRefreshTraces())
+	{
+		SetFeetTargetLocations();
+	}
+	else
+	{
+		CarryFeetTargets();
+	}
 
 	if (bIsFalling)
 	{
@@ -143,6 +259,9 @@ void FAnimNode_SPW::Evaluate_Computations()
 	// body
 	ComputeBodyTransform();
 
+	// gait phase hand over
+	StoreGaitState();
+
 	// debug
 	DebugShow();
 }
@@ -152,54 +271,26 @@ void FAnimNode_SPW::Evaluate_Computations()
  */
 void FAnimNode_SPW::UpdatePawnVariables()
 {
-	FVector PawnVelocity = OwnerPawn->GetVelocity();
-
-	// Speed
-	Speed = PawnVelocity.Size();
-	if (Speed <= SPEED_THRESHOLD_MIN)
-	{
-		Speed = 0;
-		PawnVelocity = FVector(0.f);
-	}
-
-	// %
-	PawnVelocity.Normalize();
-	ForwardPercent = UKismetMathLibrary::MapRangeClamped(
-		UKismetMathLibrary::DegAcos(FVector::DotProduct(OwnerPawn->GetActorForwardVector(), PawnVelocity))
-		, 0.f, 180.f
-		, 1.f, -1.f);
-	RightPercent = UKismetMathLibrary::MapRangeClamped(
-		UKismetMathLibrary::DegAcos(FVector::DotProduct(OwnerPawn->GetActorRightVector(), PawnVelocity))
-		, 0.f, 180.f
-		, 1.f, -1.f);
+	SCOPE_CYCLE_COUNTER(STAT_SimpleProceduralWalk_UpdatePawnVariables);
 
 	// Rotation
-	YawDelta = UKismetMathLibrary::NormalizedDeltaRotator(OwnerPawn->GetActorRotation(), PreviousRotation).Yaw;
-	PreviousRotation = OwnerPawn->GetActorRotation();
-
-	// Current step length
-	CurrentStepLength =
-		(
-			// portion of step forward
-			abs(ForwardPercent * StepDistanceForward)
-			// portion of step right
-			+ abs(RightPercent * StepDistanceRight)
-			// portion of step right based on angular speed
-			+ abs(StepDistanceRight * FMath::Clamp(YawDelta / 360, -1.f, 1.f))
-			)
-		// reduce distance due to slope
-		* GetReductionSlopeMultiplier();
-
-	// Current step duration
-	float SpeedWithAngular = Speed + abs(YawDelta);
-	if (SpeedWithAngular > 5)	// Avoid unnatural step durations
-	{
-		CurrentStepDuration = CurrentStepLength / SpeedWithAngular;
-	}
-	else
-	{
-		CurrentStepDuration = MinStepDuration;
-	}
+	YawDelta = UKismetMathLibrary::NormalizedDeltaRotator(FrameInputs.GetActorRotation(), PreviousRotation).Yaw;
+	PreviousRotation = FrameInputs.GetActorRotation();
+
+	// Speed, % & current step
+	const FSPW_GaitStep Step = SPW_Gait::ComputeStep(FrameInputs.GetVelocity()
+		, FrameInputs.GetActorForwardVector()
+		, FrameInputs.GetActorRightVector()
+		, YawDelta
+		, StepDistanceForward
+		, StepDistanceRight
+		, GetReductionSlopeMultiplier()
+		, MinStepDuration);
+	Speed = Step.Speed;
+	ForwardPercent = Step.ForwardPercent;
+	RightPercent = Step.RightPercent;
+	CurrentStepLength = Step.StepLength;
+	CurrentStepDuration = Step.StepDuration;
 
 	// Acceleration
 	ForwardAcceleration = ((ForwardPercent * Speed) - (PreviousForwardPercent * PreviousSpeed)) / WorldDeltaSeconds;
@@ -214,25 +305,47 @@ void FAnimNode_SPW::UpdatePawnVariables()
  */
 void FAnimNode_SPW::SetSupportCompDeltas()
 {
-	for (int LegIndex = 0; LegIndex < Legs.Num(); LegIndex++)
+	if (bIsReplaying)
 	{
-		if (IsValid(LegsData[LegIndex].SupportComp))
+		// as recorded (replayed hits have no component)
+		for (int LegIndex = 0; LegIndex < Legs.Num(); LegIndex++)
 		{
-			// compute world locations
-			FVector PreviousLocation = (FTransform(FRotator(0.f), LegsData[LegIndex].RelLocationToSupportComp, FVector(1.f)) * LegsData[LegIndex].SupportCompPreviousTransform).GetLocation();
-			FVector NewLocation = (FTransform(FRotator(0.f), LegsData[LegIndex].RelLocationToSupportComp, FVector(1.f)) * LegsData[LegIndex].SupportComp->GetComponentTransform()).GetLocation();
+			LegsData[LegIndex].SupportCompDelta = FrameInputs.SupportCompDeltas[LegIndex];
+		}
+		return;
+	}
 
-			// save delta
-			LegsData[LegIndex].SupportCompDelta = NewLocation - PreviousLocation;
+	// once per component
+	SupportCompTable.Update(GameThreadSnapshot.SupportComps, GameThreadSnapshot.SupportCompTransforms);
 
-			// save previous transform
-			LegsData[LegIndex].SupportCompPreviousTransform = LegsData[LegIndex].SupportComp->GetComponentTransform();
-		}
-		else
+	for (int LegIndex = 0; LegIndex < Legs.Num(); LegIndex++)
+	{
+		FSimpleProceduralWalk_LegData& LegData = LegsData[LegIndex];
+		LegData.SupportCompDelta = FVector(0.f);
+
+		if (LegData.SupportCompIndex != INDEX_NONE)
 		{
-			// set to 0
-			LegsData[LegIndex].SupportCompDelta = FVector(0.f);
+			const FSPW_SupportComp& SupportComp = SupportCompTable[LegData.SupportCompIndex];
+
+			if (LegData.bIsSupportCompPending && SupportComp.bHasTransform)
+			{
+				/* -> found by the previous evaluation, first snapshot of the component */
+				LegData.RelLocationToSupportComp = SupportComp.Transform.InverseTransformPosition(LegData.SupportCompRefLocation);
+				LegData.bIsSupportCompPending = false;
+			}
+			else if (!LegData.bIsSupportCompPending && SupportComp.bHasMoved)
+			{
+				// world locations
+				FVector PreviousLocation = SupportComp.PreviousTransform.TransformPosition(LegData.RelLocationToSupportComp);
+				FVector NewLocation = SupportComp.Transform.TransformPosition(LegData.RelLocationToSupportComp);
+
+				// save delta
+				LegData.SupportCompDelta = NewLocation - PreviousLocation;
+			}
+			/* -> else the component did not move */
 		}
+
+		FrameInputs.SupportCompDeltas[LegIndex] = LegData.SupportCompDelta;
 	}
 }
 
@@ -241,178 +354,130 @@ void FAnimNode_SPW::SetSupportCompDeltas()
  */
 void FAnimNode_SPW::SetFeetTargetLocations()
 {
+	SCOPE_CYCLE_COUNTER(STAT_SimpleProceduralWalk_SetFeetTargetLocations);
+
 	for (int LegIndex = 0; LegIndex < Legs.Num(); LegIndex++)
 	{
-		SetFootTargetLocation(LegIndex);
+		if (IsUsingPredictiveFootPlacement())
+		{
+			PredictFootTargetLocation(LegIndex);
+		}
+		else
+		{
+			SetFootTargetLocation(LegIndex, GetFootTraceStartLocation(LegIndex));
+		}
+	}
+
+	if (bAsyncTraces)
+	{
+		// submit all the traces of this frame at once
+		SubmitAsyncFootTraces();
 	}
 }
 
-void FAnimNode_SPW::SetFootTargetLocation(int32 LegIndex)
+FVector FAnimNode_SPW::GetFootTraceStartLocation(int32 LegIndex)
 {
 	// get foot data
-	FSimpleProceduralWalk_Leg Leg = Legs[LegIndex];
+	const FSimpleProceduralWalk_Leg& Leg = Legs[LegIndex];
 
 	// Parent Bone Location
-	FVector ParentBoneLocation = SkeletalMeshComponent->GetSocketLocation(Leg.ParentBone.BoneName);
+	FVector ParentBoneLocation = FrameInputs.ParentBoneLocations[LegIndex];
 
 	// Forward offset (based on forward speed & optional offset)
-	FVector ForwardOffset = OwnerPawn->GetActorForwardVector() * ((StepDistanceForward * ForwardPercent) + Leg.Offset.X);
+	FVector ForwardOffset = FrameInputs.GetActorForwardVector() * ((StepDistanceForward * ForwardPercent) + Leg.Offset.X);
 
 	// Right offset (based on right speed & optional offset)
-	FVector RightOffset = OwnerPawn->GetActorRightVector() * ((StepDistanceRight * RightPercent) + Leg.Offset.Y);
+	FVector RightOffset = FrameInputs.GetActorRightVector() * ((StepDistanceRight * RightPercent) + Leg.Offset.Y);
+
+	return ParentBoneLocation + ForwardOffset + RightOffset;
+}
+
+void FAnimNode_SPW::SetFootTargetLocation(int32 LegIndex, FVector StartLocationWithoutZOffset)
+{
+	// get foot data
+	const FSimpleProceduralWalk_Leg& Leg = Legs[LegIndex];
 
 	// Locations
-	FVector StartLocationWithoutZOffset = ParentBoneLocation + ForwardOffset + RightOffset;
-	FVector StartLocation = StartLocationWithoutZOffset + OwnerPawn->GetActorUpVector() * TraceZOffset;
-	FVector EndLocation = StartLocationWithoutZOffset - OwnerPawn->GetActorUpVector() * TraceLength;
+	FVector StartLocation = StartLocationWithoutZOffset + FrameInputs.GetActorUpVector() * TraceZOffset;
+	FVector EndLocation = StartLocationWithoutZOffset - FrameInputs.GetActorUpVector() * TraceLength;
 
 	// init hit
 	bool bIsHit = false;
-	bool bIsFootHoldHit;
-	FHitResult Hit;
-
-	// prepare ignore actors
-	TArray<AActor*> ActorsToIgnore;
-	ActorsToIgnore.Add(OwnerPawn);
+	bool bIsUsingBasic = true;
+	// traced in place, it is kept as the last hit
+	FHitResult& Hit = LegsData[LegIndex].LastHit;
 
-	// line hit
-	bIsHit = UKismetSystemLibrary::LineTraceSingle(WorldContext
-		, StartLocation
-		, EndLocation
-		, TraceChannel
-		, bTraceComplex
-		, ActorsToIgnore
-		, EDrawDebugTrace::None
-		, Hit
-		, true
-	);
-
-	if (SolverType == ESimpleProceduralWalk_SolverType::BASIC)
+	if (bAsyncTraces)
 	{
-		// ---------- \/ BASIC ----------
-		if (bDebug)
-		{
-			FTransform DebugTransform = FTransform(OwnerPawn->GetActorRotation(), Hit.ImpactPoint, FVector(1.f));
-
-			// line
-			AsyncTask(ENamedThreads::GameThread, [=]() {
-				// draw line
-				DrawDebugLine(WorldContext, StartLocation, EndLocation, (bIsHit ? FColor::Green : FColor::Red));
-				// hit point
-				if (bIsHit)
-				{
-					DrawDebugSolidBox(WorldContext, FBox(FVector(-2.f, -2.f, 0.f), FVector(2.f, 2.f, 2.f)), FColor::Green, DebugTransform);
-				}
-			});
-		}
+		// use the results of the previously submitted traces & queue the new ones
+		bIsHit = GetAsyncFootTraceResult(LegIndex, StartLocation, EndLocation, StartLocationWithoutZOffset, Hit, bIsUsingBasic);
 	}
 	else
 	{
-		// ---------- \/ ADVANCED ----------
-		bool bIsUsingBasic;
-
-		// distance between start location (without traceZoffset) and impact point
-		float ZDistanceToLineHit = (StartLocationWithoutZOffset - Hit.ImpactPoint).Size();
-
-		// should we also foot hold hit?
-		bool bIsTooDistant = ZDistanceToLineHit > (LegsData[LegIndex].Length * DistanceCheckMultiplier);
+		// line hit
+		bIsHit = LineTraceFoot(StartLocation, EndLocation, Hit);
 
-		if (!bIsHit || bIsTooDistant)
+		if (SolverType == ESimpleProceduralWalk_SolverType::ADVANCED)
 		{
-			/* -> no hit or hit too distant -> do sphere trace */
-			TArray<FHitResult> FootHoldHits;
+			// distance between start location (without traceZoffset) and impact point
+			float ZDistanceToLineHit = (StartLocationWithoutZOffset - Hit.ImpactPoint).Size();
 
-			bIsFootHoldHit = UKismetSystemLibrary::SphereTraceMulti(WorldContext
-				, StartLocation
-				, EndLocation
-				, RadiusCheck
-				, TraceChannel
-				, bTraceComplex
-				, ActorsToIgnore
-				, EDrawDebugTrace::None
-				, FootHoldHits
-				, true);
+			// should we also foot hold hit?
+			bool bIsTooDistant = ZDistanceToLineHit > (LegsData[LegIndex].Length * DistanceCheckMultiplier);
 
-			if (FootHoldHits.Num() > 0)
+			if (!bIsHit || bIsTooDistant)
 			{
-				// at least 1 hit
-				FHitResult FootHoldBestHit;
-
-				// filter based on:
-				//   . distance < line trace distance
-				//   . hit normals not perpendicular to pawn's up vector (i.e. walls are less appealing)
-				float MinZ = (TraceLength + TraceZOffset) * 2;
-				for (FHitResult FootHoldHit : FootHoldHits)
-				{
-					// compute distance
-					float ZDistanceToFootHoldHit = (StartLocationWithoutZOffset - FootHoldHit.ImpactPoint).Size();
-					if (ZDistanceToFootHoldHit < ZDistanceToLineHit)
-					{
-						/* -> it's closer than line hit */
-						// check min z distance weighted by surface normals
-						float CurrentHitZ =
-							// distance
-							((StartLocationWithoutZOffset - FootHoldHit.ImpactPoint) * OwnerPawn->GetActorUpVector()).Size()
-							// weighted by 1 - dot product (so 1 means parallel to up vector, i.e. not a wall)
-							* (1.f - FVector::DotProduct(FootHoldHit.ImpactNormal, OwnerPawn->GetActorUpVector()));
-
-						if (CurrentHitZ < MinZ)
-						{
-							/* -> save */
-							MinZ = CurrentHitZ;
-							FootHoldBestHit = FootHoldHit;
-						}
-					}
-				}
-
-				if (FootHoldBestHit.bBlockingHit)
+				/* -> no hit or hit too distant -> probe around */
+				if (SearchFootHold(StartLocation, EndLocation, StartLocationWithoutZOffset, ZDistanceToLineHit, Hit))
 				{
 					/* -> use foothold */
 					bIsUsingBasic = false;
 					bIsHit = true;
-					Hit = FootHoldBestHit;
-				}
-				else
-				{
-					/* -> no valid foothold hits, keep single line result */
-					bIsUsingBasic = true;
 				}
+				/* -> else no valid foothold hits, keep single line result */
 			}
-			else
-			{
-				/* -> if no foothold hits, keep single line result */
-				bIsUsingBasic = true;
-			}
+			/* -> else keep foot result */
 		}
-		else
+	}
+
+	if (SolverType == ESimpleProceduralWalk_SolverType::BASIC)
+	{
+		// ---------- \/ BASIC ----------
+		if (bDebug)
 		{
-			/* -> keep foot result */
-			bIsUsingBasic = true;
-		}
+			FTransform DebugTransform = FTransform(FrameInputs.GetActorRotation(), Hit.ImpactPoint, FVector(1.f));
 
+			// line
+			DebugDrawBuffer.AddLine(StartLocation, EndLocation, (bIsHit ? FColor::Green : FColor::Red));
+			// hit point
+			if (bIsHit)
+			{
+				DebugDrawBuffer.AddSolidBox(FBox(FVector(-2.f, -2.f, 0.f), FVector(2.f, 2.f, 2.f)), FColor::Green, DebugTransform);
+			}
+		}
+	}
+	else
+	{
+		// ---------- \/ ADVANCED ----------
 		if (bDebug)
 		{
-			FVector DebugCapsuleCenter = FMath::Lerp(StartLocation, EndLocation, .5f);
-			float DebugCapsuleHalfHeight = FVector::Distance(StartLocation, EndLocation) / 2;
-			FRotator Rot = UKismetMathLibrary::MakeRotationFromAxes(OwnerPawn->GetActorForwardVector()
-				, OwnerPawn->GetActorRightVector()
-				, OwnerPawn->GetActorUpVector());
-			FQuat DebugCapsuleRotator = FQuat(Rot);
-
-			FTransform DebugHitTransform = FTransform(OwnerPawn->GetActorRotation(), Hit.ImpactPoint, FVector(1.f));
-
-			AsyncTask(ENamedThreads::GameThread, [=]() {
-				// line
-				DrawDebugLine(WorldContext, StartLocation, EndLocation, bIsUsingBasic ? (bIsHit ? FColor::Green : FColor::Red) : FColor::Silver);
-				// draw foothold
-				DrawDebugCapsule(WorldContext, DebugCapsuleCenter, DebugCapsuleHalfHeight, RadiusCheck, DebugCapsuleRotator
-					, bIsUsingBasic ? FColor::Silver : (bIsHit ? FColor::Green : FColor::Red), false, -1.f, 0, .5f);
-				// hit point
-				if (bIsHit)
-				{
-					DrawDebugSolidBox(WorldContext, FBox(FVector(-2.f, -2.f, 0.f), FVector(2.f, 2.f, 2.f)), FColor::Green, DebugHitTransform);
-				}
-			});
+			FTransform DebugHitTransform = FTransform(FrameInputs.GetActorRotation(), Hit.ImpactPoint, FVector(1.f));
+
+			// line
+			DebugDrawBuffer.AddLine(StartLocation, EndLocation, bIsUsingBasic ? (bIsHit ? FColor::Green : FColor::Red) : FColor::Silver);
+			// draw foothold probes
+			const FColor ProbeColor = bIsUsingBasic ? FColor::Silver : (bIsHit ? FColor::Green : FColor::Red);
+			for (int32 ProbeIndex = 0; ProbeIndex < FootHoldProbeOffsets.Num(); ProbeIndex++)
+			{
+				FVector ProbeStartLocation, ProbeEndLocation;
+				GetFootHoldProbe(ProbeIndex, StartLocation, EndLocation, ProbeStartLocation, ProbeEndLocation);
+				DebugDrawBuffer.AddLine(ProbeStartLocation, ProbeEndLocation, ProbeColor);
+			}
+			// hit point
+			if (bIsHit)
+			{
+				DebugDrawBuffer.AddSolidBox(FBox(FVector(-2.f, -2.f, 0.f), FVector(2.f, 2.f, 2.f)), FColor::Green, DebugHitTransform);
+			}
 		}
 	}
 
@@ -436,8 +501,8 @@ void FAnimNode_SPW::SetFootTargetLocation(int32 LegIndex)
 			)
 		{
 			// get hit rotation from normals
-			FRotator TargetFootRotationWorld = UKismetMathLibrary::MakeRotFromZX(Hit.ImpactNormal, SkeletalMeshComponent->GetForwardVector());
-			TargetFootRotationCS = UKismetMathLibrary::InverseTransformRotation(SkeletalMeshComponent->GetComponentTransform(), TargetFootRotationWorld);
+			FRotator TargetFootRotationWorld = UKismetMathLibrary::MakeRotFromZX(Hit.ImpactNormal, FrameInputs.ComponentTransform.GetUnitAxis(EAxis::X));
+			TargetFootRotationCS = UKismetMathLibrary::InverseTransformRotation(FrameInputs.ComponentTransform, TargetFootRotationWorld);
 		}
 		else
 		{
@@ -475,7 +540,7 @@ void FAnimNode_SPW::SetFootTargetLocation(int32 LegIndex)
 		UE_LOG(LogSimpleProceduralWalk, VeryVerbose, TEXT("NO HIT for %s"), *Leg.ParentBone.BoneName.ToString());
 
 		// set target to original foot location in world space
-		FVector FootTarget = (FTransform(FRotator(0.f), LegsData[LegIndex].TipBoneOriginalRelLocation, FVector(1.f)) * OwnerPawn->GetActorTransform()).GetLocation();
+		FVector FootTarget = (FTransform(FRotator(0.f), LegsData[LegIndex].TipBoneOriginalRelLocation, FVector(1.f)) * FrameInputs.GetActorTransform()).GetLocation();
 		LegsData[LegIndex].FootTarget = FootTarget;
 
 		// no rotation
@@ -485,11 +550,221 @@ void FAnimNode_SPW::SetFootTargetLocation(int32 LegIndex)
 	// interp & save
 	LegsData[LegIndex].FootTargetRotation = FMath::RInterpTo(LegsData[LegIndex].FootTargetRotation, TargetFootRotationCS, WorldDeltaSeconds, FeetTipBonesRotationInterpSpeed);
 
+	// relative to the pawn, for the frames without traces
+	LegsData[LegIndex].FootTargetRelLocation = FrameInputs.GetActorTransform().InverseTransformPosition(LegsData[LegIndex].FootTarget);
+
 	// set IK enabled
 	LegsData[LegIndex].bEnableIK = bIsHit;
+}
 
-	// save last hit
-	LegsData[LegIndex].LastHit = Hit;
+bool FAnimNode_SPW::IsUsingPredictiveFootPlacement() const
+{
+	// async results are a frame late and per leg, they cannot be skipped
+	return bPredictiveFootPlacement && !bAsyncTraces;
+}
+
+void FAnimNode_SPW::PredictFootTargetLocation(int32 LegIndex)
+{
+	FSimpleProceduralWalk_LegData& LegData = LegsData[LegIndex];
+	FVector StartLocationWithoutZOffset = GetFootTraceStartLocation(LegIndex);
+
+	if (!IsLegUnplanted(LegIndex))
+	{
+		/* -> leg is planted */
+		if (!LegData.LastHit.bBlockingHit)
+		{
+			// no ground to follow
+			SetFootTargetLocation(LegIndex, StartLocationWithoutZOffset);
+			return;
+		}
+
+		// follow the ground of the last hit (only used to decide when to unplant & to place the body)
+		FVector GroundLocation = FMath::LinePlaneIntersection(StartLocationWithoutZOffset
+			, StartLocationWithoutZOffset - FrameInputs.GetActorUpVector()
+			, LegData.LastHit.ImpactPoint
+			, LegData.LastHit.ImpactNormal);
+		if (GroundLocation.ContainsNaN())
+		{
+			SetFootTargetLocation(LegIndex, StartLocationWithoutZOffset);
+			return;
+		}
+
+		LegData.FootTarget = GroundLocation + FVector(0, 0, Legs[LegIndex].Offset.Z);
+		LegData.FootTargetRelLocation = FrameInputs.GetActorTransform().InverseTransformPosition(LegData.FootTarget);
+		return;
+	}
+
+	if (GetLegStepPercent(LegIndex) >= FixFeetTargetsAfterPercent)
+	{
+		/* -> too far along the step, do not update target to avoid jiggling */
+		LegData.FootTarget += LegData.SupportCompDelta;
+		return;
+	}
+
+	// where will the trace start when the target gets fixed?
+	FVector PredictedStartLocation = PredictFootTraceStartLocation(LegIndex, StartLocationWithoutZOffset);
+
+	if (LegData.bIsLandingPredicted
+		&& FVector::Dist(PredictedStartLocation, LegData.PredictedTraceLocation) <= PredictiveFootPlacementTolerance)
+	{
+		/* -> landing still valid, add moving platform to target */
+		LegData.FootTarget += LegData.SupportCompDelta;
+		return;
+	}
+
+	if (LegData.bIsLandingPredicted)
+	{
+		INC_DWORD_STAT(STAT_SimpleProceduralWalk_NumLandingsRetraced);
+	}
+	else
+	{
+		INC_DWORD_STAT(STAT_SimpleProceduralWalk_NumLandingsPredicted);
+	}
+
+	SetFootTargetLocation(LegIndex, PredictedStartLocation);
+	LegData.PredictedTraceLocation = PredictedStartLocation;
+	LegData.bIsLandingPredicted = true;
+}
+
+FVector FAnimNode_SPW::PredictFootTraceStartLocation(int32 LegIndex, FVector StartLocationWithoutZOffset)
+{
+	// time left until the target gets fixed
+	float RemainingTime = FMath::Max(FixFeetTargetsAfterPercent - GetLegStepPercent(LegIndex), 0.f) * CurrentStepDuration;
+	if (RemainingTime <= 0.f || WorldDeltaSeconds <= 0.f)
+	{
+		return StartLocationWithoutZOffset;
+	}
+
+	// the pawn keeps its velocity & angular speed
+	FVector PawnLocation = FrameInputs.GetActorLocation();
+	FVector PawnDisplacement = Speed > 0.f ? FrameInputs.GetVelocity() * RemainingTime : FVector(0.f);
+	FQuat PawnRotation = FQuat(FrameInputs.GetActorUpVector(), FMath::DegreesToRadians(YawDelta / WorldDeltaSeconds * RemainingTime));
+
+	return PawnLocation + PawnRotation.RotateVector(StartLocationWithoutZOffset - PawnLocation) + PawnDisplacement;
+}
+
+bool FAnimNode_SPW::LineTraceFoot(FVector StartLocation, FVector EndLocation, FHitResult& OutHit)
+{
+	if (bIsReplaying)
+	{
+		return ReplayHit(OutHit);
+	}
+
+	const ECollisionChannel CollisionChannel = UEngineTypes::ConvertToCollisionChannel(TraceChannel);
+
+	USPW_FootholdCacheSubsystem* Cache = FootholdCache.Get();
+	if (Cache != nullptr)
+	{
+		if (Cache->FindHit(StartLocation, EndLocation, CollisionChannel, bTraceComplex, OutHit))
+		{
+			/* -> static ground already traced by this or another creature */
+			INC_DWORD_STAT(STAT_SimpleProceduralWalk_NumFootholdCacheHits);
+			RecordHit(OutHit);
+			return true;
+		}
+		INC_DWORD_STAT(STAT_SimpleProceduralWalk_NumFootholdCacheMisses);
+	}
+
+	bool bIsHit = false;
+	{
+		SCOPE_CYCLE_COUNTER(STAT_SimpleProceduralWalk_LineTraces);
+		INC_DWORD_STAT(STAT_SimpleProceduralWalk_NumLineTraces);
+
+		bIsHit = WorldContext->LineTraceSingleByChannel(OutHit
+			, StartLocation
+			, EndLocation
+			, CollisionChannel
+			, TraceQueryParams);
+	}
+
+	if (bIsHit && Cache != nullptr)
+	{
+		// only kept if on static geometry
+		Cache->AddHit(StartLocation, EndLocation, CollisionChannel, bTraceComplex, OutHit);
+	}
+
+	RecordHit(OutHit);
+	return bIsHit;
+}
+
+bool FAnimNode_SPW::LineTraceFootHoldProbe(FVector StartLocation, FVector EndLocation, FHitResult& OutHit)
+{
+	if (bIsReplaying)
+	{
+		return ReplayHit(OutHit);
+	}
+
+	INC_DWORD_STAT(STAT_SimpleProceduralWalk_NumFootholdProbes);
+
+	bool bIsHit = WorldContext->LineTraceSingleByChannel(OutHit
+		, StartLocation
+		, EndLocation
+		, UEngineTypes::ConvertToCollisionChannel(TraceChannel)
+		, TraceQueryParams);
+
+	RecordHit(OutHit);
+	return bIsHit;
+}
+
+void FAnimNode_SPW::GetFootHoldProbe(int32 ProbeIndex
+	, FVector StartLocation
+	, FVector EndLocation
+	, FVector& OutStartLocation
+	, FVector& OutEndLocation) const
+{
+	const FVector2D& ProbeOffset = FootHoldProbeOffsets[ProbeIndex];
+	FVector Offset = (FrameInputs.GetActorForwardVector() * ProbeOffset.X + FrameInputs.GetActorRightVector() * ProbeOffset.Y) * RadiusCheck;
+
+	OutStartLocation = StartLocation + Offset;
+	OutEndLocation = EndLocation + Offset;
+}
+
+bool FAnimNode_SPW::SearchFootHold(FVector StartLocation
+	, FVector EndLocation
+	, FVector StartLocationWithoutZOffset
+	, float ZDistanceToLineHit
+	, FHitResult& OutHit)
+{
+	SCOPE_CYCLE_COUNTER(STAT_SimpleProceduralWalk_FootholdProbes);
+
+	// one slot per probe, hits are traced in place & indexed as their candidates
+	FootHoldHits.SetNum(FootHoldProbeOffsets.Num(), false);
+	FootHoldCandidates.Reset(StartLocationWithoutZOffset);
+
+	for (int32 ProbeIndex = 0; ProbeIndex < FootHoldProbeOffsets.Num(); ProbeIndex++)
+	{
+		FVector ProbeStartLocation, ProbeEndLocation;
+		GetFootHoldProbe(ProbeIndex, StartLocation, EndLocation, ProbeStartLocation, ProbeEndLocation);
+
+		FHitResult& ProbeHit = FootHoldHits[FootHoldCandidates.Num()];
+		if (LineTraceFootHoldProbe(ProbeStartLocation, ProbeEndLocation, ProbeHit))
+		{
+			FootHoldCandidates.Add(ProbeHit.ImpactPoint, ProbeHit.ImpactNormal);
+		}
+	}
+
+	return FindFootHoldHit(StartLocationWithoutZOffset, ZDistanceToLineHit, OutHit);
+}
+
+bool FAnimNode_SPW::FindFootHoldHit(FVector StartLocationWithoutZOffset
+	, float ZDistanceToLineHit
+	, FHitResult& OutHit)
+{
+	// filter based on:
+	//   . distance < line trace distance
+	//   . hit normals not perpendicular to pawn's up vector (i.e. walls are less appealing)
+	int32 BestIndex = SPW_Foothold::FindBestCandidate(FootHoldCandidates
+		, FrameInputs.GetActorUpVector()
+		, ZDistanceToLineHit
+		, (TraceLength + TraceZOffset) * 2);
+
+	if (BestIndex == INDEX_NONE || !FootHoldHits[BestIndex].bBlockingHit)
+	{
+		return false;
+	}
+
+	OutHit = FootHoldHits[BestIndex];
+	return true;
 }
 
 /*
@@ -552,6 +827,13 @@ void FAnimNode_SPW::SetCurrentGroupUnplanted()
 
 		// save support comp & data
 		SetSupportComponentData(LegIndex, LegsData[LegIndex].FootUnplantLocation);
+
+		if (IsUsingPredictiveFootPlacement())
+		{
+			// trace the landing location once for the whole step
+			LegsData[LegIndex].bIsLandingPredicted = false;
+			PredictFootTargetLocation(LegIndex);
+		}
 	}
 
 	// call interface events
@@ -566,6 +848,8 @@ void FAnimNode_SPW::SetCurrentGroupUnplanted()
  */
 void FAnimNode_SPW::ComputeFeet()
 {
+	SCOPE_CYCLE_COUNTER(STAT_SimpleProceduralWalk_ComputeFeet);
+
 	for (int GroupIndex = 0; GroupIndex < LegGroups.Num(); GroupIndex++)
 	{
 		if (bIsFalling)
@@ -582,11 +866,11 @@ void FAnimNode_SPW::ComputeFeet()
 			{
 				/* -> foot is unplanted */
 				// increment group step %
-				GroupsData[GroupIndex].StepPercent = FMath::Clamp(GroupsData[GroupIndex].StepPercent + (WorldDeltaSeconds / CurrentStepDuration), 0.f, 1.f);
+				GroupsData[GroupIndex].StepPercent = SPW_Gait::AdvanceStepPercent(GroupsData[GroupIndex].StepPercent, WorldDeltaSeconds, CurrentStepDuration);
 
 				// get curve data
-				float InterpSpeed = SpeedCurve->GetFloatValue(GroupsData[GroupIndex].StepPercent);
-				float RelativeZ = HeightCurve->GetFloatValue(GroupsData[GroupIndex].StepPercent) * StepHeight;
+				float InterpSpeed = SpeedCurveTable.Eval(GroupsData[GroupIndex].StepPercent);
+				float RelativeZ = HeightCurveTable.Eval(GroupsData[GroupIndex].StepPercent) * StepHeight;
 
 				// animate all feet in group
 				for (int LegIndex : LegGroups[GroupIndex].LegIndices)
@@ -595,7 +879,7 @@ void FAnimNode_SPW::ComputeFeet()
 						// interp location vector
 						FMath::Lerp(LegsData[LegIndex].FootUnplantLocation, LegsData[LegIndex].FootTarget, InterpSpeed)
 						// add height
-						+ RelativeZ * OwnerPawn->GetActorUpVector();
+						+ RelativeZ * FrameInputs.GetActorUpVector();
 
 					// add moving platform delta
 					LegsData[LegIndex].FootUnplantLocation += LegsData[LegIndex].SupportCompDelta;
@@ -610,8 +894,8 @@ void FAnimNode_SPW::ComputeFeet()
 					float FootDistanceFromLocation = FVector::Dist(
 						// foot location
 						LegsData[LegIndex].FootLocation
-						// actual socket
-						, SkeletalMeshComponent->GetSocketLocation(Legs[LegIndex].TipBone.BoneName));
+						// actual socket, as output by the last frame
+						, LegsOutputTipLocations[LegIndex]);
 
 					if (FootDistanceFromLocation <= (MinDistanceToUnplant * DistanceCheckMultiplier))
 					{
@@ -658,6 +942,8 @@ void FAnimNode_SPW::SetGroupsPlanted()
 
 void FAnimNode_SPW::ComputeBodyTransform()
 {
+	SCOPE_CYCLE_COUNTER(STAT_SimpleProceduralWalk_ComputeBodyTransform);
+
 	FVector AverageFeetTargetsForward;
 	FVector AverageFeetTargetsBackwards;
 	FVector AverageFeetTargetsRight;
@@ -671,17 +957,15 @@ void FAnimNode_SPW::ComputeBodyTransform()
 	// debug
 	if (bDebug && bIsPlaying)
 	{
-		FVector AverageFeetTargetsForwardWorld = (FTransform(FRotator(0.f), AverageFeetTargetsForward, FVector(1.f)) * OwnerPawn->GetActorTransform()).GetLocation();
-		FVector AverageFeetTargetsBackwardsWorld = (FTransform(FRotator(0.f), AverageFeetTargetsBackwards, FVector(1.f)) * OwnerPawn->GetActorTransform()).GetLocation();
-		FVector AverageFeetTargetsRightdWorld = (FTransform(FRotator(0.f), AverageFeetTargetsRight, FVector(1.f)) * OwnerPawn->GetActorTransform()).GetLocation();
-		FVector AverageFeetTargetsLeftWorld = (FTransform(FRotator(0.f), AverageFeetTargetsLeft, FVector(1.f)) * OwnerPawn->GetActorTransform()).GetLocation();
-
-		AsyncTask(ENamedThreads::GameThread, [=]() {
-			DrawDebugSphere(WorldContext, AverageFeetTargetsForwardWorld, 5.f, 12, FColor::FromHex("0013FF"));
-			DrawDebugSphere(WorldContext, AverageFeetTargetsBackwardsWorld, 5.f, 12, FColor::FromHex("0013FF"));
-			DrawDebugSphere(WorldContext, AverageFeetTargetsRightdWorld, 5.f, 12, FColor::FromHex("00C5FF"));
-			DrawDebugSphere(WorldContext, AverageFeetTargetsLeftWorld, 5.f, 12, FColor::FromHex("00C5FF"));
-		});
+		FVector AverageFeetTargetsForwardWorld = (FTransform(FRotator(0.f), AverageFeetTargetsForward, FVector(1.f)) * FrameInputs.GetActorTransform()).GetLocation();
+		FVector AverageFeetTargetsBackwardsWorld = (FTransform(FRotator(0.f), AverageFeetTargetsBackwards, FVector(1.f)) * FrameInputs.GetActorTransform()).GetLocation();
+		FVector AverageFeetTargetsRightdWorld = (FTransform(FRotator(0.f), AverageFeetTargetsRight, FVector(1.f)) * FrameInputs.GetActorTransform()).GetLocation();
+		FVector AverageFeetTargetsLeftWorld = (FTransform(FRotator(0.f), AverageFeetTargetsLeft, FVector(1.f)) * FrameInputs.GetActorTransform()).GetLocation();
+
+		DebugDrawBuffer.AddSphere(AverageFeetTargetsForwardWorld, 5.f, FColor::FromHex("0013FF"));
+		DebugDrawBuffer.AddSphere(AverageFeetTargetsBackwardsWorld, 5.f, FColor::FromHex("0013FF"));
+		DebugDrawBuffer.AddSphere(AverageFeetTargetsRightdWorld, 5.f, FColor::FromHex("00C5FF"));
+		DebugDrawBuffer.AddSphere(AverageFeetTargetsLeftWorld, 5.f, FColor::FromHex("00C5FF"));
 	}
 
 	ComputeBodyRotation(AverageFeetTargetsForward, AverageFeetTargetsBackwards, AverageFeetTargetsRight, AverageFeetTargetsLeft);
@@ -689,15 +973,13 @@ void FAnimNode_SPW::ComputeBodyTransform()
 
 	if (bDebug && bIsPlaying)
 	{
-		float MeshBoxSize = SkeletalMeshComponent->SkeletalMesh->GetBounds().BoxExtent.Size();
+		float MeshBoxSize = GameThreadSnapshot.MeshBoxSize;
 		FTransform DebugBoxTransform = FTransform(
-			OwnerPawn->GetActorRotation() + CurrentBodyRelRotation
-			, OwnerPawn->GetActorLocation() + CurrentBodyRelLocation
+			FrameInputs.GetActorRotation() + CurrentBodyRelRotation
+			, FrameInputs.GetActorLocation() + CurrentBodyRelLocation
 			, FVector(1.f));
 
-		AsyncTask(ENamedThreads::GameThread, [=]() {
-			DrawDebugCoordinateSystem(WorldContext, DebugBoxTransform.GetLocation(), DebugBoxTransform.Rotator(), MeshBoxSize * 1.5, false, -1.f, 0, 1.f);
-		});
+		DebugDrawBuffer.AddCoordinateSystem(DebugBoxTransform.GetLocation(), DebugBoxTransform.Rotator(), MeshBoxSize * 1.5, 1.f);
 	}
 }
 
@@ -770,15 +1052,15 @@ void FAnimNode_SPW::ComputeBodyLocation(FVector AverageFeetTargetsForward
 	, FVector AverageFeetTargetsLeft)
 {
 	// get average feet locations
-	TArray<FVector> FeetLocations;
+	FVector FeetLocationsSum(0.f);
 	for (int LegIndex = 0; LegIndex < Legs.Num(); LegIndex++)
 	{
-		FeetLocations.Add(LegsData[LegIndex].FootLocation);
+		FeetLocationsSum += LegsData[LegIndex].FootLocation;
 	}
-	FVector AverageFeetLocation = UKismetMathLibrary::GetVectorArrayAverage(FeetLocations);
+	FVector AverageFeetLocation = GetAverageLocation(FeetLocationsSum, Legs.Num());
 
 	// feet locations relative to actor
-	FVector AverageFeetRelLocation = UKismetMathLibrary::InverseTransformLocation(OwnerPawn->GetActorTransform(), AverageFeetLocation);
+	FVector AverageFeetRelLocation = UKismetMathLibrary::InverseTransformLocation(FrameInputs.GetActorTransform(), AverageFeetLocation);
 
 	// Z reduction due to slope
 	float ReduceZForFeetLocations = FMath::Clamp(
@@ -809,41 +1091,49 @@ void FAnimNode_SPW::GetAverageFeetTargets(FVector* AverageFeetTargetsForward
 	, FVector* AverageFeetTargetsRight
 	, FVector* AverageFeetTargetsLeft)
 {
-	// create foot forward / backwards / right / left location arrays
-	TArray<FVector> FeetTargetsForward;
-	TArray<FVector> FeetTargetsBackwards;
-	TArray<FVector> FeetTargetsRight;
-	TArray<FVector> FeetTargetsLeft;
+	// sum foot forward / backwards / right / left locations
+	FVector FeetTargetsForwardSum(0.f);
+	FVector FeetTargetsBackwardsSum(0.f);
+	FVector FeetTargetsRightSum(0.f);
+	FVector FeetTargetsLeftSum(0.f);
+	int32 NumFeetTargetsForward = 0;
+	int32 NumFeetTargetsBackwards = 0;
+	int32 NumFeetTargetsRight = 0;
+	int32 NumFeetTargetsLeft = 0;
 
 	for (int LegIndex = 0; LegIndex < Legs.Num(); LegIndex++)
 	{
 		// get local target transform
-		FVector FTarget = UKismetMathLibrary::InverseTransformLocation(OwnerPawn->GetActorTransform(), LegsData[LegIndex].FootTarget);
+		FVector FTarget = UKismetMathLibrary::InverseTransformLocation(FrameInputs.GetActorTransform(), LegsData[LegIndex].FootTarget);
 		// add to front / backwards
 		if (LegsData[LegIndex].bIsForward)
 		{
-			FeetTargetsForward.Add(FTarget);
+			FeetTargetsForwardSum += FTarget;
+			++NumFeetTargetsForward;
 		}
 		if (LegsData[LegIndex].bIsBackwards)
 		{
-			FeetTargetsBackwards.Add(FTarget);
+			FeetTargetsBackwardsSum += FTarget;
+			++NumFeetTargetsBackwards;
 		}
 
 		// add to right / left
 		if (LegsData[LegIndex].bIsRight)
 		{
-			FeetTargetsRight.Add(FTarget);
+			FeetTargetsRightSum += FTarget;
+			++NumFeetTargetsRight;
 		}
 		if (LegsData[LegIndex].bIsLeft)
 		{
-			FeetTargetsLeft.Add(FTarget);
+			FeetTargetsLeftSum += FTarget;
+			++NumFeetTargetsLeft;
 		}
 	}
 
-	*AverageFeetTargetsForward = UKismetMathLibrary::GetVectorArrayAverage(FeetTargetsForward);
-	*AverageFeetTargetsBackwards = UKismetMathLibrary::GetVectorArrayAverage(FeetTargetsBackwards);
-	*AverageFeetTargetsRight = UKismetMathLibrary::GetVectorArrayAverage(FeetTargetsRight);
-	*AverageFeetTargetsLeft = UKismetMathLibrary::GetVectorArrayAverage(FeetTargetsLeft);
+	*AverageFeetTargetsForward = GetAverageLocation(FeetTargetsForwardSum, NumFeetTargetsForward);
+	*AverageFeetTargetsBackwards = GetAverageLocation(FeetTargetsBackwardsSum, NumFeetTargetsBackwards);
+	*AverageFeetTargetsRight = GetAverageLocation(FeetTargetsRightSum, NumFeetTargetsRight);
+	*AverageFeetTargetsLeft = GetAverageLocation(FeetTargetsLeftSum, NumFeetTargetsLeft);
 }
 
 void FAnimNode_SPW::ResetFeetTargetsAndLocations()
@@ -854,7 +1144,7 @@ void FAnimNode_SPW::ResetFeetTargetsAndLocations()
 	// reset feet
 	for (int LegIndex = 0; LegIndex < Legs.Num(); LegIndex++)
 	{
-		FVector FootLocation = (FTransform(FRotator(0.f), LegsData[LegIndex].TipBoneOriginalRelLocation, FVector(1.f)) * OwnerPawn->GetActorTransform()).GetLocation();
+		FVector FootLocation = (FTransform(FRotator(0.f), LegsData[LegIndex].TipBoneOriginalRelLocation, FVector(1.f)) * FrameInputs.GetActorTransform()).GetLocation();
 		LegsData[LegIndex].FootLocation = FootLocation;
 		LegsData[LegIndex].FootUnplantLocation = FootLocation;
 	}
@@ -877,15 +1167,11 @@ void FAnimNode_SPW::DebugShow()
 	{
 		for (int LegIndex = 0; LegIndex < Legs.Num(); LegIndex++)
 		{
-			AsyncTask(ENamedThreads::GameThread, [=]() {
-				DrawDebugSphere(WorldContext, LegsData[LegIndex].FootLocation, 10.f, 12, FColor::White);
-			});
+			DebugDrawBuffer.AddSphere(LegsData[LegIndex].FootLocation, 10.f, FColor::White);
 
 			if (IsLegUnplanted(LegIndex))
 			{
-				AsyncTask(ENamedThreads::GameThread, [=]() {
-					DrawDebugSphere(WorldContext, LegsData[LegIndex].FootUnplantLocation, 10.f, 12, FColor::Yellow);
-				});
+				DebugDrawBuffer.AddSphere(LegsData[LegIndex].FootUnplantLocation, 10.f, FColor::Yellow);
 			}
 		}
 		/*
@@ -935,17 +1221,15 @@ void FAnimNode_SPW::EditorDebugShow(AActor* SkeletalMeshOwner)
 		}
 
 		// draw coordinate system
-		float MeshBoxSize = SkeletalMeshComponent->SkeletalMesh->GetBounds().BoxExtent.Size();
+		float MeshBoxSize = GameThreadSnapshot.MeshBoxSize;
 
-		AsyncTask(ENamedThreads::GameThread, [=]() {
-			DrawDebugCoordinateSystem(WorldContext, FVector(0.f, 0.f, 0.f), EditorPreviewRotation, MeshBoxSize * 1.5, false, -1.f, 0, 1.f);
-		});
+		DebugDrawBuffer.AddCoordinateSystem(FVector(0.f, 0.f, 0.f), EditorPreviewRotation, MeshBoxSize * 1.5, 1.f);
 
 		// loop feet
 		for (int LegIndex = 0; LegIndex < Legs.Num(); LegIndex++)
 		{
 			// get foot data
-			FSimpleProceduralWalk_Leg Leg = Legs[LegIndex];
+			const FSimpleProceduralWalk_Leg& Leg = Legs[LegIndex];
 
 			// Parent Bone Location
 			FVector ParentBoneLocation = SkeletalMeshComponent->GetSocketLocation(Leg.ParentBone.BoneName);
@@ -982,15 +1266,12 @@ void FAnimNode_SPW::EditorDebugShow(AActor* SkeletalMeshOwner)
 			FTransform DebugTransform = FTransform(SkeletalMeshOwner->GetActorRotation(), Hit.ImpactPoint, FVector(1.f));
 
 			// line
-			AsyncTask(ENamedThreads::GameThread, [=]() {
-				// draw line
-				DrawDebugLine(WorldContext, StartLocation, EndLocation, (bIsHit ? FColor::Green : FColor::Red));
-				// hit point
-				if (bIsHit)
-				{
-					DrawDebugSolidBox(WorldContext, FBox(FVector(-2.f, -2.f, 0.f), FVector(2.f, 2.f, 2.f)), FColor::Green, DebugTransform);
-				}
-			});
+			DebugDrawBuffer.AddLine(StartLocation, EndLocation, (bIsHit ? FColor::Green : FColor::Red));
+			// hit point
+			if (bIsHit)
+			{
+				DebugDrawBuffer.AddSolidBox(FBox(FVector(-2.f, -2.f, 0.f), FVector(2.f, 2.f, 2.f)), FColor::Green, DebugTransform);
+			}
 		}
 	}
 }
@@ -998,76 +1279,70 @@ void FAnimNode_SPW::EditorDebugShow(AActor* SkeletalMeshOwner)
 // ---------- \/ ix ----------
 void FAnimNode_SPW::CallStepInterfaces(int32 GroupIndex, bool bIsDown)
 {
-	UE_LOG(LogSimpleProceduralWalk, Verbose, TEXT("Calling Step interfaces."));
-
-	// pawn
-	if (OwnerPawn->GetClass()->ImplementsInterface(USimpleProceduralWalkInterface::StaticClass()))
+	if (bIsReplaying)
 	{
-		CallStepInterface(OwnerPawn, GroupIndex, bIsDown);
-	}
-	// anim instance
-	if (SkeletalMeshComponent->GetAnimInstance()->GetClass()->ImplementsInterface(USimpleProceduralWalkInterface::StaticClass()))
-	{
-		CallStepInterface(SkeletalMeshComponent->GetAnimInstance(), GroupIndex, bIsDown);
+		// no world to notify
+		return;
 	}
-}
 
-void FAnimNode_SPW::CallStepInterface(UObject* InterfaceOwner, int32 GroupIndex, bool bIsDown)
-{
-	TArray<FVector> GroupFeetLocations;
+	UE_LOG(LogSimpleProceduralWalk, Verbose, TEXT("Queueing Step events."));
+
+	FVector GroupFeetLocationsSum(0.f);
 
 	// per foot event, loop feet in group
 	for (int LegIndex : LegGroups[GroupIndex].LegIndices)
 	{
-		GroupFeetLocations.Add(LegsData[LegIndex].FootLocation);
+		GroupFeetLocationsSum += LegsData[LegIndex].FootLocation;
 
-		if (bIsDown)
-		{
-			AsyncTask(ENamedThreads::GameThread, [=]() {
-				ISimpleProceduralWalkInterface::Execute_OnFootDown(InterfaceOwner, LegIndex, Legs[LegIndex].TipBone.BoneName, LegsData[LegIndex].FootLocation);
-			});
-		}
-		else
-		{
-			AsyncTask(ENamedThreads::GameThread, [=]() {
-				ISimpleProceduralWalkInterface::Execute_OnFootUp(InterfaceOwner, LegIndex, Legs[LegIndex].TipBone.BoneName, LegsData[LegIndex].FootLocation);
-			});
-		}
+		InterfaceEventQueue->Enqueue(FSPW_InterfaceEvent(bIsDown ? ESPW_InterfaceEventType::FootDown : ESPW_InterfaceEventType::FootUp
+			, LegIndex
+			, Legs[LegIndex].TipBone.BoneName
+			, LegsData[LegIndex].FootLocation));
 	}
 
 	// group event
-	FVector AverageFeetLocation = UKismetMathLibrary::GetVectorArrayAverage(GroupFeetLocations);
-	if (bIsDown)
+	FVector AverageFeetLocation = GetAverageLocation(GroupFeetLocationsSum, LegGroups[GroupIndex].LegIndices.Num());
+	InterfaceEventQueue->Enqueue(FSPW_InterfaceEvent(bIsDown ? ESPW_InterfaceEventType::GroupDown : ESPW_InterfaceEventType::GroupUp
+		, GroupIndex
+		, NAME_None
+		, AverageFeetLocation));
+}
+
+// ---------- \/ helpers ----------
+void FAnimNode_SPW::SetSupportComponentData(int32 LegIndex, FVector RefLocation)
+{
+	FSimpleProceduralWalk_LegData& LegData = LegsData[LegIndex];
+
+	// support component (added before removing the previous one, to keep the entry when it is the same)
+	int32 PreviousSupportCompIndex = LegData.SupportCompIndex;
+	LegData.SupportCompIndex = SupportCompTable.AddLeg(LegData.LastHit.GetComponent());
+	SupportCompTable.RemoveLeg(PreviousSupportCompIndex);
+
+	LegData.bIsSupportCompPending = false;
+	if (LegData.SupportCompIndex == INDEX_NONE)
 	{
-		AsyncTask(ENamedThreads::GameThread, [=]() {
-			ISimpleProceduralWalkInterface::Execute_OnGroupDown(InterfaceOwner, GroupIndex, AverageFeetLocation);
-		});
+		/* -> no support or static one */
+		return;
+	}
+
+	const FSPW_SupportComp& SupportComp = SupportCompTable[LegData.SupportCompIndex];
+	if (SupportComp.bHasTransform)
+	{
+		// store relative unplant location, as of the snapshot
+		LegData.RelLocationToSupportComp = SupportComp.Transform.InverseTransformPosition(RefLocation);
 	}
 	else
 	{
-		AsyncTask(ENamedThreads::GameThread, [=]() {
-			ISimpleProceduralWalkInterface::Execute_OnGroupUp(InterfaceOwner, GroupIndex, AverageFeetLocation);
-		});
+		/* -> new support, its transform is read by the next snapshot */
+		LegData.bIsSupportCompPending = true;
+		LegData.SupportCompRefLocation = RefLocation;
 	}
 }
 
-// ---------- \/ helpers ----------
-void FAnimNode_SPW::SetSupportComponentData(int32 LegIndex, FVector RefLocation)
+FVector FAnimNode_SPW::GetAverageLocation(const FVector& LocationsSum, int32 NumLocations)
 {
-	// support component
-	LegsData[LegIndex].SupportComp = LegsData[LegIndex].LastHit.GetComponent();
-	if (IsValid(LegsData[LegIndex].SupportComp))
-	{
-		// store current component transform
-		LegsData[LegIndex].SupportCompPreviousTransform = LegsData[LegIndex].SupportComp->GetComponentTransform();
-
-		// store relative unplant location
-		LegsData[LegIndex].RelLocationToSupportComp = UKismetMathLibrary::InverseTransformLocation(
-			// component tranform
-			LegsData[LegIndex].SupportComp->GetComponentTransform()
-			// ref locations
-			, RefLocation);
-	}
+	// same as GetVectorArrayAverage, without the array
+	return NumLocations > 0 ? LocationsSum / (float)NumLocations : FVector(0.f);
 }
 
 float FAnimNode_SPW::GetReductionSlopeMultiplier()
@@ -1077,12 +1352,12 @@ float FAnimNode_SPW::GetReductionSlopeMultiplier()
 
 bool FAnimNode_SPW::IsLegUnplanted(int32 LegIndex)
 {
-	return GroupsData[LegsData[LegIndex].GroupIndex].bIsUnplanted;
+	return GroupsData[RigDescriptor->LegsGroupIndex[LegIndex]].bIsUnplanted;
 }
 
 float FAnimNode_SPW::GetLegStepPercent(int32 LegIndex)
 {
-	return GroupsData[LegsData[LegIndex].GroupIndex].StepPercent;
+	return GroupsData[RigDescriptor->LegsGroupIndex[LegIndex]].StepPercent;
 }
 
 void FAnimNode_SPW::SetNextCurrentGroupIndex()
@@ -0,0 +1,135 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#include "SPW_CurveTable.h"
+#include "Curves/RichCurve.h"
+
+// constants
+static const int32 NUM_SEGMENT_CHECKS = 4;
+
+
+void FSPW_CurveTable::Bake(const FRichCurve& Curve, float Tolerance)
+{
+	NumKnots = 0;
+
+	// keys, with the value before & after each step
+	AddKnot(0.f, Curve.Eval(0.f));
+
+	const TArray<FRichCurveKey>& Keys = Curve.GetConstRefOfKeys();
+	for (int32 KeyIndex = 0; KeyIndex < Keys.Num(); KeyIndex++)
+	{
+		const float KeyTime = Keys[KeyIndex].Time;
+		if (KeyTime <= 0.f || KeyTime >= 1.f || NumKnots >= MaxKnots - 2)
+		{
+			continue;
+		}
+
+		if (KeyIndex > 0 && Keys[KeyIndex - 1].InterpMode == RCIM_Constant)
+		{
+			AddKnot(KeyTime, Keys[KeyIndex - 1].Value);
+		}
+		AddKnot(KeyTime, Curve.Eval(KeyTime));
+	}
+
+	AddKnot(1.f, Curve.Eval(1.f));
+
+	// split the segment that is the furthest from the curve, until it is followed
+	while (NumKnots < MaxKnots)
+	{
+		int32 WorstKnotIndex = INDEX_NONE;
+		float WorstError = Tolerance;
+		for (int32 KnotIndex = 0; KnotIndex < NumKnots - 1; KnotIndex++)
+		{
+			const float Error = GetSegmentError(Curve, KnotIndex);
+			if (Error > WorstError)
+			{
+				WorstKnotIndex = KnotIndex;
+				WorstError = Error;
+			}
+		}
+
+		if (WorstKnotIndex == INDEX_NONE)
+		{
+			break;
+		}
+
+		/* -> insert a knot in the middle of the segment */
+		for (int32 KnotIndex = NumKnots; KnotIndex > WorstKnotIndex + 1; KnotIndex--)
+		{
+			Times[KnotIndex] = Times[KnotIndex - 1];
+			Values[KnotIndex] = Values[KnotIndex - 1];
+		}
+		const float Time = .5f * (Times[WorstKnotIndex] + Times[WorstKnotIndex + 2]);
+		Times[WorstKnotIndex + 1] = Time;
+		Values[WorstKnotIndex + 1] = Curve.Eval(Time);
+		NumKnots++;
+	}
+
+	BuildCells();
+}
+
+void FSPW_CurveTable::SetConstant(float Value)
+{
+	NumKnots = 2;
+	Times[0] = 0.f;
+	Times[1] = 1.f;
+	Values[0] = Value;
+	Values[1] = Value;
+
+	BuildCells();
+}
+
+float FSPW_CurveTable::GetMaxError(const FRichCurve& Curve, int32 NumChecks) const
+{
+	NumChecks = FMath::Max(NumChecks, 1);
+	float MaxError = 0.f;
+
+	for (int32 CheckIndex = 0; CheckIndex <= NumChecks; CheckIndex++)
+	{
+		const float Time = (float)CheckIndex / NumChecks;
+		MaxError = FMath::Max(MaxError, FMath::Abs(Eval(Time) - Curve.Eval(Time)));
+	}
+
+	return MaxError;
+}
+
+void FSPW_CurveTable::AddKnot(float Time, float Value)
+{
+	Times[NumKnots] = Time;
+	Values[NumKnots] = Value;
+	NumKnots++;
+}
+
+float FSPW_CurveTable::GetSegmentError(const FRichCurve& Curve, int32 KnotIndex) const
+{
+	const float StartTime = Times[KnotIndex];
+	const float SegmentDuration = Times[KnotIndex + 1] - StartTime;
+	if (SegmentDuration <= 0.f)
+	{
+		/* -> step */
+		return 0.f;
+	}
+
+	float MaxError = 0.f;
+	for (int32 CheckIndex = 1; CheckIndex <= NUM_SEGMENT_CHECKS; CheckIndex++)
+	{
+		const float Alpha = (float)CheckIndex / (NUM_SEGMENT_CHECKS + 1);
+		const float Value = FMath::Lerp(Values[KnotIndex], Values[KnotIndex + 1], Alpha);
+		MaxError = FMath::Max(MaxError, FMath::Abs(Value - Curve.Eval(StartTime + Alpha * SegmentDuration)));
+	}
+
+	return MaxError;
+}
+
+void FSPW_CurveTable::BuildCells()
+{
+	int32 KnotIndex = 0;
+	for (int32 CellIndex = 0; CellIndex < NumCells; CellIndex++)
+	{
+		const float CellTime = (float)CellIndex / NumCells;
+		while (KnotIndex < NumKnots - 2 && Times[KnotIndex + 1] <= CellTime)
+		{
+			KnotIndex++;
+		}
+		CellKnots[CellIndex] = (uint8)KnotIndex;
+	}
+}
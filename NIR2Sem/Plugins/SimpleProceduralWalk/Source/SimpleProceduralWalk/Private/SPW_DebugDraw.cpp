@@ -0,0 +1,93 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#include "SPW_DebugDraw.h"
+#include "Async/Async.h"
+#include "DrawDebugHelpers.h"
+#include "Engine/World.h"
+
+// constants
+static const int32 DEBUG_SPHERE_SEGMENTS = 12;
+
+
+FSPW_DebugPrimitive& FSPW_DebugDrawBuffer::AddPrimitive(ESPW_DebugPrimitiveType Type, const FColor& Color)
+{
+	FSPW_DebugPrimitive& Primitive = Primitives.AddDefaulted_GetRef();
+	Primitive.Type = Type;
+	Primitive.Color = Color;
+	return Primitive;
+}
+
+void FSPW_DebugDrawBuffer::AddSphere(const FVector& Center, float Radius, const FColor& Color, float LifeTime)
+{
+	FSPW_DebugPrimitive& Primitive = AddPrimitive(ESPW_DebugPrimitiveType::Sphere, Color);
+	Primitive.Transform.SetLocation(Center);
+	Primitive.Size = Radius;
+	Primitive.LifeTime = LifeTime;
+}
+
+void FSPW_DebugDrawBuffer::AddLine(const FVector& Start, const FVector& End, const FColor& Color)
+{
+	FSPW_DebugPrimitive& Primitive = AddPrimitive(ESPW_DebugPrimitiveType::Line, Color);
+	Primitive.Transform.SetLocation(Start);
+	Primitive.Vector = End;
+}
+
+void FSPW_DebugDrawBuffer::AddSolidBox(const FBox& Box, const FColor& Color, const FTransform& Transform)
+{
+	// as DrawDebugSolidBox: the box is centered in its transform
+	FSPW_DebugPrimitive& Primitive = AddPrimitive(ESPW_DebugPrimitiveType::SolidBox, Color);
+	Primitive.Transform = FTransform(Box.GetCenter()) * Transform;
+	Primitive.Vector = Box.GetExtent();
+}
+
+void FSPW_DebugDrawBuffer::AddCoordinateSystem(const FVector& Location, const FRotator& Rotation, float Scale, float Thickness)
+{
+	FSPW_DebugPrimitive& Primitive = AddPrimitive(ESPW_DebugPrimitiveType::CoordinateSystem, FColor::White);
+	Primitive.Transform = FTransform(Rotation, Location);
+	Primitive.Size = Scale;
+	Primitive.Thickness = Thickness;
+}
+
+void FSPW_DebugDrawBuffer::Flush(UWorld* World)
+{
+	if (Primitives.Num() == 0)
+	{
+		return;
+	}
+
+	// one task for all the shapes of the frame
+	TWeakObjectPtr<UWorld> WorldPtr = World;
+	AsyncTask(ENamedThreads::GameThread, [WorldPtr, FramePrimitives = MoveTemp(Primitives)]() {
+		if (UWorld* FlushedWorld = WorldPtr.Get())
+		{
+			Draw(FlushedWorld, FramePrimitives);
+		}
+	});
+
+	Primitives.Reset();
+}
+
+void FSPW_DebugDrawBuffer::Draw(UWorld* World, const TArray<FSPW_DebugPrimitive>& InPrimitives)
+{
+	for (const FSPW_DebugPrimitive& Primitive : InPrimitives)
+	{
+		const bool bPersistentLines = false;
+
+		switch (Primitive.Type)
+		{
+		case ESPW_DebugPrimitiveType::Sphere:
+			DrawDebugSphere(World, Primitive.Transform.GetLocation(), Primitive.Size, DEBUG_SPHERE_SEGMENTS, Primitive.Color, bPersistentLines, Primitive.LifeTime);
+			break;
+		case ESPW_DebugPrimitiveType::Line:
+			DrawDebugLine(World, Primitive.Transform.GetLocation(), Primitive.Vector, Primitive.Color);
+			break;
+		case ESPW_DebugPrimitiveType::SolidBox:
+			DrawDebugSolidBox(World, Primitive.Transform.GetLocation(), Primitive.Vector, Primitive.Transform.GetRotation(), Primitive.Color);
+			break;
+		case ESPW_DebugPrimitiveType::CoordinateSystem:
+			DrawDebugCoordinateSystem(World, Primitive.Transform.GetLocation(), Primitive.Transform.Rotator(), Primitive.Size
+				, bPersistentLines, Primitive.LifeTime, 0, Primitive.Thickness);
+			break;
+		}
+	}
+}
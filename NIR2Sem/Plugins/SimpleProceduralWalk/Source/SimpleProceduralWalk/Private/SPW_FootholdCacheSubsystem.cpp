@@ -0,0 +1,360 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#include "SPW_FootholdCacheSubsystem.h"
+#include "SPW.h"
+#include "Components/PrimitiveComponent.h"
+#include "Engine/Level.h"
+#include "Engine/World.h"
+#include "PhysicalMaterials/PhysicalMaterial.h"
+
+// constants
+static const float CELL_SIZE = 10.f;
+static const int32 MAX_ENTRIES = 65536;
+static const int32 MAX_PENDING_HITS = 4096;
+// hits on the same surface
+static const float MIN_IMPACT_NORMAL_DOT = .99f;
+static const float MAX_IMPACT_HEIGHT_DIFFERENCE = 5.f;
+// how far from the sampled area a hit is reused
+static const float SAMPLE_BOUNDS_MARGIN = 2.f;
+// grazing traces are not intersected with the cached surface
+static const float MIN_SURFACE_FACING = .1f;
+static const float STALE_ENTRIES_REMOVAL_INTERVAL = 1.f;
+
+// stats
+DECLARE_DWORD_COUNTER_STAT(TEXT("Foothold Cache Invalidations"), STAT_SimpleProceduralWalk_NumFootholdCacheInvalidations, STATGROUP_SimpleProceduralWalk);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Foothold Cache Entries"), STAT_SimpleProceduralWalk_NumFootholdCacheEntries, STATGROUP_SimpleProceduralWalk);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Foothold Cache Hit Rate"), STAT_SimpleProceduralWalk_FootholdCacheHitRate, STATGROUP_SimpleProceduralWalk);
+
+
+void USPW_FootholdCacheSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	PendingHits.Reserve(MAX_PENDING_HITS);
+	PendingHitsToAdd.Reserve(MAX_PENDING_HITS);
+
+	LevelAddedHandle = FWorldDelegates::LevelAddedToWorld.AddUObject(this, &USPW_FootholdCacheSubsystem::OnLevelAdded);
+	LevelRemovedHandle = FWorldDelegates::LevelRemovedFromWorld.AddUObject(this, &USPW_FootholdCacheSubsystem::OnLevelRemoved);
+}
+
+void USPW_FootholdCacheSubsystem::Deinitialize()
+{
+	FWorldDelegates::LevelAddedToWorld.Remove(LevelAddedHandle);
+	FWorldDelegates::LevelRemovedFromWorld.Remove(LevelRemovedHandle);
+
+	Flush();
+
+	Super::Deinitialize();
+}
+
+void USPW_FootholdCacheSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	AddPendingHits();
+
+	TimeSinceStaleEntriesRemoval += DeltaTime;
+	if (TimeSinceStaleEntriesRemoval >= STALE_ENTRIES_REMOVAL_INTERVAL)
+	{
+		RemoveStaleEntries();
+		TimeSinceStaleEntriesRemoval = 0.f;
+	}
+
+	SET_FLOAT_STAT(STAT_SimpleProceduralWalk_FootholdCacheHitRate, GetHitRate());
+}
+
+TStatId USPW_FootholdCacheSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(USPW_FootholdCacheSubsystem, STATGROUP_Tickables);
+}
+
+bool USPW_FootholdCacheSubsystem::FindHit(const FVector& Start
+	, const FVector& End
+	, ECollisionChannel TraceChannel
+	, bool bTraceComplex
+	, FHitResult& OutHit)
+{
+	const FVector Trace = End - Start;
+	const float TraceLength = Trace.Size();
+	if (FMath::IsNearlyZero(TraceLength))
+	{
+		return false;
+	}
+	const FVector TraceDirection = Trace / TraceLength;
+
+	NumQueries.Increment();
+
+	FReadScopeLock ReadLock(Lock);
+
+	// hits are keyed by their impact cell: downwards traces reach the surface of the cell they start from
+	FCellKey Key = MakeKey(Start, TraceChannel, bTraceComplex);
+	float Distance = 0.f;
+	FVector ImpactPoint(0.f);
+	const FEntry* Entry = FindSurface(Key, Start, TraceDirection, Distance, ImpactPoint);
+	if (Entry == nullptr)
+	{
+		return false;
+	}
+
+	const FCellKey ImpactKey = MakeKey(ImpactPoint, TraceChannel, bTraceComplex);
+	if (ImpactKey != Key)
+	{
+		/* -> slanted trace, reaching the ground in a neighbour cell */
+		Key = ImpactKey;
+		Entry = FindSurface(Key, Start, TraceDirection, Distance, ImpactPoint);
+		if (Entry == nullptr || MakeKey(ImpactPoint, TraceChannel, bTraceComplex) != Key)
+		{
+			return false;
+		}
+	}
+
+	// within the trace, & where the surface was sampled
+	if (Distance > TraceLength || !Entry->SampleBounds.ExpandBy(SAMPLE_BOUNDS_MARGIN).IsInside(FVector2D(ImpactPoint)))
+	{
+		return false;
+	}
+
+	OutHit = FHitResult(Start, End);
+	OutHit.bBlockingHit = true;
+	OutHit.Time = Distance / TraceLength;
+	OutHit.Distance = Distance;
+	OutHit.Location = ImpactPoint;
+	OutHit.ImpactPoint = ImpactPoint;
+	OutHit.Normal = Entry->ImpactNormal;
+	OutHit.ImpactNormal = Entry->ImpactNormal;
+	OutHit.Component = Entry->Component;
+	OutHit.HitObjectHandle = Entry->HitObjectHandle;
+	OutHit.PhysMaterial = Entry->PhysMaterial;
+
+	NumQueryHits.Increment();
+	return true;
+}
+
+void USPW_FootholdCacheSubsystem::AddHit(const FVector& Start
+	, const FVector& End
+	, ECollisionChannel TraceChannel
+	, bool bTraceComplex
+	, const FHitResult& Hit)
+{
+	if (!Hit.bBlockingHit)
+	{
+		return;
+	}
+
+	FScopeLock PendingHitsLock(&PendingHitsCriticalSection);
+
+	if (PendingHits.Num() >= MAX_PENDING_HITS)
+	{
+		/* -> enough for this frame */
+		return;
+	}
+
+	// the component is only read on the game thread
+	FPendingHit& PendingHit = PendingHits.AddDefaulted_GetRef();
+	PendingHit.Key = MakeKey(Hit.ImpactPoint, TraceChannel, bTraceComplex);
+	PendingHit.Entry.ImpactPoint = Hit.ImpactPoint;
+	PendingHit.Entry.ImpactNormal = Hit.ImpactNormal;
+	PendingHit.Entry.SampleBounds = FBox2D(FVector2D(Hit.ImpactPoint), FVector2D(Hit.ImpactPoint));
+	PendingHit.Entry.ClearHeight = FVector::DotProduct(Start - Hit.ImpactPoint, Hit.ImpactNormal);
+	PendingHit.Entry.Component = Hit.Component;
+	PendingHit.Entry.PhysMaterial = Hit.PhysMaterial;
+}
+
+void USPW_FootholdCacheSubsystem::AddPendingHits()
+{
+	check(IsInGameThread());
+
+	{
+		FScopeLock PendingHitsLock(&PendingHitsCriticalSection);
+		Swap(PendingHits, PendingHitsToAdd);
+	}
+
+	if (PendingHitsToAdd.Num() == 0)
+	{
+		return;
+	}
+
+	{
+		FWriteScopeLock WriteLock(Lock);
+
+		for (FPendingHit& PendingHit : PendingHitsToAdd)
+		{
+			const UPrimitiveComponent* Component = PendingHit.Entry.Component.Get();
+			if (!IsStatic(Component))
+			{
+				continue;
+			}
+
+			FEntry* CachedEntry = Entries.Find(PendingHit.Key);
+			if (CachedEntry != nullptr)
+			{
+				if (CachedEntry->bIsUniform && IsSameSurface(*CachedEntry, PendingHit.Entry))
+				{
+					/* -> the surface extends to this hit */
+					CachedEntry->SampleBounds += PendingHit.Entry.SampleBounds;
+					CachedEntry->ClearHeight = FMath::Min(CachedEntry->ClearHeight, PendingHit.Entry.ClearHeight);
+				}
+				else
+				{
+					/* -> the cell spans different surfaces, e.g. a step edge */
+					CachedEntry->bIsUniform = false;
+				}
+				continue;
+			}
+
+			PendingHit.Entry.Level = Component->GetComponentLevel();
+			PendingHit.Entry.HitObjectHandle = FActorInstanceHandle(Component->GetOwner());
+
+			if (Entries.Num() >= MAX_ENTRIES && !Entries.Contains(PendingHit.Key))
+			{
+				/* -> full, start over rather than tracking usage */
+				UE_LOG(LogSimpleProceduralWalk, Verbose, TEXT("Foothold cache is full, flushing %d entries."), Entries.Num());
+				Entries.Reset();
+			}
+
+			Entries.Add(PendingHit.Key, PendingHit.Entry);
+		}
+
+		SET_DWORD_STAT(STAT_SimpleProceduralWalk_NumFootholdCacheEntries, Entries.Num());
+	}
+
+	PendingHitsToAdd.Reset();
+}
+
+void USPW_FootholdCacheSubsystem::RemoveStaleEntries()
+{
+	check(IsInGameThread());
+
+	FWriteScopeLock WriteLock(Lock);
+
+	for (auto It = Entries.CreateIterator(); It; ++It)
+	{
+		if (!IsStatic(It.Value().Component.Get()) || !It.Value().Level.IsValid())
+		{
+			/* -> destroyed or not static anymore */
+			It.RemoveCurrent();
+			INC_DWORD_STAT(STAT_SimpleProceduralWalk_NumFootholdCacheInvalidations);
+		}
+	}
+
+	SET_DWORD_STAT(STAT_SimpleProceduralWalk_NumFootholdCacheEntries, Entries.Num());
+}
+
+void USPW_FootholdCacheSubsystem::Flush()
+{
+	{
+		FScopeLock PendingHitsLock(&PendingHitsCriticalSection);
+		PendingHits.Reset();
+	}
+
+	FWriteScopeLock WriteLock(Lock);
+	Entries.Empty();
+	NumQueries.Reset();
+	NumQueryHits.Reset();
+	SET_DWORD_STAT(STAT_SimpleProceduralWalk_NumFootholdCacheEntries, 0);
+}
+
+int32 USPW_FootholdCacheSubsystem::Num() const
+{
+	FReadScopeLock ReadLock(Lock);
+	return Entries.Num();
+}
+
+float USPW_FootholdCacheSubsystem::GetHitRate() const
+{
+	const int32 Queries = NumQueries.GetValue();
+	return Queries > 0 ? (float)NumQueryHits.GetValue() / Queries : 0.f;
+}
+
+const USPW_FootholdCacheSubsystem::FEntry* USPW_FootholdCacheSubsystem::FindSurface(const FCellKey& Key
+	, const FVector& Start
+	, const FVector& TraceDirection
+	, float& OutDistance
+	, FVector& OutImpactPoint) const
+{
+	const FEntry* Entry = Entries.Find(Key);
+	if (Entry == nullptr || !Entry->bIsUniform)
+	{
+		return nullptr;
+	}
+
+	const float Facing = -FVector::DotProduct(TraceDirection, Entry->ImpactNormal);
+	if (Facing < MIN_SURFACE_FACING)
+	{
+		return nullptr;
+	}
+
+	// the trace starts above the surface, in the height cleared by the cached traces, so it cannot hit anything else first
+	const float StartHeight = FVector::DotProduct(Start - Entry->ImpactPoint, Entry->ImpactNormal);
+	if (StartHeight < 0.f || StartHeight > Entry->ClearHeight + MAX_IMPACT_HEIGHT_DIFFERENCE)
+	{
+		return nullptr;
+	}
+
+	OutDistance = StartHeight / Facing;
+	OutImpactPoint = Start + TraceDirection * OutDistance;
+	return Entry;
+}
+
+USPW_FootholdCacheSubsystem::FCellKey USPW_FootholdCacheSubsystem::MakeKey(const FVector& Location, ECollisionChannel TraceChannel, bool bTraceComplex)
+{
+	FCellKey Key;
+	Key.Cell = FIntPoint(
+		FMath::FloorToInt(Location.X / CELL_SIZE),
+		FMath::FloorToInt(Location.Y / CELL_SIZE));
+	Key.TraceChannel = (uint8)TraceChannel;
+	Key.bTraceComplex = bTraceComplex;
+	return Key;
+}
+
+bool USPW_FootholdCacheSubsystem::IsStatic(const UPrimitiveComponent* Component)
+{
+	return IsValid(Component) && Component->Mobility == EComponentMobility::Static;
+}
+
+bool USPW_FootholdCacheSubsystem::IsSameSurface(const FEntry& Entry, const FEntry& OtherEntry)
+{
+	return Entry.Component == OtherEntry.Component
+		&& FVector::DotProduct(Entry.ImpactNormal, OtherEntry.ImpactNormal) >= MIN_IMPACT_NORMAL_DOT
+		&& FMath::Abs(FVector::DotProduct(OtherEntry.ImpactPoint - Entry.ImpactPoint, Entry.ImpactNormal)) <= MAX_IMPACT_HEIGHT_DIFFERENCE;
+}
+
+void USPW_FootholdCacheSubsystem::OnLevelAdded(ULevel* Level, UWorld* World)
+{
+	if (World != GetWorld())
+	{
+		return;
+	}
+
+	// new geometry may be above cached hits
+	Flush();
+}
+
+void USPW_FootholdCacheSubsystem::OnLevelRemoved(ULevel* Level, UWorld* World)
+{
+	if (World != GetWorld())
+	{
+		return;
+	}
+
+	FWriteScopeLock WriteLock(Lock);
+
+	if (Level == nullptr)
+	{
+		/* -> the whole world is going away */
+		Entries.Empty();
+	}
+	else
+	{
+		for (auto It = Entries.CreateIterator(); It; ++It)
+		{
+			if (!It.Value().Level.IsValid() || It.Value().Level.Get() == Level)
+			{
+				It.RemoveCurrent();
+				INC_DWORD_STAT(STAT_SimpleProceduralWalk_NumFootholdCacheInvalidations);
+			}
+		}
+	}
+
+	SET_DWORD_STAT(STAT_SimpleProceduralWalk_NumFootholdCacheEntries, Entries.Num());
+}
@@ -0,0 +1,160 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#include "SPW_FootholdSearch.h"
+
+
+// ---------- \/ candidates ----------
+void FSPW_FootholdCandidates::Reset(const FVector& InOrigin)
+{
+	Origin = InOrigin;
+
+	for (TArray<float>* Components : { &ImpactsX, &ImpactsY, &ImpactsZ, &NormalsX, &NormalsY, &NormalsZ })
+	{
+		Components->Reset();
+	}
+}
+
+void FSPW_FootholdCandidates::Reserve(int32 NumCandidates)
+{
+	for (TArray<float>* Components : { &ImpactsX, &ImpactsY, &ImpactsZ, &NormalsX, &NormalsY, &NormalsZ })
+	{
+		Components->Reserve(NumCandidates);
+	}
+}
+
+SIZE_T FSPW_FootholdCandidates::GetAllocatedSize() const
+{
+	SIZE_T AllocatedSize = 0;
+
+	for (const TArray<float>* Components : { &ImpactsX, &ImpactsY, &ImpactsZ, &NormalsX, &NormalsY, &NormalsZ })
+	{
+		AllocatedSize += Components->GetAllocatedSize();
+	}
+
+	return AllocatedSize;
+}
+
+void FSPW_FootholdCandidates::Add(const FVector& ImpactPoint, const FVector& ImpactNormal)
+{
+	// relative, so that single precision holds far from the world origin
+	const FVector RelImpactPoint = ImpactPoint - Origin;
+	ImpactsX.Add(RelImpactPoint.X);
+	ImpactsY.Add(RelImpactPoint.Y);
+	ImpactsZ.Add(RelImpactPoint.Z);
+	NormalsX.Add(ImpactNormal.X);
+	NormalsY.Add(ImpactNormal.Y);
+	NormalsZ.Add(ImpactNormal.Z);
+}
+
+// ---------- \/ search ----------
+void SPW_Foothold::BuildProbePattern(int32 NumProbes, TArray<FVector2D>& OutOffsets)
+{
+	static const float GOLDEN_ANGLE = PI * (3.f - FMath::Sqrt(5.f));
+
+	OutOffsets.Reset(NumProbes);
+
+	for (int32 ProbeIndex = 0; ProbeIndex < NumProbes; ProbeIndex++)
+	{
+		// equal areas per probe
+		const float Radius = FMath::Sqrt((ProbeIndex + .5f) / NumProbes);
+		float Sin, Cos;
+		FMath::SinCos(&Sin, &Cos, ProbeIndex * GOLDEN_ANGLE);
+		OutOffsets.Add(FVector2D(Radius * Cos, Radius * Sin));
+	}
+}
+
+namespace
+{
+	// squared distance & squared score, so that no lane needs a square root
+	FORCEINLINE void ScoreCandidate(float X, float Y, float Z
+		, float NX, float NY, float NZ
+		, const FVector3f& Up
+		, float& OutDistanceSquared
+		, float& OutScoreSquared)
+	{
+		OutDistanceSquared = X * X + Y * Y + Z * Z;
+
+		const float UpX = X * Up.X;
+		const float UpY = Y * Up.Y;
+		const float UpZ = Z * Up.Z;
+		const float Weight = 1.f - (NX * Up.X + NY * Up.Y + NZ * Up.Z);
+		OutScoreSquared = (UpX * UpX + UpY * UpY + UpZ * UpZ) * Weight * Weight;
+	}
+}
+
+int32 SPW_Foothold::FindBestCandidate(const FSPW_FootholdCandidates& Candidates
+	, const FVector& UpVector
+	, float MaxDistance
+	, float MaxScore)
+{
+	constexpr int32 NumLanes = FSPW_FootholdCandidates::NumLanes;
+
+	const FVector3f Up = FVector3f(UpVector);
+	const float MaxDistanceSquared = MaxDistance * MaxDistance;
+
+	int32 BestIndex = INDEX_NONE;
+	float BestScoreSquared = MaxScore * MaxScore;
+
+	const int32 NumCandidates = Candidates.Num();
+	const int32 NumBatched = NumCandidates - (NumCandidates % NumLanes);
+
+	// 4 candidates at once
+	const VectorRegister4Float UpX = VectorSetFloat1(Up.X);
+	const VectorRegister4Float UpY = VectorSetFloat1(Up.Y);
+	const VectorRegister4Float UpZ = VectorSetFloat1(Up.Z);
+	const VectorRegister4Float MaxDistanceSquaredV = VectorSetFloat1(MaxDistanceSquared);
+	const VectorRegister4Float Rejected = VectorSetFloat1(BIG_NUMBER);
+
+	for (int32 FirstIndex = 0; FirstIndex < NumBatched; FirstIndex += NumLanes)
+	{
+		const VectorRegister4Float X = VectorLoad(&Candidates.ImpactsX[FirstIndex]);
+		const VectorRegister4Float Y = VectorLoad(&Candidates.ImpactsY[FirstIndex]);
+		const VectorRegister4Float Z = VectorLoad(&Candidates.ImpactsZ[FirstIndex]);
+		const VectorRegister4Float NX = VectorLoad(&Candidates.NormalsX[FirstIndex]);
+		const VectorRegister4Float NY = VectorLoad(&Candidates.NormalsY[FirstIndex]);
+		const VectorRegister4Float NZ = VectorLoad(&Candidates.NormalsZ[FirstIndex]);
+
+		const VectorRegister4Float DistanceSquared = VectorMultiplyAdd(X, X, VectorMultiplyAdd(Y, Y, VectorMultiply(Z, Z)));
+
+		const VectorRegister4Float AlongUpX = VectorMultiply(X, UpX);
+		const VectorRegister4Float AlongUpY = VectorMultiply(Y, UpY);
+		const VectorRegister4Float AlongUpZ = VectorMultiply(Z, UpZ);
+		const VectorRegister4Float Weight = VectorSubtract(VectorOneFloat(), VectorMultiplyAdd(NX, UpX, VectorMultiplyAdd(NY, UpY, VectorMultiply(NZ, UpZ))));
+		const VectorRegister4Float ScoreSquared = VectorMultiply(
+			VectorMultiplyAdd(AlongUpX, AlongUpX, VectorMultiplyAdd(AlongUpY, AlongUpY, VectorMultiply(AlongUpZ, AlongUpZ)))
+			, VectorMultiply(Weight, Weight));
+
+		// too distant candidates never win
+		const VectorRegister4Float Scores = VectorSelect(VectorCompareLT(DistanceSquared, MaxDistanceSquaredV), ScoreSquared, Rejected);
+
+		alignas(16) float LaneScores[NumLanes];
+		VectorStoreAligned(Scores, LaneScores);
+		for (int32 Lane = 0; Lane < NumLanes; Lane++)
+		{
+			if (LaneScores[Lane] < BestScoreSquared)
+			{
+				BestScoreSquared = LaneScores[Lane];
+				BestIndex = FirstIndex + Lane;
+			}
+		}
+	}
+
+	// remaining candidates
+	for (int32 Index = NumBatched; Index < NumCandidates; Index++)
+	{
+		float DistanceSquared, ScoreSquared;
+		ScoreCandidate(Candidates.ImpactsX[Index], Candidates.ImpactsY[Index], Candidates.ImpactsZ[Index]
+			, Candidates.NormalsX[Index], Candidates.NormalsY[Index], Candidates.NormalsZ[Index]
+			, Up
+			, DistanceSquared
+			, ScoreSquared);
+
+		if (DistanceSquared < MaxDistanceSquared && ScoreSquared < BestScoreSquared)
+		{
+			BestScoreSquared = ScoreSquared;
+			BestIndex = Index;
+		}
+	}
+
+	return BestIndex;
+}
@@ -0,0 +1,204 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#include "SPW_FrameRecording.h"
+#include "BonePose.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+// constants
+static const uint32 RECORDING_MAGIC = 0x52575053;	// "SPWR"
+
+
+namespace SPW_Recording
+{
+	static bool IsIdenticalTransform(const FTransform& A, const FTransform& B)
+	{
+		const FQuat RotationA = A.GetRotation();
+		const FQuat RotationB = B.GetRotation();
+		const FVector TranslationA = A.GetTranslation();
+		const FVector TranslationB = B.GetTranslation();
+		const FVector ScaleA = A.GetScale3D();
+		const FVector ScaleB = B.GetScale3D();
+
+		return FMemory::Memcmp(&RotationA, &RotationB, sizeof(FQuat)) == 0
+			&& FMemory::Memcmp(&TranslationA, &TranslationB, sizeof(FVector)) == 0
+			&& FMemory::Memcmp(&ScaleA, &ScaleB, sizeof(FVector)) == 0;
+	}
+}
+
+// ---------- \/ hit ----------
+FSPW_RecordedHit::FSPW_RecordedHit(const FHitResult& Hit)
+	: bBlockingHit(Hit.bBlockingHit)
+	, Time(Hit.Time)
+	, Distance(Hit.Distance)
+	, Location(Hit.Location)
+	, ImpactPoint(Hit.ImpactPoint)
+	, Normal(Hit.Normal)
+	, ImpactNormal(Hit.ImpactNormal)
+	, TraceStart(Hit.TraceStart)
+	, TraceEnd(Hit.TraceEnd)
+{
+}
+
+void FSPW_RecordedHit::ToHitResult(FHitResult& OutHit) const
+{
+	OutHit = FHitResult(Time);
+	OutHit.bBlockingHit = bBlockingHit;
+	OutHit.Distance = Distance;
+	OutHit.Location = Location;
+	OutHit.ImpactPoint = ImpactPoint;
+	OutHit.Normal = Normal;
+	OutHit.ImpactNormal = ImpactNormal;
+	OutHit.TraceStart = TraceStart;
+	OutHit.TraceEnd = TraceEnd;
+}
+
+FArchive& operator<<(FArchive& Ar, FSPW_RecordedHit& Hit)
+{
+	Ar << Hit.bBlockingHit;
+	Ar << Hit.Time;
+	Ar << Hit.Distance;
+	Ar << Hit.Location;
+	Ar << Hit.ImpactPoint;
+	Ar << Hit.Normal;
+	Ar << Hit.ImpactNormal;
+	Ar << Hit.TraceStart;
+	Ar << Hit.TraceEnd;
+	return Ar;
+}
+
+// ---------- \/ inputs ----------
+void FSPW_FrameInputs::Reset(int32 NumLegs)
+{
+	DeltaSeconds = 0.f;
+	ActorTransform = FTransform::Identity;
+	ActorRotation = FRotator(0.f);
+	Velocity = FVector(0.f);
+	MovementBaseId = 0;
+	ComponentTransform = FTransform::Identity;
+	ParentBoneLocations.SetNumZeroed(NumLegs, false);
+	TipBoneLocations.SetNumZeroed(NumLegs, false);
+	LODTier = ESimpleProceduralWalk_LODTier::FULL;
+	SupportCompDeltas.SetNumZeroed(NumLegs, false);
+	Hits.Reset();
+	RequiredBones.Reset();
+	LocalPose.Reset();
+}
+
+FArchive& operator<<(FArchive& Ar, FSPW_FrameInputs& Inputs)
+{
+	Ar << Inputs.DeltaSeconds;
+	Ar << Inputs.ActorTransform;
+	Ar << Inputs.ActorRotation;
+	Ar << Inputs.Velocity;
+	Ar << Inputs.MovementBaseId;
+	Ar << Inputs.ComponentTransform;
+	Ar << Inputs.ParentBoneLocations;
+	Ar << Inputs.TipBoneLocations;
+	Ar << Inputs.LODTier;
+	Ar << Inputs.SupportCompDeltas;
+	Ar << Inputs.Hits;
+	Ar << Inputs.RequiredBones;
+	Ar << Inputs.LocalPose;
+	return Ar;
+}
+
+// ---------- \/ outputs ----------
+void FSPW_FrameOutputs::Set(const TArray<FBoneTransform>& BoneTransforms)
+{
+	BoneIndices.Reset(BoneTransforms.Num());
+	Transforms.Reset(BoneTransforms.Num());
+
+	for (const FBoneTransform& BoneTransform : BoneTransforms)
+	{
+		BoneIndices.Add(BoneTransform.BoneIndex.GetInt());
+		Transforms.Add(BoneTransform.Transform);
+	}
+}
+
+bool FSPW_FrameOutputs::IsIdentical(const FSPW_FrameOutputs& Other) const
+{
+	if (BoneIndices != Other.BoneIndices)
+	{
+		return false;
+	}
+
+	for (int32 Index = 0; Index < Transforms.Num(); Index++)
+	{
+		if (!SPW_Recording::IsIdenticalTransform(Transforms[Index], Other.Transforms[Index]))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+FArchive& operator<<(FArchive& Ar, FSPW_FrameOutputs& Outputs)
+{
+	Ar << Outputs.BoneIndices;
+	Ar << Outputs.Transforms;
+	return Ar;
+}
+
+// ---------- \/ recording ----------
+bool FSPW_FrameRecording::SaveToFile(const FString& Filename) const
+{
+	TArray<uint8> Data;
+	FMemoryWriter Writer(Data);
+	Writer << const_cast<FSPW_FrameRecording&>(*this);
+
+	if (!FFileHelper::SaveArrayToFile(Data, *Filename))
+	{
+		UE_LOG(LogSimpleProceduralWalk, Error, TEXT("Could not write recording to %s."), *Filename);
+		return false;
+	}
+
+	UE_LOG(LogSimpleProceduralWalk, Log, TEXT("Recording of %d frames written to %s."), Frames.Num(), *Filename);
+	return true;
+}
+
+bool FSPW_FrameRecording::LoadFromFile(const FString& Filename)
+{
+	TArray<uint8> Data;
+	if (!FFileHelper::LoadFileToArray(Data, *Filename))
+	{
+		UE_LOG(LogSimpleProceduralWalk, Error, TEXT("Could not read recording from %s."), *Filename);
+		return false;
+	}
+
+	FMemoryReader Reader(Data);
+	Reader << *this;
+
+	if (Reader.IsError() || Frames.Num() != Outputs.Num())
+	{
+		UE_LOG(LogSimpleProceduralWalk, Error, TEXT("%s is not a valid recording."), *Filename);
+		return false;
+	}
+
+	return true;
+}
+
+FArchive& operator<<(FArchive& Ar, FSPW_FrameRecording& Recording)
+{
+	uint32 Magic = RECORDING_MAGIC;
+	int32 Version = FSPW_FrameRecording::VERSION;
+	Ar << Magic;
+	Ar << Version;
+
+	if (Magic != RECORDING_MAGIC || Version != FSPW_FrameRecording::VERSION)
+	{
+		/* -> not a recording, or made by another version of the node */
+		Ar.SetError();
+		return Ar;
+	}
+
+	Ar << Recording.NodeSettings;
+	Ar << Recording.SkeletalMeshPath;
+	Ar << Recording.OwnerHalfHeight;
+	Ar << Recording.FramesSinceTracesRefresh;
+	Ar << Recording.Frames;
+	Ar << Recording.Outputs;
+	return Ar;
+}
@@ -0,0 +1,41 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#include "SPW_GaitStateComponent.h"
+
+
+USPW_GaitStateComponent::USPW_GaitStateComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+}
+
+void USPW_GaitStateComponent::HandOverGaitState(const FSimpleProceduralWalk_GaitState& InGaitState)
+{
+	check(IsInGameThread());
+
+	HandedOverGaitState = InGaitState;
+	bHasHandedOverGaitState = true;
+
+	// until the node publishes again, its phase is the one handed over
+	GaitState = InGaitState;
+}
+
+bool USPW_GaitStateComponent::ConsumeHandedOverGaitState(FSimpleProceduralWalk_GaitState& OutGaitState)
+{
+	check(IsInGameThread());
+
+	if (!bHasHandedOverGaitState)
+	{
+		return false;
+	}
+
+	OutGaitState = HandedOverGaitState;
+	bHasHandedOverGaitState = false;
+	return true;
+}
+
+void USPW_GaitStateComponent::SetGaitState(const FSimpleProceduralWalk_GaitState& InGaitState)
+{
+	check(IsInGameThread());
+
+	GaitState = InGaitState;
+}
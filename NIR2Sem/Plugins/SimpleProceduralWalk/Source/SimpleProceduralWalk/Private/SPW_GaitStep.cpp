@@ -0,0 +1,63 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#include "SPW_GaitStep.h"
+
+// constants
+static const float ANGULAR_SPEED_THRESHOLD_MIN = 5.f;
+
+
+FSPW_GaitStep SPW_Gait::ComputeStep(FVector Velocity
+	, const FVector& ForwardVector
+	, const FVector& RightVector
+	, float YawDelta
+	, float StepDistanceForward
+	, float StepDistanceRight
+	, float SlopeMultiplier
+	, float MinStepDuration)
+{
+	FSPW_GaitStep Step;
+
+	// Speed
+	Step.Speed = Velocity.Size();
+	if (Step.Speed <= SPEED_THRESHOLD_MIN)
+	{
+		Step.Speed = 0.f;
+		Velocity = FVector(0.f);
+	}
+
+	// %, 1 when moving along the axis, -1 when moving against it
+	Velocity.Normalize();
+	Step.ForwardPercent = 1.f - 2.f * FMath::Acos(FMath::Clamp(FVector::DotProduct(ForwardVector, Velocity), -1.f, 1.f)) / PI;
+	Step.RightPercent = 1.f - 2.f * FMath::Acos(FMath::Clamp(FVector::DotProduct(RightVector, Velocity), -1.f, 1.f)) / PI;
+
+	// Step length
+	Step.StepLength =
+		(
+			// portion of step forward
+			FMath::Abs(Step.ForwardPercent * StepDistanceForward)
+			// portion of step right
+			+ FMath::Abs(Step.RightPercent * StepDistanceRight)
+			// portion of step right based on angular speed
+			+ FMath::Abs(StepDistanceRight * FMath::Clamp(YawDelta / 360, -1.f, 1.f))
+			)
+		// reduce distance due to slope
+		* SlopeMultiplier;
+
+	// Step duration
+	const float SpeedWithAngular = Step.Speed + FMath::Abs(YawDelta);
+	if (SpeedWithAngular > ANGULAR_SPEED_THRESHOLD_MIN)	// Avoid unnatural step durations
+	{
+		Step.StepDuration = Step.StepLength / SpeedWithAngular;
+	}
+	else
+	{
+		Step.StepDuration = MinStepDuration;
+	}
+
+	return Step;
+}
+
+float SPW_Gait::AdvanceStepPercent(float StepPercent, float DeltaSeconds, float StepDuration)
+{
+	return FMath::Clamp(StepPercent + (DeltaSeconds / StepDuration), 0.f, 1.f);
+}
@@ -0,0 +1,917 @@
+// Copyright Epic Games, Inc. and Roberto Ostinelli, 2021. All Rights Reserved.
+
+#include "SPW_IKKernel.h"
+
+
+// ---------- \/ chain ----------
+void FSPW_IKChain::Reset()
+{
+	Positions.Reset();
+	Rotations.Reset();
+	LocalOffsets.Reset();
+	LocalRotations.Reset();
+	AngleDeltas.Reset();
+	Lengths.Reset();
+	RotationLimits.Reset();
+	TransformIndices.Reset();
+	bEnableRotationLimits = false;
+	LastLinkScale = FVector(1.f);
+}
+
+void FSPW_IKChain::Reserve(int32 NumLinks)
+{
+	Positions.Reserve(NumLinks);
+	Rotations.Reserve(NumLinks);
+	LocalOffsets.Reserve(NumLinks);
+	LocalRotations.Reserve(NumLinks);
+	AngleDeltas.Reserve(NumLinks);
+	Lengths.Reserve(NumLinks);
+	RotationLimits.Reserve(NumLinks);
+	TransformIndices.Reserve(NumLinks);
+}
+
+SIZE_T FSPW_IKChain::GetAllocatedSize() const
+{
+	return Positions.GetAllocatedSize()
+		+ Rotations.GetAllocatedSize()
+		+ LocalOffsets.GetAllocatedSize()
+		+ LocalRotations.GetAllocatedSize()
+		+ AngleDeltas.GetAllocatedSize()
+		+ Lengths.GetAllocatedSize()
+		+ RotationLimits.GetAllocatedSize()
+		+ TransformIndices.GetAllocatedSize();
+}
+
+void FSPW_IKChain::AddLink(const FTransform& CSTransform, const FTransform& LocalTransform, int32 TransformIndex, float RotationLimitInRadians)
+{
+	Positions.Add(CSTransform.GetLocation());
+	Rotations.Add(CSTransform.GetRotation());
+	// as in FTransform composition, the parent scale applies to the local translation
+	LocalOffsets.Add(LastLinkScale * LocalTransform.GetTranslation());
+	LocalRotations.Add(LocalTransform.GetRotation());
+	AngleDeltas.Add(0.f);
+	Lengths.Add(Positions.Num() > 1 ? FVector::Dist(Positions.Last(), Positions.Last(1)) : 0.f);
+	RotationLimits.Add(RotationLimitInRadians);
+	TransformIndices.Add(TransformIndex);
+
+	LastLinkScale = CSTransform.GetScale3D();
+}
+
+void FSPW_IKChainBatch::SetNumLinks(int32 InNumLinks)
+{
+	NumLinks = InNumLinks;
+
+	for (TArray<VectorRegister4Float>* Registers : {
+		&PositionsX, &PositionsY, &PositionsZ
+		, &RotationsX, &RotationsY, &RotationsZ, &RotationsW
+		, &LocalOffsetsX, &LocalOffsetsY, &LocalOffsetsZ
+		, &LocalRotationsX, &LocalRotationsY, &LocalRotationsZ, &LocalRotationsW
+		, &AngleDeltas
+		, &RotationLimits })
+	{
+		Registers->SetNumUninitialized(NumLinks, false);
+	}
+}
+
+SIZE_T FSPW_IKChainBatch::GetAllocatedSize() const
+{
+	SIZE_T AllocatedSize = 0;
+
+	for (const TArray<VectorRegister4Float>* Registers : {
+		&PositionsX, &PositionsY, &PositionsZ
+		, &RotationsX, &RotationsY, &RotationsZ, &RotationsW
+		, &LocalOffsetsX, &LocalOffsetsY, &LocalOffsetsZ
+		, &LocalRotationsX, &LocalRotationsY, &LocalRotationsZ, &LocalRotationsW
+		, &AngleDeltas
+		, &RotationLimits })
+	{
+		AllocatedSize += Registers->GetAllocatedSize();
+	}
+
+	return AllocatedSize;
+}
+
+// ---------- \/ scalar ----------
+namespace
+{
+	void RotateChainLink(FSPW_IKChain& Chain, int32 LinkIndex, const FQuat& DeltaRotation)
+	{
+		int32 const TipBoneLinkIndex = Chain.Num() - 1;
+
+		FQuat NewRotation = DeltaRotation * Chain.Rotations[LinkIndex];
+		NewRotation.Normalize();
+		Chain.Rotations[LinkIndex] = NewRotation;
+
+		// if I have parent, make sure to refresh local rotation since my current rotation has changed
+		if (LinkIndex > 0)
+		{
+			FQuat LocalRotation = Chain.Rotations[LinkIndex - 1].Inverse() * NewRotation;
+			LocalRotation.Normalize();
+			Chain.LocalRotations[LinkIndex] = LocalRotation;
+		}
+
+		// now update all my children
+		for (int32 ChildLinkIndex = LinkIndex + 1; ChildLinkIndex <= TipBoneLinkIndex; ++ChildLinkIndex)
+		{
+			const FQuat& ParentRotation = Chain.Rotations[ChildLinkIndex - 1];
+
+			Chain.Positions[ChildLinkIndex] = Chain.Positions[ChildLinkIndex - 1] + ParentRotation.RotateVector(Chain.LocalOffsets[ChildLinkIndex]);
+
+			FQuat ChildRotation = ParentRotation * Chain.LocalRotations[ChildLinkIndex];
+			ChildRotation.Normalize();
+			Chain.Rotations[ChildLinkIndex] = ChildRotation;
+		}
+	}
+
+	bool UpdateChainLink(FSPW_IKChain& Chain, int32 LinkIndex, const FVector& TargetPos)
+	{
+		int32 const TipBoneLinkIndex = Chain.Num() - 1;
+
+		// update new tip pos
+		const FVector LinkPos = Chain.Positions[LinkIndex];
+		FVector ToEnd = Chain.Positions[TipBoneLinkIndex] - LinkPos;
+		FVector ToTarget = TargetPos - LinkPos;
+
+		ToEnd.Normalize();
+		ToTarget.Normalize();
+
+		float RotationLimitPerJointInRadian = Chain.RotationLimits[LinkIndex];
+		float& CurrentAngleDelta = Chain.AngleDeltas[LinkIndex];
+		float Angle = FMath::ClampAngle(FMath::Acos(FVector::DotProduct(ToEnd, ToTarget)), -RotationLimitPerJointInRadian, RotationLimitPerJointInRadian);
+		bool bCanRotate = (FMath::Abs(Angle) > KINDA_SMALL_NUMBER) && (!Chain.bEnableRotationLimits || RotationLimitPerJointInRadian > CurrentAngleDelta);
+		if (!bCanRotate)
+		{
+			return false;
+		}
+
+		// check rotation limit first, if fails, just abort
+		if (Chain.bEnableRotationLimits)
+		{
+			if (RotationLimitPerJointInRadian < CurrentAngleDelta + Angle)
+			{
+				Angle = RotationLimitPerJointInRadian - CurrentAngleDelta;
+				if (Angle <= KINDA_SMALL_NUMBER)
+				{
+					return false;
+				}
+			}
+
+			CurrentAngleDelta += Angle;
+		}
+
+		// continue with rotating toward to target
+		FVector RotationAxis = FVector::CrossProduct(ToEnd, ToTarget);
+		if (RotationAxis.SizeSquared() <= 0.f)
+		{
+			return false;
+		}
+
+		RotationAxis.Normalize();
+		// Delta Rotation is the rotation to target
+		RotateChainLink(Chain, LinkIndex, FQuat(RotationAxis, Angle));
+
+		return true;
+	}
+}
+
+FSPW_IKSolveResult SPW_IK::SolveCCDIK(FSPW_IKChain& InOutChain, const FVector& TargetPosition, const FSPW_IKSolveSettings& Settings)
+{
+	FSPW_IKSolveResult Result;
+
+	int32 const NumChainLinks = InOutChain.Num();
+	if (NumChainLinks == 0)
+	{
+		return Result;
+	}
+
+	int32 const TipBoneLinkIndex = NumChainLinks - 1;
+
+	// (as in the original solver, this is not reset between iterations:
+	// the loop only stops early when the first iteration could not move anything)
+	bool bLocalUpdated = false;
+	float Distance = FVector::Dist(TargetPosition, InOutChain.Positions[TipBoneLinkIndex]);
+
+	while ((Distance > Settings.Precision) && (Result.Iterations < Settings.MaxIterations))
+	{
+		++Result.Iterations;
+
+		if (Settings.bStartFromTail)
+		{
+			// iterate from tip to root
+			for (int32 LinkIndex = TipBoneLinkIndex - 1; LinkIndex > 0; --LinkIndex)
+			{
+				bLocalUpdated |= UpdateChainLink(InOutChain, LinkIndex, TargetPosition);
+			}
+		}
+		else
+		{
+			for (int32 LinkIndex = 1; LinkIndex < TipBoneLinkIndex; ++LinkIndex)
+			{
+				bLocalUpdated |= UpdateChainLink(InOutChain, LinkIndex, TargetPosition);
+			}
+		}
+
+		Distance = FVector::Dist(InOutChain.Positions[TipBoneLinkIndex], TargetPosition);
+
+		Result.bUpdated |= bLocalUpdated;
+
+		// no more update in this iteration
+		if (!bLocalUpdated)
+		{
+			break;
+		}
+	}
+
+	return Result;
+}
+
+void SPW_IK::SetLocalRotations(FSPW_IKChain& InOutChain, const TArray<FQuat>& LocalRotations)
+{
+	int32 const NumChainLinks = InOutChain.Num();
+	check(LocalRotations.Num() == NumChainLinks);
+
+	// the root is never rotated
+	for (int32 LinkIndex = 1; LinkIndex < NumChainLinks; ++LinkIndex)
+	{
+		InOutChain.AngleDeltas[LinkIndex] = InOutChain.LocalRotations[LinkIndex].AngularDistance(LocalRotations[LinkIndex]);
+		InOutChain.LocalRotations[LinkIndex] = LocalRotations[LinkIndex];
+
+		const FQuat& ParentRotation = InOutChain.Rotations[LinkIndex - 1];
+
+		InOutChain.Positions[LinkIndex] = InOutChain.Positions[LinkIndex - 1] + ParentRotation.RotateVector(InOutChain.LocalOffsets[LinkIndex]);
+
+		FQuat Rotation = ParentRotation * LocalRotations[LinkIndex];
+		Rotation.Normalize();
+		InOutChain.Rotations[LinkIndex] = Rotation;
+	}
+}
+
+// ---------- \/ FABRIK ----------
+namespace
+{
+	// rotates the links, from the root, towards the positions set by FABRIK, then puts the links where their rotations lead
+	bool FollowChainPositions(FSPW_IKChain& Chain)
+	{
+		int32 const TipBoneLinkIndex = Chain.Num() - 1;
+		bool bUpdated = false;
+
+		for (int32 LinkIndex = 1; LinkIndex < TipBoneLinkIndex; ++LinkIndex)
+		{
+			const FVector ToChild = Chain.Rotations[LinkIndex].RotateVector(Chain.LocalOffsets[LinkIndex + 1]);
+			const FVector ToTarget = Chain.Positions[LinkIndex + 1] - Chain.Positions[LinkIndex];
+
+			FQuat DeltaRotation = FQuat::FindBetweenVectors(ToChild, ToTarget);
+			float Angle = DeltaRotation.GetAngle();
+
+			if (Chain.bEnableRotationLimits)
+			{
+				float& CurrentAngleDelta = Chain.AngleDeltas[LinkIndex];
+				const float MaxAngle = FMath::Max(Chain.RotationLimits[LinkIndex] - CurrentAngleDelta, 0.f);
+				if (Angle > MaxAngle)
+				{
+					DeltaRotation = FQuat::Slerp(FQuat::Identity, DeltaRotation, MaxAngle / Angle);
+					Angle = MaxAngle;
+				}
+				CurrentAngleDelta += Angle;
+			}
+
+			if (Angle > KINDA_SMALL_NUMBER)
+			{
+				FQuat NewRotation = DeltaRotation * Chain.Rotations[LinkIndex];
+				NewRotation.Normalize();
+				Chain.Rotations[LinkIndex] = NewRotation;
+
+				FQuat LocalRotation = Chain.Rotations[LinkIndex - 1].Inverse() * NewRotation;
+				LocalRotation.Normalize();
+				Chain.LocalRotations[LinkIndex] = LocalRotation;
+
+				bUpdated = true;
+			}
+
+			// the child follows
+			const FQuat& Rotation = Chain.Rotations[LinkIndex];
+			Chain.Positions[LinkIndex + 1] = Chain.Positions[LinkIndex] + Rotation.RotateVector(Chain.LocalOffsets[LinkIndex + 1]);
+
+			FQuat ChildRotation = Rotation * Chain.LocalRotations[LinkIndex + 1];
+			ChildRotation.Normalize();
+			Chain.Rotations[LinkIndex + 1] = ChildRotation;
+		}
+
+		return bUpdated;
+	}
+}
+
+FSPW_IKSolveResult SPW_IK::SolveFABRIK(FSPW_IKChain& InOutChain, const FVector& TargetPosition, const FSPW_IKSolveSettings& Settings)
+{
+	FSPW_IKSolveResult Result;
+
+	// the root link is never rotated, so the first moving link never moves
+	int32 const NumChainLinks = InOutChain.Num();
+	if (NumChainLinks < 3)
+	{
+		return Result;
+	}
+
+	int32 const TipBoneLinkIndex = NumChainLinks - 1;
+	TArray<FVector>& Positions = InOutChain.Positions;
+	const TArray<float>& Lengths = InOutChain.Lengths;
+
+	float Distance = FVector::Dist(TargetPosition, Positions[TipBoneLinkIndex]);
+
+	while ((Distance > Settings.Precision) && (Result.Iterations < Settings.MaxIterations))
+	{
+		++Result.Iterations;
+
+		// backwards, from the target
+		Positions[TipBoneLinkIndex] = TargetPosition;
+		for (int32 LinkIndex = TipBoneLinkIndex - 1; LinkIndex > 1; --LinkIndex)
+		{
+			Positions[LinkIndex] = Positions[LinkIndex + 1] + (Positions[LinkIndex] - Positions[LinkIndex + 1]).GetSafeNormal() * Lengths[LinkIndex + 1];
+		}
+
+		// forwards, from the first moving link
+		for (int32 LinkIndex = 2; LinkIndex <= TipBoneLinkIndex; ++LinkIndex)
+		{
+			Positions[LinkIndex] = Positions[LinkIndex - 1] + (Positions[LinkIndex] - Positions[LinkIndex - 1]).GetSafeNormal() * Lengths[LinkIndex];
+		}
+
+		// rotations (and limits) are applied each iteration, so that the next iteration starts from a reachable pose
+		const bool bLocalUpdated = FollowChainPositions(InOutChain);
+		Result.bUpdated |= bLocalUpdated;
+
+		Distance = FVector::Dist(Positions[TipBoneLinkIndex], TargetPosition);
+
+		// no more update in this iteration
+		if (!bLocalUpdated)
+		{
+			break;
+		}
+	}
+
+	return Result;
+}
+
+// ---------- \/ analytic ----------
+namespace
+{
+	constexpr int32 ANALYTIC_MAX_LINKS = 5;
+
+	// rotates a link so that one of its children reaches a location, returns false if rotation limits are exceeded
+	bool AimChainLink(FSPW_IKChain& Chain, int32 LinkIndex, int32 ChildLinkIndex, const FVector& Location)
+	{
+		const FVector LinkPos = Chain.Positions[LinkIndex];
+		const FVector ToChild = (Chain.Positions[ChildLinkIndex] - LinkPos).GetSafeNormal();
+		const FVector ToLocation = (Location - LinkPos).GetSafeNormal();
+		if (ToChild.IsZero() || ToLocation.IsZero())
+		{
+			return false;
+		}
+
+		const FQuat DeltaRotation = FQuat::FindBetweenNormals(ToChild, ToLocation);
+
+		if (Chain.bEnableRotationLimits)
+		{
+			float& CurrentAngleDelta = Chain.AngleDeltas[LinkIndex];
+			CurrentAngleDelta += DeltaRotation.GetAngle();
+			if (CurrentAngleDelta > Chain.RotationLimits[LinkIndex])
+			{
+				return false;
+			}
+		}
+
+		RotateChainLink(Chain, LinkIndex, DeltaRotation);
+		return true;
+	}
+
+	// the direction from Location towards BendHint, perpendicular to Direction
+	bool GetBendDirection(const FVector& Location, const FVector& Direction, const FVector& BendHint, FVector& OutBendDirection)
+	{
+		const FVector ToHint = BendHint - Location;
+		OutBendDirection = ToHint - FVector::DotProduct(ToHint, Direction) * Direction;
+		return OutBendDirection.Normalize();
+	}
+
+	// moves two bones so that the second one reaches the target, bending in the plane of the current middle joint
+	bool SolveTwoBones(FSPW_IKChain& Chain, int32 LinkIndex, const FVector& TargetPos)
+	{
+		const FVector RootPos = Chain.Positions[LinkIndex];
+		const FVector JointPos = Chain.Positions[LinkIndex + 1];
+		const float UpperLength = FVector::Dist(RootPos, JointPos);
+		const float LowerLength = FVector::Dist(JointPos, Chain.Positions[LinkIndex + 2]);
+
+		FVector ToTarget = TargetPos - RootPos;
+		const float TargetDistance = ToTarget.Size();
+		if (TargetDistance <= KINDA_SMALL_NUMBER || TargetDistance > UpperLength + LowerLength || TargetDistance < FMath::Abs(UpperLength - LowerLength))
+		{
+			/* -> out of reach */
+			return false;
+		}
+		ToTarget /= TargetDistance;
+
+		FVector BendDirection;
+		if (!GetBendDirection(RootPos, ToTarget, JointPos, BendDirection))
+		{
+			/* -> straight leg, no bend plane */
+			return false;
+		}
+
+		// law of cosines
+		const float CosAngle = FMath::Clamp((FMath::Square(UpperLength) + FMath::Square(TargetDistance) - FMath::Square(LowerLength)) / (2.f * UpperLength * TargetDistance), -1.f, 1.f);
+		const float SinAngle = FMath::Sqrt(1.f - FMath::Square(CosAngle));
+		const FVector NewJointPos = RootPos + (ToTarget * CosAngle + BendDirection * SinAngle) * UpperLength;
+
+		return AimChainLink(Chain, LinkIndex, LinkIndex + 1, NewJointPos)
+			&& AimChainLink(Chain, LinkIndex + 1, LinkIndex + 2, TargetPos);
+	}
+
+	// turns the first of three bones towards the target, as close to its current angle as the other two bones allow
+	bool SolveFirstOfThreeBones(FSPW_IKChain& Chain, int32 LinkIndex, const FVector& TargetPos)
+	{
+		const FVector RootPos = Chain.Positions[LinkIndex];
+		const FVector JointPos = Chain.Positions[LinkIndex + 1];
+		const float FirstLength = FVector::Dist(RootPos, JointPos);
+		const float SecondLength = FVector::Dist(JointPos, Chain.Positions[LinkIndex + 2]);
+		const float ThirdLength = FVector::Dist(Chain.Positions[LinkIndex + 2], Chain.Positions[LinkIndex + 3]);
+
+		FVector ToTarget = TargetPos - RootPos;
+		const float TargetDistance = ToTarget.Size();
+		if (TargetDistance <= KINDA_SMALL_NUMBER)
+		{
+			return false;
+		}
+		ToTarget /= TargetDistance;
+
+		FVector BendDirection;
+		if (!GetBendDirection(RootPos, ToTarget, JointPos, BendDirection)
+			&& !GetBendDirection(RootPos, ToTarget, Chain.Positions[LinkIndex + 2], BendDirection))
+		{
+			return false;
+		}
+
+		// the distance from the joint to the target grows with the angle of the first bone,
+		// get the angles for which the two other bones can reach the target
+		const float DoubleProduct = 2.f * FirstLength * TargetDistance;
+		const float SquaredLengths = FMath::Square(FirstLength) + FMath::Square(TargetDistance);
+		const float CosAngleAtMaxReach = (SquaredLengths - FMath::Square(SecondLength + ThirdLength)) / DoubleProduct;
+		const float CosAngleAtMinReach = (SquaredLengths - FMath::Square(SecondLength - ThirdLength)) / DoubleProduct;
+		if (CosAngleAtMaxReach > 1.f || CosAngleAtMinReach < -1.f)
+		{
+			/* -> out of reach */
+			return false;
+		}
+
+		const float CurrentCosAngle = FVector::DotProduct(JointPos - RootPos, ToTarget) / FirstLength;
+		const float CosAngle = FMath::Clamp(CurrentCosAngle, FMath::Max(CosAngleAtMaxReach, -1.f), FMath::Min(CosAngleAtMinReach, 1.f));
+		const float SinAngle = FMath::Sqrt(1.f - FMath::Square(CosAngle));
+		const FVector NewJointPos = RootPos + (ToTarget * CosAngle + BendDirection * SinAngle) * FirstLength;
+
+		return AimChainLink(Chain, LinkIndex, LinkIndex + 1, NewJointPos);
+	}
+}
+
+bool SPW_IK::SolveAnalytic(FSPW_IKChain& InOutChain, const FVector& TargetPosition, FSPW_IKSolveResult& OutResult)
+{
+	// the root link is never rotated
+	int32 const NumChainLinks = InOutChain.Num();
+	if (NumChainLinks != 4 && NumChainLinks != ANALYTIC_MAX_LINKS)
+	{
+		return false;
+	}
+
+	// kept to leave the chain untouched on failure
+	FVector Positions[ANALYTIC_MAX_LINKS];
+	FQuat Rotations[ANALYTIC_MAX_LINKS];
+	FQuat LocalRotations[ANALYTIC_MAX_LINKS];
+	float AngleDeltas[ANALYTIC_MAX_LINKS];
+	for (int32 LinkIndex = 0; LinkIndex < NumChainLinks; ++LinkIndex)
+	{
+		Positions[LinkIndex] = InOutChain.Positions[LinkIndex];
+		Rotations[LinkIndex] = InOutChain.Rotations[LinkIndex];
+		LocalRotations[LinkIndex] = InOutChain.LocalRotations[LinkIndex];
+		AngleDeltas[LinkIndex] = InOutChain.AngleDeltas[LinkIndex];
+	}
+
+	bool bSolved = true;
+	int32 FirstLinkIndex = 1;
+	if (NumChainLinks == ANALYTIC_MAX_LINKS)
+	{
+		bSolved = SolveFirstOfThreeBones(InOutChain, FirstLinkIndex, TargetPosition);
+		++FirstLinkIndex;
+	}
+	bSolved = bSolved && SolveTwoBones(InOutChain, FirstLinkIndex, TargetPosition);
+
+	if (!bSolved)
+	{
+		for (int32 LinkIndex = 0; LinkIndex < NumChainLinks; ++LinkIndex)
+		{
+			InOutChain.Positions[LinkIndex] = Positions[LinkIndex];
+			InOutChain.Rotations[LinkIndex] = Rotations[LinkIndex];
+			InOutChain.LocalRotations[LinkIndex] = LocalRotations[LinkIndex];
+			InOutChain.AngleDeltas[LinkIndex] = AngleDeltas[LinkIndex];
+		}
+		return false;
+	}
+
+	OutResult.bUpdated = true;
+	OutResult.Iterations = 1;
+	return true;
+}
+
+// ---------- \/ batch ----------
+namespace
+{
+	FORCEINLINE VectorRegister4Float LanesTrueMask()
+	{
+		return VectorCompareEQ(VectorZeroFloat(), VectorZeroFloat());
+	}
+
+	FORCEINLINE VectorRegister4Float LanesDot(const VectorRegister4Float& AX, const VectorRegister4Float& AY, const VectorRegister4Float& AZ
+		, const VectorRegister4Float& BX, const VectorRegister4Float& BY, const VectorRegister4Float& BZ)
+	{
+		return VectorMultiplyAdd(AX, BX, VectorMultiplyAdd(AY, BY, VectorMultiply(AZ, BZ)));
+	}
+
+	FORCEINLINE void LanesCross(const VectorRegister4Float& AX, const VectorRegister4Float& AY, const VectorRegister4Float& AZ
+		, const VectorRegister4Float& BX, const VectorRegister4Float& BY, const VectorRegister4Float& BZ
+		, VectorRegister4Float& OutX, VectorRegister4Float& OutY, VectorRegister4Float& OutZ)
+	{
+		OutX = VectorSubtract(VectorMultiply(AY, BZ), VectorMultiply(AZ, BY));
+		OutY = VectorSubtract(VectorMultiply(AZ, BX), VectorMultiply(AX, BZ));
+		OutZ = VectorSubtract(VectorMultiply(AX, BY), VectorMultiply(AY, BX));
+	}
+
+	// as FVector::Normalize: vectors that are too small are left untouched
+	FORCEINLINE void LanesNormalize(VectorRegister4Float& X, VectorRegister4Float& Y, VectorRegister4Float& Z)
+	{
+		const VectorRegister4Float SizeSquared = LanesDot(X, Y, Z, X, Y, Z);
+		const VectorRegister4Float Mask = VectorCompareGT(SizeSquared, VectorSetFloat1(SMALL_NUMBER));
+		const VectorRegister4Float InvSize = VectorDivide(VectorOneFloat(), VectorSqrt(SizeSquared));
+
+		X = VectorSelect(Mask, VectorMultiply(X, InvSize), X);
+		Y = VectorSelect(Mask, VectorMultiply(Y, InvSize), Y);
+		Z = VectorSelect(Mask, VectorMultiply(Z, InvSize), Z);
+	}
+
+	// as FQuat::Normalize: quaternions that are too small become identity
+	FORCEINLINE void LanesQuatNormalize(VectorRegister4Float& X, VectorRegister4Float& Y, VectorRegister4Float& Z, VectorRegister4Float& W)
+	{
+		const VectorRegister4Float SizeSquared = VectorMultiplyAdd(W, W, LanesDot(X, Y, Z, X, Y, Z));
+		const VectorRegister4Float Mask = VectorCompareGE(SizeSquared, VectorSetFloat1(SMALL_NUMBER));
+		const VectorRegister4Float InvSize = VectorDivide(VectorOneFloat(), VectorSqrt(SizeSquared));
+
+		X = VectorSelect(Mask, VectorMultiply(X, InvSize), VectorZeroFloat());
+		Y = VectorSelect(Mask, VectorMultiply(Y, InvSize), VectorZeroFloat());
+		Z = VectorSelect(Mask, VectorMultiply(Z, InvSize), VectorZeroFloat());
+		W = VectorSelect(Mask, VectorMultiply(W, InvSize), VectorOneFloat());
+	}
+
+	// A * B, as FQuat::operator*
+	FORCEINLINE void LanesQuatMultiply(const VectorRegister4Float& AX, const VectorRegister4Float& AY, const VectorRegister4Float& AZ, const VectorRegister4Float& AW
+		, const VectorRegister4Float& BX, const VectorRegister4Float& BY, const VectorRegister4Float& BZ, const VectorRegister4Float& BW
+		, VectorRegister4Float& OutX, VectorRegister4Float& OutY, VectorRegister4Float& OutZ, VectorRegister4Float& OutW)
+	{
+		OutX = VectorAdd(VectorAdd(VectorMultiply(AW, BX), VectorMultiply(AX, BW)), VectorSubtract(VectorMultiply(AY, BZ), VectorMultiply(AZ, BY)));
+		OutY = VectorAdd(VectorSubtract(VectorMultiply(AW, BY), VectorMultiply(AX, BZ)), VectorAdd(VectorMultiply(AY, BW), VectorMultiply(AZ, BX)));
+		OutZ = VectorAdd(VectorSubtract(VectorAdd(VectorMultiply(AW, BZ), VectorMultiply(AX, BY)), VectorMultiply(AY, BX)), VectorMultiply(AZ, BW));
+		OutW = VectorSubtract(VectorSubtract(VectorSubtract(VectorMultiply(AW, BW), VectorMultiply(AX, BX)), VectorMultiply(AY, BY)), VectorMultiply(AZ, BZ));
+	}
+
+	// as FQuat::RotateVector
+	FORCEINLINE void LanesQuatRotate(const VectorRegister4Float& QX, const VectorRegister4Float& QY, const VectorRegister4Float& QZ, const VectorRegister4Float& QW
+		, const VectorRegister4Float& VX, const VectorRegister4Float& VY, const VectorRegister4Float& VZ
+		, VectorRegister4Float& OutX, VectorRegister4Float& OutY, VectorRegister4Float& OutZ)
+	{
+		const VectorRegister4Float Two = VectorSetFloat1(2.f);
+
+		VectorRegister4Float TX, TY, TZ;
+		LanesCross(QX, QY, QZ, VX, VY, VZ, TX, TY, TZ);
+		TX = VectorMultiply(TX, Two);
+		TY = VectorMultiply(TY, Two);
+		TZ = VectorMultiply(TZ, Two);
+
+		VectorRegister4Float CX, CY, CZ;
+		LanesCross(QX, QY, QZ, TX, TY, TZ, CX, CY, CZ);
+
+		OutX = VectorAdd(VectorMultiplyAdd(QW, TX, VX), CX);
+		OutY = VectorAdd(VectorMultiplyAdd(QW, TY, VY), CY);
+		OutZ = VectorAdd(VectorMultiplyAdd(QW, TZ, VZ), CZ);
+	}
+
+	// transcendentals go through the scalar functions, so that every lane matches the scalar solver
+	FORCEINLINE VectorRegister4Float LanesAcos(const VectorRegister4Float& V)
+	{
+		alignas(16) float Values[FSPW_IKChainBatch::NumLanes];
+		VectorStoreAligned(V, Values);
+		for (float& Value : Values)
+		{
+			Value = FMath::Acos(Value);
+		}
+		return VectorLoadAligned(Values);
+	}
+
+	FORCEINLINE void LanesSinCos(const VectorRegister4Float& Angles, VectorRegister4Float& OutSin, VectorRegister4Float& OutCos)
+	{
+		alignas(16) float Values[FSPW_IKChainBatch::NumLanes];
+		alignas(16) float Sines[FSPW_IKChainBatch::NumLanes];
+		alignas(16) float Cosines[FSPW_IKChainBatch::NumLanes];
+		VectorStoreAligned(Angles, Values);
+		for (int32 Lane = 0; Lane < FSPW_IKChainBatch::NumLanes; ++Lane)
+		{
+			FMath::SinCos(&Sines[Lane], &Cosines[Lane], Values[Lane]);
+		}
+		OutSin = VectorLoadAligned(Sines);
+		OutCos = VectorLoadAligned(Cosines);
+	}
+
+	// lane-wise UpdateChainLink, returns the mask of the lanes that have been rotated
+	VectorRegister4Float UpdateChainLinkLanes(FSPW_IKChainBatch& Batch
+		, int32 LinkIndex
+		, const VectorRegister4Float& TargetX, const VectorRegister4Float& TargetY, const VectorRegister4Float& TargetZ
+		, const VectorRegister4Float& ActiveMask
+		, const VectorRegister4Float& RotationLimitsMask)
+	{
+		const int32 TipBoneLinkIndex = Batch.NumLinks - 1;
+		const VectorRegister4Float Zero = VectorZeroFloat();
+		const VectorRegister4Float SmallNumber = VectorSetFloat1(KINDA_SMALL_NUMBER);
+
+		const VectorRegister4Float LinkX = Batch.PositionsX[LinkIndex];
+		const VectorRegister4Float LinkY = Batch.PositionsY[LinkIndex];
+		const VectorRegister4Float LinkZ = Batch.PositionsZ[LinkIndex];
+
+		VectorRegister4Float ToEndX = VectorSubtract(Batch.PositionsX[TipBoneLinkIndex], LinkX);
+		VectorRegister4Float ToEndY = VectorSubtract(Batch.PositionsY[TipBoneLinkIndex], LinkY);
+		VectorRegister4Float ToEndZ = VectorSubtract(Batch.PositionsZ[TipBoneLinkIndex], LinkZ);
+		VectorRegister4Float ToTargetX = VectorSubtract(TargetX, LinkX);
+		VectorRegister4Float ToTargetY = VectorSubtract(TargetY, LinkY);
+		VectorRegister4Float ToTargetZ = VectorSubtract(TargetZ, LinkZ);
+
+		LanesNormalize(ToEndX, ToEndY, ToEndZ);
+		LanesNormalize(ToTargetX, ToTargetY, ToTargetZ);
+
+		// the acos result is positive, so clamping to the limit range is a min
+		const VectorRegister4Float Acos = LanesAcos(LanesDot(ToEndX, ToEndY, ToEndZ, ToTargetX, ToTargetY, ToTargetZ));
+		const VectorRegister4Float RotationLimit = Batch.RotationLimits[LinkIndex];
+		const VectorRegister4Float AngleDelta = Batch.AngleDeltas[LinkIndex];
+		VectorRegister4Float Angle = VectorMin(Acos, RotationLimit);
+
+		VectorRegister4Float CanRotateMask = VectorBitwiseAnd(ActiveMask, VectorCompareEQ(Acos, Acos));
+		CanRotateMask = VectorBitwiseAnd(CanRotateMask, VectorCompareGT(VectorAbs(Angle), SmallNumber));
+		CanRotateMask = VectorBitwiseAnd(CanRotateMask, VectorSelect(RotationLimitsMask, VectorCompareGT(RotationLimit, AngleDelta), LanesTrueMask()));
+
+		// check rotation limit first, if fails, just abort
+		const VectorRegister4Float ClampMask = VectorBitwiseAnd(RotationLimitsMask, VectorCompareGT(VectorAdd(AngleDelta, Angle), RotationLimit));
+		Angle = VectorSelect(ClampMask, VectorSubtract(RotationLimit, AngleDelta), Angle);
+		const VectorRegister4Float AbortMask = VectorBitwiseAnd(ClampMask, VectorCompareGE(SmallNumber, Angle));
+		CanRotateMask = VectorSelect(AbortMask, Zero, CanRotateMask);
+
+		Batch.AngleDeltas[LinkIndex] = VectorSelect(VectorBitwiseAnd(CanRotateMask, RotationLimitsMask), VectorAdd(AngleDelta, Angle), AngleDelta);
+
+		// continue with rotating toward to target
+		VectorRegister4Float AxisX, AxisY, AxisZ;
+		LanesCross(ToEndX, ToEndY, ToEndZ, ToTargetX, ToTargetY, ToTargetZ, AxisX, AxisY, AxisZ);
+		const VectorRegister4Float RotateMask = VectorBitwiseAnd(CanRotateMask, VectorCompareGT(LanesDot(AxisX, AxisY, AxisZ, AxisX, AxisY, AxisZ), Zero));
+
+		if (VectorMaskBits(RotateMask) == 0)
+		{
+			return RotateMask;
+		}
+
+		LanesNormalize(AxisX, AxisY, AxisZ);
+
+		// Delta Rotation is the rotation to target
+		VectorRegister4Float Sin, Cos;
+		LanesSinCos(VectorMultiply(Angle, VectorSetFloat1(.5f)), Sin, Cos);
+
+		VectorRegister4Float NewX, NewY, NewZ, NewW;
+		LanesQuatMultiply(VectorMultiply(AxisX, Sin), VectorMultiply(AxisY, Sin), VectorMultiply(AxisZ, Sin), Cos
+			, Batch.RotationsX[LinkIndex], Batch.RotationsY[LinkIndex], Batch.RotationsZ[LinkIndex], Batch.RotationsW[LinkIndex]
+			, NewX, NewY, NewZ, NewW);
+		LanesQuatNormalize(NewX, NewY, NewZ, NewW);
+
+		Batch.RotationsX[LinkIndex] = VectorSelect(RotateMask, NewX, Batch.RotationsX[LinkIndex]);
+		Batch.RotationsY[LinkIndex] = VectorSelect(RotateMask, NewY, Batch.RotationsY[LinkIndex]);
+		Batch.RotationsZ[LinkIndex] = VectorSelect(RotateMask, NewZ, Batch.RotationsZ[LinkIndex]);
+		Batch.RotationsW[LinkIndex] = VectorSelect(RotateMask, NewW, Batch.RotationsW[LinkIndex]);
+
+		// refresh local rotation
+		if (LinkIndex > 0)
+		{
+			VectorRegister4Float LocalX, LocalY, LocalZ, LocalW;
+			LanesQuatMultiply(VectorNegate(Batch.RotationsX[LinkIndex - 1]), VectorNegate(Batch.RotationsY[LinkIndex - 1]), VectorNegate(Batch.RotationsZ[LinkIndex - 1]), Batch.RotationsW[LinkIndex - 1]
+				, NewX, NewY, NewZ, NewW
+				, LocalX, LocalY, LocalZ, LocalW);
+			LanesQuatNormalize(LocalX, LocalY, LocalZ, LocalW);
+
+			Batch.LocalRotationsX[LinkIndex] = VectorSelect(RotateMask, LocalX, Batch.LocalRotationsX[LinkIndex]);
+			Batch.LocalRotationsY[LinkIndex] = VectorSelect(RotateMask, LocalY, Batch.LocalRotationsY[LinkIndex]);
+			Batch.LocalRotationsZ[LinkIndex] = VectorSelect(RotateMask, LocalZ, Batch.LocalRotationsZ[LinkIndex]);
+			Batch.LocalRotationsW[LinkIndex] = VectorSelect(RotateMask, LocalW, Batch.LocalRotationsW[LinkIndex]);
+		}
+
+		// now update all my children
+		for (int32 ChildLinkIndex = LinkIndex + 1; ChildLinkIndex <= TipBoneLinkIndex; ++ChildLinkIndex)
+		{
+			const int32 ParentLinkIndex = ChildLinkIndex - 1;
+
+			VectorRegister4Float OffsetX, OffsetY, OffsetZ;
+			LanesQuatRotate(Batch.RotationsX[ParentLinkIndex], Batch.RotationsY[ParentLinkIndex], Batch.RotationsZ[ParentLinkIndex], Batch.RotationsW[ParentLinkIndex]
+				, Batch.LocalOffsetsX[ChildLinkIndex], Batch.LocalOffsetsY[ChildLinkIndex], Batch.LocalOffsetsZ[ChildLinkIndex]
+				, OffsetX, OffsetY, OffsetZ);
+
+			Batch.PositionsX[ChildLinkIndex] = VectorSelect(RotateMask, VectorAdd(Batch.PositionsX[ParentLinkIndex], OffsetX), Batch.PositionsX[ChildLinkIndex]);
+			Batch.PositionsY[ChildLinkIndex] = VectorSelect(RotateMask, VectorAdd(Batch.PositionsY[ParentLinkIndex], OffsetY), Batch.PositionsY[ChildLinkIndex]);
+			Batch.PositionsZ[ChildLinkIndex] = VectorSelect(RotateMask, VectorAdd(Batch.PositionsZ[ParentLinkIndex], OffsetZ), Batch.PositionsZ[ChildLinkIndex]);
+
+			VectorRegister4Float ChildX, ChildY, ChildZ, ChildW;
+			LanesQuatMultiply(Batch.RotationsX[ParentLinkIndex], Batch.RotationsY[ParentLinkIndex], Batch.RotationsZ[ParentLinkIndex], Batch.RotationsW[ParentLinkIndex]
+				, Batch.LocalRotationsX[ChildLinkIndex], Batch.LocalRotationsY[ChildLinkIndex], Batch.LocalRotationsZ[ChildLinkIndex], Batch.LocalRotationsW[ChildLinkIndex]
+				, ChildX, ChildY, ChildZ, ChildW);
+			LanesQuatNormalize(ChildX, ChildY, ChildZ, ChildW);
+
+			Batch.RotationsX[ChildLinkIndex] = VectorSelect(RotateMask, ChildX, Batch.RotationsX[ChildLinkIndex]);
+			Batch.RotationsY[ChildLinkIndex] = VectorSelect(RotateMask, ChildY, Batch.RotationsY[ChildLinkIndex]);
+			Batch.RotationsZ[ChildLinkIndex] = VectorSelect(RotateMask, ChildZ, Batch.RotationsZ[ChildLinkIndex]);
+			Batch.RotationsW[ChildLinkIndex] = VectorSelect(RotateMask, ChildW, Batch.RotationsW[ChildLinkIndex]);
+		}
+
+		return RotateMask;
+	}
+
+	FORCEINLINE VectorRegister4Float LanesTipDistance(const FSPW_IKChainBatch& Batch
+		, const VectorRegister4Float& TargetX, const VectorRegister4Float& TargetY, const VectorRegister4Float& TargetZ)
+	{
+		const int32 TipBoneLinkIndex = Batch.NumLinks - 1;
+		const VectorRegister4Float DeltaX = VectorSubtract(Batch.PositionsX[TipBoneLinkIndex], TargetX);
+		const VectorRegister4Float DeltaY = VectorSubtract(Batch.PositionsY[TipBoneLinkIndex], TargetY);
+		const VectorRegister4Float DeltaZ = VectorSubtract(Batch.PositionsZ[TipBoneLinkIndex], TargetZ);
+		return VectorSqrt(LanesDot(DeltaX, DeltaY, DeltaZ, DeltaX, DeltaY, DeltaZ));
+	}
+}
+
+void SPW_IK::SolveCCDIKBatch(FSPW_IKChain* const* InOutChains
+	, const FVector* TargetPositions
+	, int32 NumChains
+	, const FSPW_IKSolveSettings& Settings
+	, FSPW_IKChainBatch& Batch
+	, FSPW_IKSolveResult* OutResults)
+{
+	constexpr int32 NumLanes = FSPW_IKChainBatch::NumLanes;
+	check(NumChains > 0 && NumChains <= NumLanes);
+
+	const int32 NumChainLinks = InOutChains[0]->Num();
+	for (int32 ChainIndex = 0; ChainIndex < NumChains; ++ChainIndex)
+	{
+		check(InOutChains[ChainIndex]->Num() == NumChainLinks);
+		OutResults[ChainIndex] = FSPW_IKSolveResult();
+	}
+
+	if (NumChainLinks == 0)
+	{
+		return;
+	}
+
+	// pack (unused lanes replicate the last chain, and are kept inactive)
+	Batch.SetNumLinks(NumChainLinks);
+
+	for (int32 LinkIndex = 0; LinkIndex < NumChainLinks; ++LinkIndex)
+	{
+		alignas(16) float Values[16][NumLanes];
+
+		for (int32 Lane = 0; Lane < NumLanes; ++Lane)
+		{
+			const FSPW_IKChain& Chain = *InOutChains[FMath::Min(Lane, NumChains - 1)];
+			const FVector& Position = Chain.Positions[LinkIndex];
+			const FQuat& Rotation = Chain.Rotations[LinkIndex];
+			const FVector& LocalOffset = Chain.LocalOffsets[LinkIndex];
+			const FQuat& LocalRotation = Chain.LocalRotations[LinkIndex];
+
+			Values[0][Lane] = Position.X;
+			Values[1][Lane] = Position.Y;
+			Values[2][Lane] = Position.Z;
+			Values[3][Lane] = Rotation.X;
+			Values[4][Lane] = Rotation.Y;
+			Values[5][Lane] = Rotation.Z;
+			Values[6][Lane] = Rotation.W;
+			Values[7][Lane] = LocalOffset.X;
+			Values[8][Lane] = LocalOffset.Y;
+			Values[9][Lane] = LocalOffset.Z;
+			Values[10][Lane] = LocalRotation.X;
+			Values[11][Lane] = LocalRotation.Y;
+			Values[12][Lane] = LocalRotation.Z;
+			Values[13][Lane] = LocalRotation.W;
+			Values[14][Lane] = Chain.AngleDeltas[LinkIndex];
+			Values[15][Lane] = Chain.RotationLimits[LinkIndex];
+		}
+
+		Batch.PositionsX[LinkIndex] = VectorLoadAligned(Values[0]);
+		Batch.PositionsY[LinkIndex] = VectorLoadAligned(Values[1]);
+		Batch.PositionsZ[LinkIndex] = VectorLoadAligned(Values[2]);
+		Batch.RotationsX[LinkIndex] = VectorLoadAligned(Values[3]);
+		Batch.RotationsY[LinkIndex] = VectorLoadAligned(Values[4]);
+		Batch.RotationsZ[LinkIndex] = VectorLoadAligned(Values[5]);
+		Batch.RotationsW[LinkIndex] = VectorLoadAligned(Values[6]);
+		Batch.LocalOffsetsX[LinkIndex] = VectorLoadAligned(Values[7]);
+		Batch.LocalOffsetsY[LinkIndex] = VectorLoadAligned(Values[8]);
+		Batch.LocalOffsetsZ[LinkIndex] = VectorLoadAligned(Values[9]);
+		Batch.LocalRotationsX[LinkIndex] = VectorLoadAligned(Values[10]);
+		Batch.LocalRotationsY[LinkIndex] = VectorLoadAligned(Values[11]);
+		Batch.LocalRotationsZ[LinkIndex] = VectorLoadAligned(Values[12]);
+		Batch.LocalRotationsW[LinkIndex] = VectorLoadAligned(Values[13]);
+		Batch.AngleDeltas[LinkIndex] = VectorLoadAligned(Values[14]);
+		Batch.RotationLimits[LinkIndex] = VectorLoadAligned(Values[15]);
+	}
+
+	alignas(16) float TargetValues[3][NumLanes];
+	alignas(16) float LaneMaskValues[2][NumLanes];
+	for (int32 Lane = 0; Lane < NumLanes; ++Lane)
+	{
+		const int32 ChainIndex = FMath::Min(Lane, NumChains - 1);
+		TargetValues[0][Lane] = TargetPositions[ChainIndex].X;
+		TargetValues[1][Lane] = TargetPositions[ChainIndex].Y;
+		TargetValues[2][Lane] = TargetPositions[ChainIndex].Z;
+		LaneMaskValues[0][Lane] = Lane < NumChains ? 1.f : 0.f;
+		LaneMaskValues[1][Lane] = InOutChains[ChainIndex]->bEnableRotationLimits ? 1.f : 0.f;
+	}
+
+	const VectorRegister4Float Zero = VectorZeroFloat();
+	const VectorRegister4Float One = VectorOneFloat();
+	const VectorRegister4Float Half = VectorSetFloat1(.5f);
+	const VectorRegister4Float TargetX = VectorLoadAligned(TargetValues[0]);
+	const VectorRegister4Float TargetY = VectorLoadAligned(TargetValues[1]);
+	const VectorRegister4Float TargetZ = VectorLoadAligned(TargetValues[2]);
+	const VectorRegister4Float ValidLanesMask = VectorCompareGT(VectorLoadAligned(LaneMaskValues[0]), Half);
+	const VectorRegister4Float RotationLimitsMask = VectorCompareGT(VectorLoadAligned(LaneMaskValues[1]), Half);
+	const VectorRegister4Float Precision = VectorSetFloat1(Settings.Precision);
+
+	// iterate
+	const int32 TipBoneLinkIndex = NumChainLinks - 1;
+	VectorRegister4Float ActiveMask = VectorBitwiseAnd(ValidLanesMask, VectorCompareGT(LanesTipDistance(Batch, TargetX, TargetY, TargetZ), Precision));
+	VectorRegister4Float UpdatedMask = Zero;
+	VectorRegister4Float Iterations = Zero;
+
+	for (int32 Iteration = 0; Iteration < Settings.MaxIterations && VectorMaskBits(ActiveMask) != 0; ++Iteration)
+	{
+		Iterations = VectorAdd(Iterations, VectorSelect(ActiveMask, One, Zero));
+
+		if (Settings.bStartFromTail)
+		{
+			for (int32 LinkIndex = TipBoneLinkIndex - 1; LinkIndex > 0; --LinkIndex)
+			{
+				UpdatedMask = VectorBitwiseOr(UpdatedMask, UpdateChainLinkLanes(Batch, LinkIndex, TargetX, TargetY, TargetZ, ActiveMask, RotationLimitsMask));
+			}
+		}
+		else
+		{
+			for (int32 LinkIndex = 1; LinkIndex < TipBoneLinkIndex; ++LinkIndex)
+			{
+				UpdatedMask = VectorBitwiseOr(UpdatedMask, UpdateChainLinkLanes(Batch, LinkIndex, TargetX, TargetY, TargetZ, ActiveMask, RotationLimitsMask));
+			}
+		}
+
+		// lanes stop when close enough, or when nothing could be moved
+		ActiveMask = VectorBitwiseAnd(ActiveMask, VectorBitwiseAnd(UpdatedMask, VectorCompareGT(LanesTipDistance(Batch, TargetX, TargetY, TargetZ), Precision)));
+	}
+
+	// unpack
+	alignas(16) float IterationValues[NumLanes];
+	VectorStoreAligned(Iterations, IterationValues);
+	const int32 UpdatedBits = VectorMaskBits(UpdatedMask);
+
+	for (int32 LinkIndex = 0; LinkIndex < NumChainLinks; ++LinkIndex)
+	{
+		alignas(16) float Values[12][NumLanes];
+		VectorStoreAligned(Batch.PositionsX[LinkIndex], Values[0]);
+		VectorStoreAligned(Batch.PositionsY[LinkIndex], Values[1]);
+		VectorStoreAligned(Batch.PositionsZ[LinkIndex], Values[2]);
+		VectorStoreAligned(Batch.RotationsX[LinkIndex], Values[3]);
+		VectorStoreAligned(Batch.RotationsY[LinkIndex], Values[4]);
+		VectorStoreAligned(Batch.RotationsZ[LinkIndex], Values[5]);
+		VectorStoreAligned(Batch.RotationsW[LinkIndex], Values[6]);
+		VectorStoreAligned(Batch.LocalRotationsX[LinkIndex], Values[7]);
+		VectorStoreAligned(Batch.LocalRotationsY[LinkIndex], Values[8]);
+		VectorStoreAligned(Batch.LocalRotationsZ[LinkIndex], Values[9]);
+		VectorStoreAligned(Batch.LocalRotationsW[LinkIndex], Values[10]);
+		VectorStoreAligned(Batch.AngleDeltas[LinkIndex], Values[11]);
+
+		for (int32 ChainIndex = 0; ChainIndex < NumChains; ++ChainIndex)
+		{
+			if ((UpdatedBits & (1 << ChainIndex)) == 0)
+			{
+				// untouched lane: keep the exact input
+				continue;
+			}
+
+			FSPW_IKChain& Chain = *InOutChains[ChainIndex];
+			Chain.Positions[LinkIndex] = FVector(Values[0][ChainIndex], Values[1][ChainIndex], Values[2][ChainIndex]);
+			Chain.Rotations[LinkIndex] = FQuat(Values[3][ChainIndex], Values[4][ChainIndex], Values[5][ChainIndex], Values[6][ChainIndex]);
+			Chain.LocalRotations[LinkIndex] = FQuat(Values[7][ChainIndex], Values[8][ChainIndex], Values[9][ChainIndex], Values[10][ChainIndex]);
+			Chain.AngleDeltas[LinkIndex] = Values[11][ChainIndex];
+		}
+	}
+
+	for (int32 ChainIndex = 0; ChainIndex < NumChains; ++ChainIndex)
+	{
+		OutResults[ChainIndex].bUpdated = (UpdatedBits & (1 << ChainIndex)) != 0;
+		OutResults[ChainIndex].Iterations = FMath::RoundToInt(IterationValues[ChainIndex]);
+	}
+}
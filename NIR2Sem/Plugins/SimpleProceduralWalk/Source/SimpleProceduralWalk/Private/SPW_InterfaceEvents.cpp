@@ -0,0 +1,81 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#include "SPW_InterfaceEvents.h"
+#include "SPW.h"
+#include "SimpleProceduralWalkInterface.h"
+
+// constants
+static const int32 NUM_FRAMES_OF_EVENTS = 2;
+
+// stats
+DECLARE_DWORD_COUNTER_STAT(TEXT("Interface Events Dropped"), STAT_SimpleProceduralWalk_NumDroppedInterfaceEvents, STATGROUP_SimpleProceduralWalk);
+
+
+FSPW_InterfaceEventQueue::FSPW_InterfaceEventQueue(int32 NumEventsPerFrame)
+	// a slot is kept free to tell a full queue from an empty one
+	: Capacity((int32)FMath::RoundUpToPowerOfTwo((uint32)FMath::Max(NUM_FRAMES_OF_EVENTS * NumEventsPerFrame + 1, 2)) - 1)
+	, Events(Capacity + 1)
+{
+}
+
+bool FSPW_InterfaceEventQueue::Enqueue(const FSPW_InterfaceEvent& Event)
+{
+	if (!Events.Enqueue(Event))
+	{
+		/* -> the game thread did not dispatch for a while */
+		NumDroppedEvents.Increment();
+		INC_DWORD_STAT(STAT_SimpleProceduralWalk_NumDroppedInterfaceEvents);
+		return false;
+	}
+
+	return true;
+}
+
+int32 FSPW_InterfaceEventQueue::Dispatch(TArrayView<const TWeakObjectPtr<UObject>> Implementers)
+{
+	check(IsInGameThread());
+
+	const int32 NumDropped = NumDroppedEvents.Set(0);
+	if (NumDropped > 0)
+	{
+		UE_LOG(LogSimpleProceduralWalk, Warning, TEXT("%d interface events were dropped, the queue holds %d."), NumDropped, Capacity);
+	}
+
+	// events queued while dispatching are left for the next dispatch, the anim thread does not wait for implementers
+	int32 NumEvents = 0;
+	FSPW_InterfaceEvent Event;
+	for (int32 EventIndex = 0; EventIndex < Capacity && Events.Dequeue(Event); EventIndex++)
+	{
+		for (const TWeakObjectPtr<UObject>& ImplementerPtr : Implementers)
+		{
+			UObject* Implementer = ImplementerPtr.Get();
+			if (Implementer == nullptr)
+			{
+				continue;
+			}
+
+			switch (Event.Type)
+			{
+			case ESPW_InterfaceEventType::FootDown:
+				ISimpleProceduralWalkInterface::Execute_OnFootDown(Implementer, Event.Index, Event.TipBone, Event.Location);
+				break;
+			case ESPW_InterfaceEventType::FootUp:
+				ISimpleProceduralWalkInterface::Execute_OnFootUp(Implementer, Event.Index, Event.TipBone, Event.Location);
+				break;
+			case ESPW_InterfaceEventType::GroupDown:
+				ISimpleProceduralWalkInterface::Execute_OnGroupDown(Implementer, Event.Index, Event.Location);
+				break;
+			case ESPW_InterfaceEventType::GroupUp:
+				ISimpleProceduralWalkInterface::Execute_OnGroupUp(Implementer, Event.Index, Event.Location);
+				break;
+			case ESPW_InterfaceEventType::PawnLanded:
+				ISimpleProceduralWalkInterface::Execute_OnPawnLanded(Implementer, Event.Location);
+				break;
+			}
+		}
+
+		NumEvents++;
+	}
+
+	return NumEvents;
+}
@@ -0,0 +1,229 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#include "AnimNode_SPW.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/World.h"
+
+// stats
+DECLARE_DWORD_COUNTER_STAT(TEXT("LOD Full"), STAT_SimpleProceduralWalk_LODFull, STATGROUP_SimpleProceduralWalk);
+DECLARE_DWORD_COUNTER_STAT(TEXT("LOD Reduced Trace"), STAT_SimpleProceduralWalk_LODReducedTrace, STATGROUP_SimpleProceduralWalk);
+DECLARE_DWORD_COUNTER_STAT(TEXT("LOD Reduced IK"), STAT_SimpleProceduralWalk_LODReducedIK, STATGROUP_SimpleProceduralWalk);
+DECLARE_DWORD_COUNTER_STAT(TEXT("LOD Phase Only"), STAT_SimpleProceduralWalk_LODPhaseOnly, STATGROUP_SimpleProceduralWalk);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Idle"), STAT_SimpleProceduralWalk_NumIdle, STATGROUP_SimpleProceduralWalk);
+
+// constants
+static const float LOD_RECENTLY_RENDERED_TOLERANCE = .2f;
+// the targets of a stationary frame are traced before freezing them
+static const int32 FRAMES_TO_ENTER_IDLE = 2;
+static const float IDLE_TRANSFORM_TOLERANCE = .01f;
+
+
+void FAnimNode_SPW::CaptureLODSnapshot()
+{
+	if (!bEnableLOD)
+	{
+		return;
+	}
+
+	GameThreadSnapshot.bWasRecentlyRendered = SkeletalMeshComponent->WasRecentlyRendered(LOD_RECENTLY_RENDERED_TOLERANCE);
+
+	if (WorldContext != nullptr && WorldContext->ViewLocationsRenderedLastFrame.Num() > 0)
+	{
+		// distance to the closest view
+		FVector ComponentLocation = SkeletalMeshComponent->GetComponentLocation();
+		float MinDistanceSquared = BIG_NUMBER;
+		for (const FVector& ViewLocation : WorldContext->ViewLocationsRenderedLastFrame)
+		{
+			MinDistanceSquared = FMath::Min(MinDistanceSquared, (float)FVector::DistSquared(ViewLocation, ComponentLocation));
+		}
+		GameThreadSnapshot.ClosestViewDistanceSquared = MinDistanceSquared;
+	}
+}
+
+void FAnimNode_SPW::UpdateLODTier()
+{
+	ESimpleProceduralWalk_LODTier PreviousLODTier = LODTier;
+	LODTier = ESimpleProceduralWalk_LODTier::FULL;
+
+	if (bIsReplaying)
+	{
+		// as recorded (there are no views)
+		LODTier = FrameInputs.LODTier;
+	}
+	else if (bEnableLOD && bIsInitialized)
+	{
+		if (bLODPhaseOnlyWhenNotRendered && !GameThreadSnapshot.bWasRecentlyRendered)
+		{
+			/* -> not visible */
+			LODTier = ESimpleProceduralWalk_LODTier::PHASE_ONLY;
+		}
+		else if (GameThreadSnapshot.ClosestViewDistanceSquared >= 0.f)
+		{
+			// distance to the closest view
+			float MinDistanceSquared = GameThreadSnapshot.ClosestViewDistanceSquared;
+
+			if (MinDistanceSquared >= FMath::Square(LODPhaseOnlyDistance))
+			{
+				LODTier = ESimpleProceduralWalk_LODTier::PHASE_ONLY;
+			}
+			else if (MinDistanceSquared >= FMath::Square(LODReducedIKDistance))
+			{
+				LODTier = ESimpleProceduralWalk_LODTier::REDUCED_IK;
+			}
+			else if (MinDistanceSquared >= FMath::Square(LODReducedTraceDistance))
+			{
+				LODTier = ESimpleProceduralWalk_LODTier::REDUCED_TRACE;
+			}
+		}
+		/* -> else no views (i.e. no rendering), keep full */
+	}
+
+	FrameInputs.LODTier = LODTier;
+
+	if (LODTier != PreviousLODTier)
+	{
+		UE_LOG(LogSimpleProceduralWalk, Verbose, TEXT("LOD tier changed to %s."), *UEnum::GetDisplayValueAsText(LODTier).ToString());
+
+		if (LODTier < PreviousLODTier)
+		{
+			/* -> more details, refresh traces right away */
+			FramesSinceTracesRefresh = LODTraceRefreshInterval;
+		}
+	}
+
+	// stats
+	switch (LODTier)
+	{
+	case ESimpleProceduralWalk_LODTier::FULL:
+		INC_DWORD_STAT(STAT_SimpleProceduralWalk_LODFull);
+		break;
+	case ESimpleProceduralWalk_LODTier::REDUCED_TRACE:
+		INC_DWORD_STAT(STAT_SimpleProceduralWalk_LODReducedTrace);
+		break;
+	case ESimpleProceduralWalk_LODTier::REDUCED_IK:
+		INC_DWORD_STAT(STAT_SimpleProceduralWalk_LODReducedIK);
+		break;
+	case ESimpleProceduralWalk_LODTier::PHASE_ONLY:
+		INC_DWORD_STAT(STAT_SimpleProceduralWalk_LODPhaseOnly);
+		break;
+	}
+}
+
+bool FAnimNode_SPW::ShouldRefreshTraces()
+{
+	if (LODTier == ESimpleProceduralWalk_LODTier::FULL)
+	{
+		FramesSinceTracesRefresh = 0;
+		return true;
+	}
+
+	if (++FramesSinceTracesRefresh >= LODTraceRefreshInterval)
+	{
+		FramesSinceTracesRefresh = 0;
+		return true;
+	}
+
+	return false;
+}
+
+void FAnimNode_SPW::CarryFeetTargets()
+{
+	const FTransform& ActorTransform = FrameInputs.GetActorTransform();
+
+	for (int LegIndex = 0; LegIndex < Legs.Num(); LegIndex++)
+	{
+		if (IsLegUnplanted(LegIndex) && GetLegStepPercent(LegIndex) >= FixFeetTargetsAfterPercent)
+		{
+			/* -> too far along the step, as with traces only follow the moving platform */
+			LegsData[LegIndex].FootTarget += LegsData[LegIndex].SupportCompDelta;
+		}
+		else if (IsLegUnplanted(LegIndex) && IsUsingPredictiveFootPlacement() && LegsData[LegIndex].bIsLandingPredicted)
+		{
+			/* -> the predicted landing already accounts for the pawn's motion, only follow the moving platform */
+			LegsData[LegIndex].FootTarget += LegsData[LegIndex].SupportCompDelta;
+		}
+		else
+		{
+			/* -> follow the pawn since the last trace */
+			LegsData[LegIndex].FootTarget = ActorTransform.TransformPosition(LegsData[LegIndex].FootTargetRelLocation);
+		}
+	}
+}
+
+void FAnimNode_SPW::UpdateIdleState()
+{
+	if (!bEnableIdleMode || bIsFalling)
+	{
+		bIsIdle = false;
+		StationaryFrames = 0;
+		return;
+	}
+
+	if (!IsStationary())
+	{
+		if (bIsIdle)
+		{
+			UE_LOG(LogSimpleProceduralWalk, Verbose, TEXT("Leaving idle."));
+
+			// refresh traces right away
+			FramesSinceTracesRefresh = LODTraceRefreshInterval;
+		}
+
+		bIsIdle = false;
+		StationaryFrames = 0;
+		return;
+	}
+
+	if (!bIsIdle && ++StationaryFrames >= FRAMES_TO_ENTER_IDLE)
+	{
+		UE_LOG(LogSimpleProceduralWalk, Verbose, TEXT("Entering idle."));
+
+		bIsIdle = true;
+		IdleActorTransform = FrameInputs.GetActorTransform();
+		IdleMovementBaseId = FrameInputs.MovementBaseId;
+	}
+
+	if (bIsIdle)
+	{
+		INC_DWORD_STAT(STAT_SimpleProceduralWalk_NumIdle);
+	}
+}
+
+bool FAnimNode_SPW::IsStationary() const
+{
+	// pawn
+	if (Speed > 0.f || !FMath::IsNearlyZero(YawDelta))
+	{
+		return false;
+	}
+
+	// steps
+	for (const FSimpleProceduralWalk_LegGroupData& GroupData : GroupsData)
+	{
+		if (GroupData.bIsUnplanted)
+		{
+			return false;
+		}
+	}
+
+	// components under the feet
+	for (const FSimpleProceduralWalk_LegData& LegData : LegsData)
+	{
+		if (!LegData.SupportCompDelta.IsNearlyZero())
+		{
+			return false;
+		}
+	}
+
+	if (bIsIdle)
+	{
+		// moved without velocity (i.e. teleported) or changed base
+		if (!FrameInputs.GetActorTransform().Equals(IdleActorTransform, IDLE_TRANSFORM_TOLERANCE)
+			|| FrameInputs.MovementBaseId != IdleMovementBaseId)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
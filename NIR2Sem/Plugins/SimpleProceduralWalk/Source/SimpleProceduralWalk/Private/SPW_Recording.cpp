@@ -0,0 +1,199 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#include "AnimNode_SPW.h"
+#include "Animation/AnimInstanceProxy.h"
+#include "Async/Async.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "GameFramework/Pawn.h"
+#include "Misc/Paths.h"
+
+// stats
+DECLARE_DWORD_COUNTER_STAT(TEXT("Recorded Frames"), STAT_SimpleProceduralWalk_NumRecordedFrames, STATGROUP_SimpleProceduralWalk);
+
+
+/*
+ * RECORD
+ */
+void FAnimNode_SPW::Initialize_Recording()
+{
+	Recording.Reset();
+	RecordedBonesSerialNumber = INDEX_NONE;
+
+	if (!bRecordFrames)
+	{
+		return;
+	}
+
+	if (bAsyncTraces)
+	{
+		// async results depend on when the game thread got them
+		UE_LOG(LogSimpleProceduralWalk, Warning, TEXT("Frames cannot be recorded with async traces, recording is disabled."));
+		return;
+	}
+
+	Recording = MakeShared<FSPW_FrameRecording, ESPMode::ThreadSafe>();
+	FAnimNode_SPW::StaticStruct()->ExportText(Recording->NodeSettings, this, nullptr, nullptr, PPF_None, nullptr);
+	Recording->SkeletalMeshPath = SkeletalMeshComponent->SkeletalMesh->GetPathName();
+	Recording->OwnerHalfHeight = OwnerHalfHeight;
+	Recording->FramesSinceTracesRefresh = FramesSinceTracesRefresh;
+	Recording->Frames.Reserve(RecordedFrames);
+	Recording->Outputs.Reserve(RecordedFrames);
+
+	RecordingFilename = FPaths::ProjectSavedDir() / TEXT("SimpleProceduralWalk") / OwnerPawn->GetName() + TEXT(".spwrec");
+	UE_LOG(LogSimpleProceduralWalk, Log, TEXT("Recording %d frames to %s."), RecordedFrames, *RecordingFilename);
+}
+
+void FAnimNode_SPW::CaptureFrameInputs(FComponentSpacePoseContext& Output)
+{
+	FrameInputs.Reset(Legs.Num());
+	FrameInputs.DeltaSeconds = WorldDeltaSeconds;
+
+	// pawn, as of PreUpdate
+	FrameInputs.ActorTransform = GameThreadSnapshot.ActorTransform;
+	FrameInputs.ActorRotation = GameThreadSnapshot.ActorRotation;
+	FrameInputs.Velocity = GameThreadSnapshot.Velocity;
+	FrameInputs.MovementBaseId = GameThreadSnapshot.MovementBaseId;
+
+	// mesh
+	FrameInputs.ComponentTransform = Output.AnimInstanceProxy->GetComponentTransform();
+
+	// legs, from the input pose of this frame
+	const FBoneContainer& BoneContainer = Output.Pose.GetPose().GetBoneContainer();
+	if (!RigDescriptor.IsValid() || BoneContainer.GetSerialNumber() != LegsChainDataSerialNumber)
+	{
+		Initialize_LegChains(BoneContainer);
+	}
+
+	for (int LegIndex = 0; LegIndex < Legs.Num(); LegIndex++)
+	{
+		const FSimpleProceduralWalk_LegChainData& ChainData = RigDescriptor->LegsChainData[LegIndex];
+		if (ChainData.HasLegBones())
+		{
+			FrameInputs.ParentBoneLocations[LegIndex] = FrameInputs.ComponentTransform.TransformPosition(Output.Pose.GetComponentSpaceTransform(ChainData.GetParentBoneIndex()).GetLocation());
+			FrameInputs.TipBoneLocations[LegIndex] = FrameInputs.ComponentTransform.TransformPosition(Output.Pose.GetComponentSpaceTransform(ChainData.GetTipBoneIndex()).GetLocation());
+		}
+		else
+		{
+			/* -> bones not in the required bones (i.e. LOD), the leg is traced from the mesh */
+			FrameInputs.ParentBoneLocations[LegIndex] = FrameInputs.ComponentTransform.GetLocation();
+			FrameInputs.TipBoneLocations[LegIndex] = FrameInputs.ComponentTransform.GetLocation();
+		}
+	}
+
+	if (Recording.IsValid())
+	{
+		// input pose
+		const FCompactPose& LocalPose = Output.Pose.GetPose();
+		if (BoneContainer.GetSerialNumber() != RecordedBonesSerialNumber)
+		{
+			FrameInputs.RequiredBones = BoneContainer.GetBoneIndicesArray();
+			RecordedBonesSerialNumber = BoneContainer.GetSerialNumber();
+		}
+
+		FrameInputs.LocalPose.Reserve(LocalPose.GetNumBones());
+		for (FCompactPoseBoneIndex BoneIndex : LocalPose.ForEachBoneIndex())
+		{
+			FrameInputs.LocalPose.Add(LocalPose[BoneIndex]);
+		}
+	}
+}
+
+void FAnimNode_SPW::RecordFrame(const TArray<FBoneTransform>& OutBoneTransforms)
+{
+	if (!Recording.IsValid())
+	{
+		return;
+	}
+
+	INC_DWORD_STAT(STAT_SimpleProceduralWalk_NumRecordedFrames);
+
+	Recording->Frames.Add(FrameInputs);
+	Recording->Outputs.AddDefaulted_GetRef().Set(OutBoneTransforms);
+
+	if (Recording->Frames.Num() >= RecordedFrames)
+	{
+		// written off the anim thread
+		TSharedPtr<FSPW_FrameRecording, ESPMode::ThreadSafe> FinishedRecording = Recording;
+		FString Filename = RecordingFilename;
+		Async(EAsyncExecution::ThreadPool, [FinishedRecording, Filename]() {
+			FinishedRecording->SaveToFile(Filename);
+		});
+
+		Recording.Reset();
+	}
+}
+
+void FAnimNode_SPW::RecordHit(const FHitResult& Hit)
+{
+	if (Recording.IsValid())
+	{
+		FrameInputs.Hits.Emplace(Hit);
+	}
+}
+
+/*
+ * REPLAY
+ */
+bool FAnimNode_SPW::InitializeReplay(const FSPW_FrameRecording& InRecording)
+{
+	// no world
+	WorldContext = nullptr;
+	SkeletalMeshComponent = nullptr;
+	OwnerPawn = nullptr;
+	bIsPlaying = true;
+	bIsEditorAnimPreview = false;
+	bIsReplaying = true;
+
+	// nothing to draw nor to record
+	bDebug = false;
+	bRecordFrames = false;
+
+	if (Legs.Num() == 0 || LegGroups.Num() == 0 || bAsyncTraces)
+	{
+		UE_LOG(LogSimpleProceduralWalk, Error, TEXT("The recorded settings cannot be replayed."));
+		return false;
+	}
+
+	OwnerHalfHeight = InRecording.OwnerHalfHeight;
+	Initialize_Computations();
+	Initialize_CCDIK();
+
+	// as when recording started
+	FramesSinceTracesRefresh = InRecording.FramesSinceTracesRefresh;
+
+	return !bHasErrors;
+}
+
+void FAnimNode_SPW::ReplayFrame(const FSPW_FrameInputs& Inputs
+	, FCSPose<FCompactPose>& Pose
+	, TArray<FBoneTransform>& OutBoneTransforms
+	, FSPW_ReplayTimings* OutTimings)
+{
+	check(bIsReplaying);
+
+	FrameInputs = Inputs;
+	ReplayedHitIndex = 0;
+	WorldDeltaSeconds = FrameInputs.DeltaSeconds;
+
+	Evaluate_Frame(Pose, OutBoneTransforms, OutTimings);
+
+	if (ReplayedHitIndex != FrameInputs.Hits.Num())
+	{
+		UE_LOG(LogSimpleProceduralWalk, Warning, TEXT("Replay diverged: %d traces made instead of %d."), ReplayedHitIndex, FrameInputs.Hits.Num());
+	}
+}
+
+bool FAnimNode_SPW::ReplayHit(FHitResult& OutHit)
+{
+	if (!FrameInputs.Hits.IsValidIndex(ReplayedHitIndex))
+	{
+		/* -> more traces than recorded, counted as misses */
+		++ReplayedHitIndex;
+		OutHit = FHitResult();
+		return false;
+	}
+
+	const FSPW_RecordedHit& Hit = FrameInputs.Hits[ReplayedHitIndex++];
+	Hit.ToHitResult(OutHit);
+	return Hit.bBlockingHit;
+}
@@ -0,0 +1,321 @@
+// Copyright Epic Games, Inc. and Roberto Ostinelli, 2021. All Rights Reserved.
+
+#include "SPW_RigDescriptor.h"
+#include "Algo/Reverse.h"
+#include "Animation/Skeleton.h"
+#include "Engine/SkeletalMesh.h"
+#include "UObject/ObjectKey.h"
+
+// stats
+DECLARE_DWORD_COUNTER_STAT(TEXT("Rig Descriptors Created"), STAT_SimpleProceduralWalk_NumRigDescriptorsCreated, STATGROUP_SimpleProceduralWalk);
+
+
+namespace
+{
+	struct FSPW_RigDescriptorKeyLeg
+	{
+		FName ParentBoneName;
+		FName TipBoneName;
+		TArray<float> RotationLimitPerJoints;
+
+		bool operator==(const FSPW_RigDescriptorKeyLeg& Other) const
+		{
+			return ParentBoneName == Other.ParentBoneName
+				&& TipBoneName == Other.TipBoneName
+				&& RotationLimitPerJoints == Other.RotationLimitPerJoints;
+		}
+	};
+
+	/**
+	 * What a descriptor is made of.
+	 * The hashes only speed up the lookups, keys are equal when their data is.
+	 */
+	struct FSPW_RigDescriptorKey
+	{
+		TObjectKey<USkeleton> Skeleton;
+		TObjectKey<USkeletalMesh> SkeletalMesh;
+		TArray<FBoneIndexType> RequiredBoneIndices;
+		FName BodyBoneName;
+		TArray<FSPW_RigDescriptorKeyLeg> Legs;
+		TArray<TArray<int32>> LegGroupsIndices;
+		uint32 RequiredBonesHash = 0;
+		uint32 SettingsHash = 0;
+
+		bool operator==(const FSPW_RigDescriptorKey& Other) const
+		{
+			return RequiredBonesHash == Other.RequiredBonesHash
+				&& SettingsHash == Other.SettingsHash
+				&& Skeleton == Other.Skeleton
+				&& SkeletalMesh == Other.SkeletalMesh
+				&& BodyBoneName == Other.BodyBoneName
+				&& RequiredBoneIndices == Other.RequiredBoneIndices
+				&& Legs == Other.Legs
+				&& LegGroupsIndices == Other.LegGroupsIndices;
+		}
+
+		friend uint32 GetTypeHash(const FSPW_RigDescriptorKey& Key)
+		{
+			return HashCombine(HashCombine(GetTypeHash(Key.Skeleton), GetTypeHash(Key.SkeletalMesh)), HashCombine(Key.RequiredBonesHash, Key.SettingsHash));
+		}
+	};
+
+	FSPW_RigDescriptorKey MakeKey(const TArray<FSimpleProceduralWalk_Leg>& Legs
+		, const TArray<FSimpleProceduralWalk_LegGroup>& LegGroups
+		, const FBoneReference& BodyBone
+		, const FBoneContainer& RequiredBones)
+	{
+		FSPW_RigDescriptorKey Key;
+		Key.Skeleton = RequiredBones.GetSkeletonAsset();
+		Key.SkeletalMesh = RequiredBones.GetSkeletalMeshAsset();
+
+		// the required bones change with the mesh LOD
+		Key.RequiredBoneIndices = RequiredBones.GetBoneIndicesArray();
+		Key.RequiredBonesHash = FCrc::MemCrc32(Key.RequiredBoneIndices.GetData(), Key.RequiredBoneIndices.Num() * Key.RequiredBoneIndices.GetTypeSize());
+
+		// settings that the descriptor is made of
+		Key.BodyBoneName = BodyBone.BoneName;
+		uint32 SettingsHash = GetTypeHash(BodyBone.BoneName);
+
+		Key.Legs.Reserve(Legs.Num());
+		for (const FSimpleProceduralWalk_Leg& Leg : Legs)
+		{
+			FSPW_RigDescriptorKeyLeg& KeyLeg = Key.Legs.AddDefaulted_GetRef();
+			KeyLeg.ParentBoneName = Leg.ParentBone.BoneName;
+			KeyLeg.TipBoneName = Leg.TipBone.BoneName;
+			KeyLeg.RotationLimitPerJoints = Leg.RotationLimitPerJoints;
+
+			SettingsHash = HashCombine(SettingsHash, GetTypeHash(Leg.ParentBone.BoneName));
+			SettingsHash = HashCombine(SettingsHash, GetTypeHash(Leg.TipBone.BoneName));
+			for (float RotationLimit : Leg.RotationLimitPerJoints)
+			{
+				SettingsHash = HashCombine(SettingsHash, GetTypeHash(RotationLimit));
+			}
+		}
+
+		Key.LegGroupsIndices.Reserve(LegGroups.Num());
+		for (const FSimpleProceduralWalk_LegGroup& LegGroup : LegGroups)
+		{
+			Key.LegGroupsIndices.Add(LegGroup.LegIndices);
+
+			SettingsHash = HashCombine(SettingsHash, GetTypeHash(LegGroup.LegIndices.Num()));
+			for (int32 LegIndex : LegGroup.LegIndices)
+			{
+				SettingsHash = HashCombine(SettingsHash, GetTypeHash(LegIndex));
+			}
+		}
+		Key.SettingsHash = SettingsHash;
+
+		return Key;
+	}
+
+	// descriptors are only kept while some node holds them
+	FCriticalSection RegistryCriticalSection;
+	TMap<FSPW_RigDescriptorKey, TWeakPtr<const FSPW_RigDescriptor, ESPMode::ThreadSafe>> Registry;
+}
+
+TSharedRef<const FSPW_RigDescriptor, ESPMode::ThreadSafe> FSPW_RigDescriptor::FindOrCreate(const TArray<FSimpleProceduralWalk_Leg>& Legs
+	, const TArray<FSimpleProceduralWalk_LegGroup>& LegGroups
+	, const FBoneReference& BodyBone
+	, const FBoneContainer& RequiredBones)
+{
+	const FSPW_RigDescriptorKey Key = MakeKey(Legs, LegGroups, BodyBone, RequiredBones);
+
+	FScopeLock Lock(&RegistryCriticalSection);
+
+	if (const TWeakPtr<const FSPW_RigDescriptor, ESPMode::ThreadSafe>* ExistingDescriptor = Registry.Find(Key))
+	{
+		if (TSharedPtr<const FSPW_RigDescriptor, ESPMode::ThreadSafe> Descriptor = ExistingDescriptor->Pin())
+		{
+			return Descriptor.ToSharedRef();
+		}
+	}
+
+	// forget the descriptors that are not used anymore
+	for (auto It = Registry.CreateIterator(); It; ++It)
+	{
+		if (!It.Value().IsValid())
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	TSharedRef<FSPW_RigDescriptor, ESPMode::ThreadSafe> Descriptor = MakeShared<FSPW_RigDescriptor, ESPMode::ThreadSafe>();
+	Descriptor->Initialize(Legs, LegGroups, BodyBone, RequiredBones);
+	Registry.Add(Key, Descriptor);
+
+	INC_DWORD_STAT(STAT_SimpleProceduralWalk_NumRigDescriptorsCreated);
+	UE_LOG(LogSimpleProceduralWalk, Verbose, TEXT("Rig descriptor created for %s (%d legs, %llu bytes)."), *GetNameSafe(RequiredBones.GetSkeletalMeshAsset()), Legs.Num(), (uint64)Descriptor->GetAllocatedSize());
+
+	return Descriptor;
+}
+
+SIZE_T FSPW_RigDescriptor::GetAllocatedSize() const
+{
+	SIZE_T AllocatedSize = ParentBones.GetAllocatedSize()
+		+ TipBones.GetAllocatedSize()
+		+ EffectorTargets.GetAllocatedSize()
+		+ LegsChainData.GetAllocatedSize()
+		+ LegsGroupIndex.GetAllocatedSize();
+
+	for (const FSimpleProceduralWalk_LegChainData& ChainData : LegsChainData)
+	{
+		AllocatedSize += ChainData.BoneIndices.GetAllocatedSize()
+			+ ChainData.LinkTransformIndices.GetAllocatedSize()
+			+ ChainData.LinkRotationLimits.GetAllocatedSize();
+	}
+
+	return AllocatedSize;
+}
+
+void FSPW_RigDescriptor::Initialize(const TArray<FSimpleProceduralWalk_Leg>& Legs
+	, const TArray<FSimpleProceduralWalk_LegGroup>& LegGroups
+	, FBoneReference BodyBone
+	, const FBoneContainer& RequiredBones)
+{
+	BodyBone.Initialize(RequiredBones);
+
+	// bones
+	ParentBones.Reserve(Legs.Num());
+	TipBones.Reserve(Legs.Num());
+	EffectorTargets.Reserve(Legs.Num());
+	for (const FSimpleProceduralWalk_Leg& Leg : Legs)
+	{
+		InitializeLegBones(Leg, RequiredBones);
+	}
+
+	// chains
+	LegsChainData.SetNum(Legs.Num());
+	for (int LegIndex = 0; LegIndex < Legs.Num(); LegIndex++)
+	{
+		InitializeLegChain(LegIndex, Legs[LegIndex], BodyBone, RequiredBones);
+	}
+
+	// groups
+	LegsGroupIndex.SetNumZeroed(Legs.Num());
+	for (int GroupIndex = 0; GroupIndex < LegGroups.Num(); GroupIndex++)
+	{
+		for (int LegIndex : LegGroups[GroupIndex].LegIndices)
+		{
+			if (LegsGroupIndex.IsValidIndex(LegIndex))
+			{
+				LegsGroupIndex[LegIndex] = GroupIndex;
+			}
+		}
+	}
+}
+
+void FSPW_RigDescriptor::InitializeLegBones(const FSimpleProceduralWalk_Leg& InLeg, const FBoneContainer& RequiredBones)
+{
+	FSimpleProceduralWalk_Leg Leg = InLeg;
+
+	if (Leg.ParentBone.Initialize(RequiredBones))
+	{
+		// CCDIK exclude the parent bone from the solver, so in order to keep a simple UX in selecting the bones,
+		// we have to add the parent's parent here.
+		// NB: the fact that the parent bone is NOT root is ensured by the validation in the AnimGraphNode.
+		const FCompactPoseBoneIndex ParentParentIndex = RequiredBones.GetParentBoneIndex(Leg.ParentBone.GetCompactPoseIndex(RequiredBones));
+		FBoneReference ParentParentBone = RequiredBones.GetReferenceSkeleton().GetBoneName(ParentParentIndex.GetInt());
+
+		if (ParentParentBone.Initialize(RequiredBones))
+		{
+			ParentBones.Emplace(ParentParentBone);
+			UE_LOG(LogSimpleProceduralWalk, VeryVerbose, TEXT("%s bone's parent initialized."), *Leg.ParentBone.BoneName.ToString());
+		}
+		else
+		{
+			UE_LOG(LogSimpleProceduralWalk, Error, TEXT("Could not initialize %s bone's parent."), *Leg.ParentBone.BoneName.ToString());
+		}
+
+		// init effector target
+		FBoneSocketTarget EffectorTarget = FBoneSocketTarget(ParentParentBone.BoneName);
+		EffectorTarget.InitializeBoneReferences(RequiredBones);
+		EffectorTargets.Emplace(EffectorTarget);
+	}
+	else
+	{
+		UE_LOG(LogSimpleProceduralWalk, Error, TEXT("Could not initialize bone %s."), *Leg.ParentBone.BoneName.ToString());
+	}
+
+	if (Leg.TipBone.Initialize(RequiredBones))
+	{
+		TipBones.Emplace(Leg.TipBone);
+		UE_LOG(LogSimpleProceduralWalk, VeryVerbose, TEXT("%s bone initialized."), *Leg.TipBone.BoneName.ToString());
+	}
+	else
+	{
+		UE_LOG(LogSimpleProceduralWalk, Error, TEXT("Could not initialize bone %s."), *Leg.TipBone.BoneName.ToString());
+	}
+}
+
+void FSPW_RigDescriptor::InitializeLegChain(int32 LegIndex
+	, const FSimpleProceduralWalk_Leg& Leg
+	, const FBoneReference& BodyBone
+	, const FBoneContainer& RequiredBones)
+{
+	FSimpleProceduralWalk_LegChainData& ChainData = LegsChainData[LegIndex];
+
+	if (!ParentBones.IsValidIndex(LegIndex) || !TipBones.IsValidIndex(LegIndex))
+	{
+		return;
+	}
+
+	// gather all bone indices from tip to root
+	const FCompactPoseBoneIndex RootIndex = ParentBones[LegIndex].GetCompactPoseIndex(RequiredBones);
+	FCompactPoseBoneIndex BoneIndex = TipBones[LegIndex].GetCompactPoseIndex(RequiredBones);
+	while (BoneIndex != INDEX_NONE && BoneIndex != RootIndex)
+	{
+		ChainData.BoneIndices.Add(BoneIndex);
+		BoneIndex = RequiredBones.GetParentBoneIndex(BoneIndex);
+	}
+
+	if (BoneIndex == INDEX_NONE)
+	{
+		UE_LOG(LogSimpleProceduralWalk, Error, TEXT("Bone %s is not a child of %s."), *TipBones[LegIndex].BoneName.ToString(), *ParentBones[LegIndex].BoneName.ToString());
+		ChainData.BoneIndices.Reset();
+		return;
+	}
+
+	// then root to tip
+	ChainData.BoneIndices.Add(BoneIndex);
+	Algo::Reverse(ChainData.BoneIndices);
+
+	// does the body solver move this leg?
+	ChainData.bIsChildOfBody = false;
+	const FCompactPoseBoneIndex BodyIndex = BodyBone.GetCompactPoseIndex(RequiredBones);
+	for (FCompactPoseBoneIndex ParentIndex = RootIndex; BodyIndex != INDEX_NONE && ParentIndex != INDEX_NONE; ParentIndex = RequiredBones.GetParentBoneIndex(ParentIndex))
+	{
+		if (ParentIndex == BodyIndex)
+		{
+			ChainData.bIsChildOfBody = true;
+			break;
+		}
+	}
+
+	// root reference transform in component space
+	FTransform RefCSTransform = FTransform::Identity;
+	for (FCompactPoseBoneIndex ParentIndex = RootIndex; ParentIndex != INDEX_NONE; ParentIndex = RequiredBones.GetParentBoneIndex(ParentIndex))
+	{
+		RefCSTransform = RefCSTransform * RequiredBones.GetRefPoseTransform(ParentIndex);
+	}
+
+	// links are the root and the bones with a length, zero length bones inherit position and delta rotation from the previous link
+	for (int32 TransformIndex = 0; TransformIndex < ChainData.BoneIndices.Num(); TransformIndex++)
+	{
+		const FVector PreviousLocation = RefCSTransform.GetLocation();
+		if (TransformIndex > 0)
+		{
+			RefCSTransform = RequiredBones.GetRefPoseTransform(ChainData.BoneIndices[TransformIndex]) * RefCSTransform;
+		}
+
+		if (TransformIndex == 0 || !FMath::IsNearlyZero(FVector::Dist(RefCSTransform.GetLocation(), PreviousLocation)))
+		{
+			// limits are per link, index 0 being the root
+			const int32 LinkIndex = ChainData.LinkTransformIndices.Num();
+			const TArray<float>& RotationLimitPerJoints = Leg.RotationLimitPerJoints;
+			const float RotationLimit = (LinkIndex > 0 && RotationLimitPerJoints.IsValidIndex(LinkIndex - 1)) ? RotationLimitPerJoints[LinkIndex - 1] : 0.f;
+
+			ChainData.LinkTransformIndices.Add(TransformIndex);
+			ChainData.LinkRotationLimits.Add(FMath::DegreesToRadians(RotationLimit));
+		}
+	}
+}
@@ -0,0 +1,96 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#include "AnimNode_SPW.h"
+#include "SPW_GaitStateComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "GameFramework/Pawn.h"
+
+// stats
+DECLARE_CYCLE_STAT(TEXT("Game Thread Snapshot"), STAT_SimpleProceduralWalk_GameThreadSnapshot, STATGROUP_SimpleProceduralWalk);
+
+
+void FAnimNode_SPW::CaptureGameThreadSnapshot()
+{
+	check(IsInGameThread());
+	SCOPE_CYCLE_COUNTER(STAT_SimpleProceduralWalk_GameThreadSnapshot);
+
+	GameThreadSnapshot.Reset();
+
+	// debug, also drawn by the editor preview which evaluates nothing
+	if ((bDebug || bIsEditorAnimPreview) && IsValid(SkeletalMeshComponent) && IsValid(SkeletalMeshComponent->SkeletalMesh))
+	{
+		GameThreadSnapshot.MeshBoxSize = SkeletalMeshComponent->SkeletalMesh->GetBounds().BoxExtent.Size();
+	}
+
+	if (!bIsPlaying || bHasErrors || !IsValid(OwnerPawn) || !IsValid(SkeletalMeshComponent) || LegsData.Num() != Legs.Num())
+	{
+		/* -> nothing to evaluate */
+		return;
+	}
+
+	// pawn
+	GameThreadSnapshot.ActorTransform = OwnerPawn->GetActorTransform();
+	GameThreadSnapshot.ActorRotation = OwnerPawn->GetActorRotation();
+	GameThreadSnapshot.Velocity = OwnerPawn->GetVelocity();
+	UPrimitiveComponent* MovementBase = OwnerPawn->GetMovementBase();
+	GameThreadSnapshot.MovementBaseId = IsValid(MovementBase) ? MovementBase->GetUniqueID() : 0;
+
+	// support components found by the previous evaluations, once per component
+	GameThreadSnapshot.SupportComps.SetNumZeroed(SupportCompTable.Num());
+	GameThreadSnapshot.SupportCompTransforms.SetNum(SupportCompTable.Num());
+	for (int32 Index = 0; Index < SupportCompTable.Num(); Index++)
+	{
+		const UPrimitiveComponent* SupportComp = SupportCompTable[Index].Component;
+		if (SupportCompTable[Index].NumLegs > 0 && IsValid(SupportComp))
+		{
+			GameThreadSnapshot.SupportComps[Index] = SupportComp;
+			GameThreadSnapshot.SupportCompTransforms[Index] = SupportComp->GetComponentTransform();
+		}
+	}
+
+	// LOD
+	CaptureLODSnapshot();
+
+	// gait phase hand over
+	CaptureGaitStateSnapshot();
+
+	// async traces submitted during the previous frame
+	if (AsyncTraceBatch.IsValid() && WorldContext != nullptr)
+	{
+		AsyncTraceBatch->GatherResults(WorldContext);
+	}
+
+	GameThreadSnapshot.bIsValid = true;
+}
+
+void FAnimNode_SPW::CaptureGaitStateSnapshot()
+{
+	if (bIsReplaying || !bIsInitialized)
+	{
+		/* -> a phase handed over now waits for the feet to be initialized */
+		return;
+	}
+
+	if (!bHasSearchedGaitStateComponent)
+	{
+		GaitStateComponent = OwnerPawn->FindComponentByClass<USPW_GaitStateComponent>();
+		bHasSearchedGaitStateComponent = true;
+	}
+
+	USPW_GaitStateComponent* Component = GaitStateComponent.Get();
+	if (Component == nullptr)
+	{
+		return;
+	}
+
+	if (Component->ConsumeHandedOverGaitState(GameThreadSnapshot.HandedOverGaitState))
+	{
+		/* -> the coming evaluation continues from the handed over phase */
+		GameThreadSnapshot.bHasHandedOverGaitState = true;
+	}
+	else if (GaitState.IsValid())
+	{
+		/* -> publish the phase of the previous evaluation */
+		Component->SetGaitState(GaitState);
+	}
+}
@@ -0,0 +1,75 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#include "SPW_SupportCompTable.h"
+#include "Components/PrimitiveComponent.h"
+
+
+int32 FSPW_SupportCompTable::AddLeg(const UPrimitiveComponent* Component)
+{
+	if (!IsValid(Component) || Component->Mobility == EComponentMobility::Static)
+	{
+		return INDEX_NONE;
+	}
+
+	int32 FreeIndex = INDEX_NONE;
+	for (int32 Index = 0; Index < Entries.Num(); Index++)
+	{
+		if (Entries[Index].NumLegs == 0)
+		{
+			FreeIndex = FreeIndex == INDEX_NONE ? Index : FreeIndex;
+		}
+		else if (Entries[Index].Component == Component)
+		{
+			++Entries[Index].NumLegs;
+			return Index;
+		}
+	}
+
+	// new component
+	FSPW_SupportComp& Entry = FreeIndex != INDEX_NONE ? Entries[FreeIndex] : Entries.AddDefaulted_GetRef();
+	Entry = FSPW_SupportComp();
+	Entry.Component = Component;
+	Entry.NumLegs = 1;
+	return FreeIndex != INDEX_NONE ? FreeIndex : Entries.Num() - 1;
+}
+
+void FSPW_SupportCompTable::RemoveLeg(int32 Index)
+{
+	if (!Entries.IsValidIndex(Index) || Entries[Index].NumLegs == 0)
+	{
+		return;
+	}
+
+	if (--Entries[Index].NumLegs == 0)
+	{
+		Entries[Index] = FSPW_SupportComp();
+	}
+}
+
+void FSPW_SupportCompTable::Update(const TArray<const UPrimitiveComponent*>& InComponents, const TArray<FTransform>& InTransforms)
+{
+	for (int32 Index = 0; Index < Entries.Num(); Index++)
+	{
+		FSPW_SupportComp& Entry = Entries[Index];
+		Entry.bHasMoved = false;
+
+		if (Entry.NumLegs == 0 || !InComponents.IsValidIndex(Index) || InComponents[Index] != Entry.Component)
+		{
+			continue;
+		}
+
+		if (Entry.bHasTransform)
+		{
+			Entry.PreviousTransform = Entry.Transform;
+			Entry.Transform = InTransforms[Index];
+			Entry.bHasMoved = !Entry.Transform.Equals(Entry.PreviousTransform, 0.f);
+		}
+		else
+		{
+			/* -> first snapshot */
+			Entry.PreviousTransform = InTransforms[Index];
+			Entry.Transform = InTransforms[Index];
+			Entry.bHasTransform = true;
+		}
+	}
+}
@@ -0,0 +1,138 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+#include "SPW_AllocationCounter.h"
+#include "SPW_CurveTable.h"
+#include "SPW_FootholdSearch.h"
+#include "SPW_IKKernel.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace SPW_AllocationTest
+{
+	static const int32 NUM_LEGS = FSPW_IKChainBatch::NumLanes;
+	static const int32 NUM_LINKS = 4;
+	static const float LINK_LENGTH = 30.f;
+	static const int32 NUM_PROBES = 16;
+
+	/** A straight leg hanging from its hip, gathered again every frame as the node does. */
+	static void GatherChain(int32 LegIndex, FSPW_IKChain& OutChain)
+	{
+		OutChain.Reset();
+
+		const FVector HipLocation(0.f, 50.f * LegIndex, 100.f);
+		for (int32 LinkIndex = 0; LinkIndex < NUM_LINKS; LinkIndex++)
+		{
+			const FTransform LocalTransform(FQuat::Identity, FVector(0.f, 0.f, LinkIndex == 0 ? 0.f : -LINK_LENGTH));
+			const FTransform CSTransform(FQuat::Identity, HipLocation - FVector(0.f, 0.f, LINK_LENGTH * LinkIndex));
+			OutChain.AddLink(CSTransform, LocalTransform, LinkIndex, PI);
+		}
+	}
+
+	static FVector GetTarget(int32 LegIndex, int32 FrameIndex)
+	{
+		return FVector(20.f * FMath::Sin(FrameIndex * .1f), 50.f * LegIndex + 10.f, 100.f - 2.5f * LINK_LENGTH);
+	}
+
+	/** The per-frame work of the node that does not need a world nor a skeleton. */
+	static void RunFrame(int32 FrameIndex
+		, TArray<FSPW_IKChain>& Chains
+		, FSPW_IKChainBatch& Batch
+		, FSPW_FootholdCandidates& Candidates
+		, const TArray<FVector2D>& ProbeOffsets
+		, const FSPW_CurveTable& CurveTable
+		, float& OutChecksum)
+	{
+		const FSPW_IKSolveSettings Settings;
+
+		// single chains, with every solver
+		for (int32 LegIndex = 0; LegIndex < NUM_LEGS; LegIndex++)
+		{
+			const FVector Target = GetTarget(LegIndex, FrameIndex);
+
+			GatherChain(LegIndex, Chains[LegIndex]);
+			OutChecksum += SPW_IK::SolveCCDIK(Chains[LegIndex], Target, Settings).Iterations;
+
+			GatherChain(LegIndex, Chains[LegIndex]);
+			OutChecksum += SPW_IK::SolveFABRIK(Chains[LegIndex], Target, Settings).Iterations;
+
+			GatherChain(LegIndex, Chains[LegIndex]);
+			FSPW_IKSolveResult Result;
+			SPW_IK::SolveAnalytic(Chains[LegIndex], Target, Result);
+			OutChecksum += Result.Iterations;
+		}
+
+		// batched chains
+		FSPW_IKChain* BatchChains[NUM_LEGS];
+		FVector Targets[NUM_LEGS];
+		FSPW_IKSolveResult Results[NUM_LEGS];
+		for (int32 LegIndex = 0; LegIndex < NUM_LEGS; LegIndex++)
+		{
+			GatherChain(LegIndex, Chains[LegIndex]);
+			BatchChains[LegIndex] = &Chains[LegIndex];
+			Targets[LegIndex] = GetTarget(LegIndex, FrameIndex);
+		}
+		SPW_IK::SolveCCDIKBatch(BatchChains, Targets, NUM_LEGS, Settings, Batch, Results);
+		OutChecksum += Results[0].Iterations;
+
+		// foothold search
+		Candidates.Reset(FVector(0.f));
+		for (const FVector2D& ProbeOffset : ProbeOffsets)
+		{
+			Candidates.Add(FVector(ProbeOffset.X * 20.f, ProbeOffset.Y * 20.f, FMath::Sin(FrameIndex + ProbeOffset.X)), FVector::UpVector);
+		}
+		OutChecksum += SPW_Foothold::FindBestCandidate(Candidates, FVector::UpVector, 30.f, 100.f);
+
+		// step curves
+		OutChecksum += CurveTable.Eval(FMath::Fmod(FrameIndex * .05f, 1.f));
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSPW_SteadyStateAllocationTest, "SimpleProceduralWalk.Allocations.SteadyState", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FSPW_SteadyStateAllocationTest::RunTest(const FString& Parameters)
+{
+	using namespace SPW_AllocationTest;
+
+	static const int32 NUM_FRAMES = 100;
+
+	/* -> storage, sized as the node does when it initializes */
+	TArray<FSPW_IKChain> Chains;
+	Chains.SetNum(NUM_LEGS);
+	for (FSPW_IKChain& Chain : Chains)
+	{
+		Chain.Reserve(NUM_LINKS);
+	}
+
+	FSPW_IKChainBatch Batch;
+	Batch.SetNumLinks(NUM_LINKS);
+
+	TArray<FVector2D> ProbeOffsets;
+	SPW_Foothold::BuildProbePattern(NUM_PROBES, ProbeOffsets);
+	FSPW_FootholdCandidates Candidates;
+	Candidates.Reserve(NUM_PROBES);
+
+	FSPW_CurveTable CurveTable;
+	CurveTable.SetConstant(1.f);
+
+	/* -> warm up, then steady state */
+	float Checksum = 0.f;
+	RunFrame(0, Chains, Batch, Candidates, ProbeOffsets, CurveTable, Checksum);
+
+	int32 NumAllocations = 0;
+	{
+		FSPW_ScopeAllocationCounter AllocationCounter;
+		for (int32 FrameIndex = 1; FrameIndex <= NUM_FRAMES; FrameIndex++)
+		{
+			RunFrame(FrameIndex, Chains, Batch, Candidates, ProbeOffsets, CurveTable, Checksum);
+		}
+		NumAllocations = AllocationCounter.GetNumAllocations();
+	}
+
+	AddInfo(FString::Printf(TEXT("Checksum: %f"), Checksum));
+	TestEqual(FString::Printf(TEXT("Allocations in %d steady state frames"), NUM_FRAMES), NumAllocations, 0);
+
+	return true;
+}
+
+#endif
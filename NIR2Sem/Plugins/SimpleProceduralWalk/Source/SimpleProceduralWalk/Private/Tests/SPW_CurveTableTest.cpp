@@ -0,0 +1,67 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+#include "SPW_CurveTable.h"
+#include "Curves/RichCurve.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace SPW_CurveTableTest
+{
+	// as checked when the node bakes its curves
+	static const float MAX_ERROR = .01f;
+
+	static void AddKey(FRichCurve& Curve, float Time, float Value, ERichCurveInterpMode InterpMode)
+	{
+		const FKeyHandle KeyHandle = Curve.AddKey(Time, Value);
+		Curve.SetKeyInterpMode(KeyHandle, InterpMode);
+	}
+
+	static bool TestCurve(FAutomationTestBase& Test, const TCHAR* Name, FRichCurve& Curve)
+	{
+		Curve.AutoSetTangents();
+
+		FSPW_CurveTable CurveTable;
+		CurveTable.Bake(Curve);
+
+		const float MaxError = CurveTable.GetMaxError(Curve);
+		Test.AddInfo(FString::Printf(TEXT("%s: %d knots, max error %f."), Name, CurveTable.Num(), MaxError));
+		return Test.TestTrue(FString::Printf(TEXT("%s max error %f, at most %f"), Name, MaxError, MAX_ERROR), MaxError <= MAX_ERROR);
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSPW_CurveTableErrorTest, "SimpleProceduralWalk.CurveTable.MaxError", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FSPW_CurveTableErrorTest::RunTest(const FString& Parameters)
+{
+	using namespace SPW_CurveTableTest;
+
+	FRichCurve LinearCurve;
+	AddKey(LinearCurve, 0.f, 0.f, RCIM_Linear);
+	AddKey(LinearCurve, 1.f, 1.f, RCIM_Linear);
+	TestCurve(*this, TEXT("Linear"), LinearCurve);
+
+	// as the default step height curve
+	FRichCurve CubicCurve;
+	AddKey(CubicCurve, 0.f, 0.f, RCIM_Cubic);
+	AddKey(CubicCurve, .5f, 1.f, RCIM_Cubic);
+	AddKey(CubicCurve, 1.f, 0.f, RCIM_Cubic);
+	TestCurve(*this, TEXT("Cubic"), CubicCurve);
+
+	FRichCurve SteepCurve;
+	AddKey(SteepCurve, 0.f, 0.f, RCIM_Cubic);
+	AddKey(SteepCurve, .49f, 0.f, RCIM_Cubic);
+	AddKey(SteepCurve, .51f, 1.f, RCIM_Cubic);
+	AddKey(SteepCurve, 1.f, 1.f, RCIM_Cubic);
+	TestCurve(*this, TEXT("Steep"), SteepCurve);
+
+	FRichCurve StepCurve;
+	AddKey(StepCurve, 0.f, 0.f, RCIM_Constant);
+	AddKey(StepCurve, .3f, 1.f, RCIM_Constant);
+	AddKey(StepCurve, .7f, .5f, RCIM_Constant);
+	TestCurve(*this, TEXT("Step"), StepCurve);
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,106 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+#include "SPW_FootholdCacheSubsystem.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/World.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace SPW_FootholdCacheTest
+{
+	// stairs along X, with treads that do not line up with the cache cells
+	static const float TREAD_DEPTH = 25.f;
+	static const float RISER_HEIGHT = 15.f;
+
+	static float GetGroundHeight(const FVector& Location)
+	{
+		return Location.X < 0.f ? 0.f : RISER_HEIGHT * (FMath::FloorToFloat(Location.X / TREAD_DEPTH) + 1.f);
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSPW_FootholdCacheHitRateTest, "SimpleProceduralWalk.FootholdCache.HitRate", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FSPW_FootholdCacheHitRateTest::RunTest(const FString& Parameters)
+{
+	using namespace SPW_FootholdCacheTest;
+
+	static const int32 NUM_ROWS = 2;
+	static const int32 NUM_CREATURES_PER_ROW = 4;
+	static const float SPEED = 100.f;
+	static const float DELTA_SECONDS = 1.f / 60.f;
+	static const int32 NUM_FRAMES = 300;
+	static const float TRACE_HEIGHT = 100.f;
+	static const float MIN_HIT_RATE = .5f;
+
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false);
+	USPW_FootholdCacheSubsystem* FootholdCache = World->GetSubsystem<USPW_FootholdCacheSubsystem>();
+	if (!TestNotNull(TEXT("Foothold cache"), FootholdCache))
+	{
+		World->DestroyWorld(false);
+		return false;
+	}
+
+	UStaticMeshComponent* Ground = NewObject<UStaticMeshComponent>(World->PersistentLevel);
+	Ground->SetMobility(EComponentMobility::Static);
+
+	/* -> creatures walking up the stairs, in rows, a bit offset from the one they follow */
+	TArray<FVector> CreatureStartLocations;
+	for (int32 RowIndex = 0; RowIndex < NUM_ROWS; RowIndex++)
+	{
+		for (int32 CreatureIndex = 0; CreatureIndex < NUM_CREATURES_PER_ROW; CreatureIndex++)
+		{
+			CreatureStartLocations.Add(FVector(-50.f - 153.7f * CreatureIndex, 100.f * RowIndex + 7.f * CreatureIndex, 0.f));
+		}
+	}
+	const FVector FeetOffsets[] = { FVector(30.f, 20.f, 0.f), FVector(30.f, -20.f, 0.f), FVector(-30.f, 20.f, 0.f), FVector(-30.f, -20.f, 0.f) };
+
+	int32 NumWrongHits = 0;
+	for (int32 FrameIndex = 0; FrameIndex < NUM_FRAMES; FrameIndex++)
+	{
+		const FVector Displacement(SPEED * DELTA_SECONDS * FrameIndex, 0.f, 0.f);
+
+		for (const FVector& CreatureStartLocation : CreatureStartLocations)
+		{
+			for (const FVector& FootOffset : FeetOffsets)
+			{
+				FVector FootLocation = CreatureStartLocation + Displacement + FootOffset;
+				FootLocation.Z = GetGroundHeight(FootLocation);
+				const FVector Start = FootLocation + FVector(0.f, 0.f, TRACE_HEIGHT);
+				const FVector End = FootLocation - FVector(0.f, 0.f, TRACE_HEIGHT);
+
+				FHitResult Hit;
+				if (FootholdCache->FindHit(Start, End, ECC_Visibility, false, Hit))
+				{
+					if (!FMath::IsNearlyEqual(Hit.ImpactPoint.Z, FootLocation.Z, .1f))
+					{
+						NumWrongHits++;
+					}
+					continue;
+				}
+
+				/* -> trace */
+				Hit = FHitResult(Start, End);
+				Hit.bBlockingHit = true;
+				Hit.Location = FootLocation;
+				Hit.ImpactPoint = FootLocation;
+				Hit.Normal = FVector::UpVector;
+				Hit.ImpactNormal = FVector::UpVector;
+				Hit.Component = Ground;
+				FootholdCache->AddHit(Start, End, ECC_Visibility, false, Hit);
+			}
+		}
+
+		FootholdCache->Tick(DELTA_SECONDS);
+	}
+
+	const float HitRate = FootholdCache->GetHitRate();
+	AddInfo(FString::Printf(TEXT("Foothold cache hit rate with %d creatures: %f"), CreatureStartLocations.Num(), HitRate));
+	TestTrue(FString::Printf(TEXT("Hit rate %f, at least %f"), HitRate, MIN_HIT_RATE), HitRate >= MIN_HIT_RATE);
+	TestEqual(TEXT("Hits on the wrong step"), NumWrongHits, 0);
+
+	World->DestroyWorld(false);
+	return true;
+}
+
+#endif
@@ -4,10 +4,22 @@
 
 #include "CoreMinimal.h"
 #include "SPW.h"
-#include "SPW_CCDIKSolver.h"
+#include "SPW_AsyncTraces.h"
+#include "SPW_CurveTable.h"
+#include "SPW_DebugDraw.h"
+#include "SPW_FootholdSearch.h"
+#include "SPW_FrameRecording.h"
+#include "SPW_GameThreadSnapshot.h"
+#include "SPW_InterfaceEvents.h"
+#include "SPW_IKKernel.h"
+#include "SPW_RigDescriptor.h"
+#include "SPW_SupportCompTable.h"
 #include "BoneControllers/AnimNode_SkeletalControlBase.h"
 #include "AnimNode_SPW.generated.h"
 
+class USPW_FootholdCacheSubsystem;
+class USPW_GaitStateComponent;
+
 
 USTRUCT()
 struct SIMPLEPROCEDURALWALK_API FAnimNode_SPW : public FAnimNode_SkeletalControlBase
@@ -20,6 +32,18 @@ public:
 	UPROPERTY(EditAnywhere, Category = "Debug")
 		bool bDebug = false;
 
+	/**
+	 * Should the inputs of the node be recorded, from its initialization on?
+	 * After Recorded Frames frames, the recording is written to Saved/SimpleProceduralWalk/<Pawn>.spwrec
+	 * and can then be replayed without a world by the SPW_Replay commandlet. Requires sync traces.
+	 */
+	UPROPERTY(EditAnywhere, AdvancedDisplay, Category = "Debug")
+		bool bRecordFrames = false;
+
+	/** The number of frames to record. */
+	UPROPERTY(EditAnywhere, AdvancedDisplay, Category = "Debug", meta = (ClampMin = "1", EditCondition = "bRecordFrames"))
+		int32 RecordedFrames = 0;
+
 	// ---------- \/ Skeletal Control ----------
 	/**
 	 * The forward axis of the Skeletal Mesh.
@@ -155,7 +179,18 @@ public:
 	UPROPERTY(EditAnywhere, AdvancedDisplay, Category = "Solver", meta = (ClampMin = "1.0", ClampMax = "3.0", EditCondition = "SolverType == ESimpleProceduralWalk_SolverType::ADVANCED"))
 		float DistanceCheckMultiplier = 0.f;
 
+	/**
+	 * The number of line traces probing for a location within the radius, when the basic vertical location is abandoned.
+	 * This caps the cost of the search of each leg.
+	 */
+	UPROPERTY(EditAnywhere, AdvancedDisplay, Category = "Solver", meta = (ClampMin = "1", ClampMax = "32", EditCondition = "SolverType == ESimpleProceduralWalk_SolverType::ADVANCED"))
+		int32 FootholdProbes = 0;
+
 	// ---------- \/ IK Solver ----------
+	/** The IK algorithm. FABRIK usually needs fewer iterations on long legs, CCDIK on short ones. */
+	UPROPERTY(EditAnywhere, Category = "IK Solver")
+		ESimpleProceduralWalk_IKSolverType IKSolverType;
+
 	/** Start computations from tail. */
 	UPROPERTY(EditAnywhere, Category = "IK Solver", meta = (ClampMin = "0.0"))
 		bool bStartFromTail = false;
@@ -168,6 +203,46 @@ public:
 	UPROPERTY(EditAnywhere, AdvancedDisplay, Category = "IK Solver", meta = (ClampMin = "0"))
 		int32 MaxIterations = 0;
 
+	/**
+	 * Solve legs with two or three bones (zero length bones excluded) in closed form, bending the way the animated pose bends.
+	 * Other legs, out of reach targets and exceeded rotation limits fall back to the iterative solver.
+	 */
+	UPROPERTY(EditAnywhere, AdvancedDisplay, Category = "IK Solver")
+		bool bAnalyticSolveLegs = false;
+
+	/**
+	 * Solve legs that have the same number of bones together, 4 at a time, with SIMD instructions.
+	 * Results match the per-leg solver within Precision. CCDIK only.
+	 */
+	UPROPERTY(EditAnywhere, AdvancedDisplay, Category = "IK Solver", meta = (EditCondition = "IKSolverType == ESimpleProceduralWalk_IKSolverType::CCDIK"))
+		bool bBatchSolveLegs = false;
+
+	/**
+	 * Solve legs in parallel on task graph workers, then merge all the legs at once.
+	 * Ignored when legs are batch solved.
+	 */
+	UPROPERTY(EditAnywhere, AdvancedDisplay, Category = "IK Solver", meta = (EditCondition = "!bBatchSolveLegs"))
+		bool bParallelSolveLegs = false;
+
+	/** Minimum number of legs to solve for the parallel solve to be used, smaller rigs are solved serially. */
+	UPROPERTY(EditAnywhere, AdvancedDisplay, Category = "IK Solver", meta = (ClampMin = "2", EditCondition = "bParallelSolveLegs && !bBatchSolveLegs"))
+		int32 ParallelSolveMinLegs = 0;
+
+	/**
+	 * Start each leg from its last solve instead of the animated pose, when its target has moved little relative to the leg root.
+	 * Planted legs then converge in very few iterations, or are not solved at all.
+	 */
+	UPROPERTY(EditAnywhere, AdvancedDisplay, Category = "IK Solver")
+		bool bWarmStartLegs = false;
+
+	/** Below this target movement the last solve is reused as is, without iterating. */
+	UPROPERTY(EditAnywhere, AdvancedDisplay, Category = "IK Solver", meta = (ClampMin = "0.0", EditCondition = "bWarmStartLegs"))
+		float WarmStartReuseDistance = 0.f;
+
+	/** Above this target movement legs are solved from the animated pose again. */
+	UPROPERTY(EditAnywhere, AdvancedDisplay, Category = "IK Solver", meta = (ClampMin = "0.0", EditCondition = "bWarmStartLegs"))
+		float WarmStartMaxDistance = 0.f;
+
 	// ---------- \/ Trace ----------
 	/**
 	 * The trace channel.
@@ -188,6 +263,72 @@ public:
 	UPROPERTY(EditAnywhere, AdvancedDisplay, Category = "Trace")
 		float TraceZOffset = 0.f;
 
+	/**
+	 * Should the traces be asynchronous?
+	 * All the traces of a frame are submitted as a single batch and their results are used one frame late.
+	 * When the result of a leg is not available yet, the last hit of that leg is used instead.
+	 */
+	UPROPERTY(EditAnywhere, AdvancedDisplay, Category = "Trace")
+		bool bAsyncTraces = false;
+
+	/**
+	 * Should the line traces hits on static geometry be shared with the other creatures of the world?
+	 * Legs whose trace starts where a hit has already been found reuse it instead of tracing.
+	 * Only used by synchronous traces.
+	 */
+	UPROPERTY(EditAnywhere, AdvancedDisplay, Category = "Trace", meta = (EditCondition = "!bAsyncTraces"))
+		bool bUseFootholdCache = false;
+
+	/**
+	 * Should the feet targets be traced once per step?
+	 * When a group unplants, the landing location is predicted from the pawn velocity & rotation and traced once.
+	 * Planted feet follow the ground of their last hit without tracing.
+	 * Only used by synchronous traces.
+	 */
+	UPROPERTY(EditAnywhere, AdvancedDisplay, Category = "Trace", meta = (EditCondition = "!bAsyncTraces"))
+		bool bPredictiveFootPlacement = false;
+
+	/** How far can the predicted landing location drift during a step before it is traced again. */
+	UPROPERTY(EditAnywhere, AdvancedDisplay, Category = "Trace", meta = (ClampMin = "0.0", EditCondition = "bPredictiveFootPlacement && !bAsyncTraces"))
+		float PredictiveFootPlacementTolerance = 0.f;
+
+	// ---------- \/ LOD ----------
+	/** Should the update rate be reduced based on the distance to the camera & visibility? */
+	UPROPERTY(EditAnywhere, Category = "LOD")
+		bool bEnableLOD = false;
+
+	/** From this distance to the closest camera, traces are only refreshed every few frames. Foot targets follow the pawn in between. */
+	UPROPERTY(EditAnywhere, Category = "LOD", meta = (ClampMin = "0.0", EditCondition = "bEnableLOD"))
+		float LODReducedTraceDistance = 0.f;
+
+	/** From this distance to the closest camera, the IK solver also uses fewer iterations. */
+	UPROPERTY(EditAnywhere, Category = "LOD", meta = (ClampMin = "0.0", EditCondition = "bEnableLOD"))
+		float LODReducedIKDistance = 0.f;
+
+	/** From this distance to the closest camera, the IK & body solvers are skipped and only the steps phases are advanced. */
+	UPROPERTY(EditAnywhere, Category = "LOD", meta = (ClampMin = "0.0", EditCondition = "bEnableLOD"))
+		float LODPhaseOnlyDistance = 0.f;
+
+	/** Number of frames between traces refreshes, in the reduced tiers. */
+	UPROPERTY(EditAnywhere, AdvancedDisplay, Category = "LOD", meta = (ClampMin = "1", EditCondition = "bEnableLOD"))
+		int32 LODTraceRefreshInterval = 0;
+
+	/** Maximum number of IK iterations in the reduced IK tier. */
+	UPROPERTY(EditAnywhere, AdvancedDisplay, Category = "LOD", meta = (ClampMin = "0", EditCondition = "bEnableLOD"))
+		int32 LODReducedMaxIterations = 0;
+
+	/** Should the mesh use the Phase Only tier when it has not been rendered recently, regardless of the distance? */
+	UPROPERTY(EditAnywhere, AdvancedDisplay, Category = "LOD", meta = (EditCondition = "bEnableLOD"))
+		bool bLODPhaseOnlyWhenNotRendered = false;
+
+	/**
+	 * Should feet targets & legs be frozen while the pawn is stationary?
+	 * Once the pawn stands still with all its feet planted, traces are skipped until the pawn moves, its movement base changes
+	 * or a component under a foot moves. Legs whose chain & target did not change reuse their last solve.
+	 */
+	UPROPERTY(EditAnywhere, Category = "LOD")
+		bool bEnableIdleMode = false;
+
 public:
 	// Constructor
 	FAnimNode_SPW();
@@ -195,6 +336,8 @@ public:
 	// FAnimNode_Base interface
 	virtual void GatherDebugData(FNodeDebugData& DebugData) override;
 	virtual void Initialize_AnyThread(const FAnimationInitializeContext& Context) override;
+	virtual bool HasPreUpdate() const override { return true; }
+	virtual void PreUpdate(const UAnimInstance* InAnimInstance) override;
 
 	// FAnimNode_SkeletalControlBase interface
 	virtual void InitializeBoneReferences(const FBoneContainer& RequiredBones) override;
@@ -205,6 +348,13 @@ public:
 	// from graph node: resize rotation limit array based on set up
 	void CCDIK_ResizeRotationLimitPerJoints(int32 LegIndex, int32 NewSize);
 
+	// replay of a recording, without a world (bone references are initialized by the caller, as by the anim instance)
+	bool InitializeReplay(const FSPW_FrameRecording& InRecording);
+	void ReplayFrame(const FSPW_FrameInputs& Inputs
+		, FCSPose<FCompactPose>& Pose
+		, TArray<FBoneTransform>& OutBoneTransforms
+		, FSPW_ReplayTimings* OutTimings = nullptr);
+
 private:
 	// internals
 	bool bHasErrors = false;
@@ -213,6 +363,7 @@ private:
 	int32 SkippedFrames = 0;
 	bool bIsInitialized = false;
 	float WorldDeltaSeconds = 0.f;
+	void Evaluate_Frame(FCSPose<FCompactPose>& Pose, TArray<FBoneTransform>& OutBoneTransforms, FSPW_ReplayTimings* OutTimings = nullptr);
 
 	// References
 	UWorld* WorldContext;
@@ -240,21 +391,59 @@ private:
 	// legs
 	TArray<FSimpleProceduralWalk_LegData> LegsData;
 
+	// step curves, baked at init so that they are not evaluated from the assets
+	FSPW_CurveTable SpeedCurveTable;
+	FSPW_CurveTable HeightCurveTable;
+	void BakeCurveTable(const UCurveFloat* Curve, FSPW_CurveTable& OutCurveTable);
+
 	// groups
 	int32 CurrentGroupIndex = 0;
 	TArray<FSimpleProceduralWalk_LegGroupData> GroupsData;
 
+	// gait phase hand over (optional component on the pawn, game thread only)
+	TWeakObjectPtr<USPW_GaitStateComponent> GaitStateComponent;
+	bool bHasSearchedGaitStateComponent = false;
+	FSimpleProceduralWalk_GaitState GaitState;
+	void CaptureGaitStateSnapshot();
+	void RestoreGaitState(const FSimpleProceduralWalk_GaitState& InGaitState);
+	void StoreGaitState();
+
 	// body
 	FRotator CurrentBodyRelRotation = FRotator(0.f);
 	FVector CurrentBodyRelLocation = FVector(0.f);
 	float ReduceSlopeMultiplierPitch = 1.f;
 	float ReduceSlopeMultiplierRoll = 1.f;
 
-	// IK
-	TArray<FBoneSocketTarget> EffectorTargets;
-	TArray<FBoneReference> ParentBones;
-	TArray<FBoneReference> TipBones;
-	TArray<FSimpleProceduralWalk_RotationLimitsPerJoint> FeetRotationLimitsPerJoints;
+	// IK: bones & chains of the legs, shared with the other nodes of the same rig, and the bone container they were made for
+	TSharedPtr<const FSPW_RigDescriptor, ESPMode::ThreadSafe> RigDescriptor;
+	uint16 LegsChainDataSerialNumber = 0;
+
+	// scratch buffers, kept between frames so that they do not grow in steady state
+	// (the solver kernels then run without allocating, but ParallelFor tasks & the debug draw queue still allocate)
+	TArray<FHitResult> FootHoldHits;
+	FSPW_FootholdCandidates FootHoldCandidates;
+	SIZE_T ScratchAllocatedSize = 0;
+	int32 ScratchGrowthCount = 0;
+	SIZE_T GetScratchAllocatedSize() const;
+	void TrackScratchGrowth();
+
+	// merge
+	static void SortBoneTransforms(TArray<FBoneTransform>& InOutBoneTransforms);
+
+	// LOD
+	ESimpleProceduralWalk_LODTier LODTier = ESimpleProceduralWalk_LODTier::FULL;
+	int32 FramesSinceTracesRefresh = 0;
+	void UpdateLODTier();
+	bool ShouldRefreshTraces();
+	void CarryFeetTargets();
+
+	// idle
+	bool bIsIdle = false;
+	int32 StationaryFrames = 0;
+	FTransform IdleActorTransform = FTransform::Identity;
+	uint32 IdleMovementBaseId = 0;
+	void UpdateIdleState();
+	bool IsStationary() const;
 
 	// ---------- \/ computations ----------
 	void Initialize_Computations();
@@ -263,7 +452,26 @@ private:
 	void SetSupportCompDeltas();
 	// walk
 	void SetFeetTargetLocations();
-	void SetFootTargetLocation(int32 LegIndex);
+	FVector GetFootTraceStartLocation(int32 LegIndex);
+	void SetFootTargetLocation(int32 LegIndex, FVector StartLocationWithoutZOffset);
+	// predictive placement
+	bool IsUsingPredictiveFootPlacement() const;
+	void PredictFootTargetLocation(int32 LegIndex);
+	FVector PredictFootTraceStartLocation(int32 LegIndex, FVector StartLocationWithoutZOffset);
+	// foothold search
+	void GetFootHoldProbe(int32 ProbeIndex
+		, FVector StartLocation
+		, FVector EndLocation
+		, FVector& OutStartLocation
+		, FVector& OutEndLocation) const;
+	bool SearchFootHold(FVector StartLocation
+		, FVector EndLocation
+		, FVector StartLocationWithoutZOffset
+		, float ZDistanceToLineHit
+		, FHitResult& OutHit);
+	bool FindFootHoldHit(FVector StartLocationWithoutZOffset
+		, float ZDistanceToLineHit
+		, FHitResult& OutHit);
 	void SetCurrentGroupUnplanted();
 	void ComputeFeet();
 	void SetGroupsPlanted();
@@ -283,14 +491,25 @@ private:
 		, FVector* AverageFeetTargetsRight
 		, FVector* AverageFeetTargetsLeft);
 
-	// ix
+	// ix: events are queued on the anim thread & dispatched in PreUpdate, to the implementers found on the first dispatch
+	TSharedPtr<FSPW_InterfaceEventQueue, ESPMode::ThreadSafe> InterfaceEventQueue;
+	TArray<TWeakObjectPtr<UObject>, TInlineAllocator<2>> InterfaceImplementers;
+	bool bAreInterfaceImplementersCached = false;
 	void CallStepInterfaces(int32 GroupIndex, bool bIsDown);
-	void CallStepInterface(UObject* InterfaceOwner, int32 GroupIndex, bool bIsDown);
 	void CallLandedInterfaces();
-	void CallLandedInterface(UObject* InterfaceOwner);
+	void CacheInterfaceImplementers(const UAnimInstance* InAnimInstance);
+	void DispatchInterfaceEvents(const UAnimInstance* InAnimInstance);
+
+	// debug: shapes of the frame, drawn at once at the end of the evaluation
+	FSPW_DebugDrawBuffer DebugDrawBuffer;
+	void FlushDebugDraw();
+
+	// moving supports, shared by the legs standing on them
+	FSPW_SupportCompTable SupportCompTable;
 
 	// helpers
 	void SetSupportComponentData(int32 LegIndex, FVector RefLocation);
+	static FVector GetAverageLocation(const FVector& LocationsSum, int32 NumLocations);
 	float GetReductionSlopeMultiplier();
 	bool IsLegUnplanted(int32 LegIndex);
 	float GetLegStepPercent(int32 LegIndex);
@@ -301,21 +520,84 @@ private:
 	void EditorDebugShow(AActor* SkeletalMeshOwner);
 
 	// BODY
-	void Evaluate_BodySolver(FComponentSpacePoseContext& Output);
+	void Evaluate_BodySolver(FCSPose<FCompactPose>& Pose, TArray<FBoneTransform>& OutBoneTransforms);
+	bool bIsBodyMoved = false;
+	FTransform BodyDeltaTransform = FTransform::Identity;
 
 	// solver
 	float RadiusCheck;
+	TArray<FVector2D> FootHoldProbeOffsets;
+	FCollisionQueryParams TraceQueryParams;
+
+	// foothold cache
+	TWeakObjectPtr<USPW_FootholdCacheSubsystem> FootholdCache;
+	bool LineTraceFoot(FVector StartLocation, FVector EndLocation, FHitResult& OutHit);
+	bool LineTraceFootHoldProbe(FVector StartLocation, FVector EndLocation, FHitResult& OutHit);
+
+	// game thread snapshot, taken in PreUpdate & read by the evaluation
+	FSPW_GameThreadSnapshot GameThreadSnapshot;
+	void CaptureGameThreadSnapshot();
+	void CaptureLODSnapshot();
+
+	// record & replay: the node reads the world through the inputs of the frame
+	FSPW_FrameInputs FrameInputs;
+	TSharedPtr<FSPW_FrameRecording, ESPMode::ThreadSafe> Recording;
+	FString RecordingFilename;
+	int32 RecordedBonesSerialNumber = INDEX_NONE;
+	bool bIsReplaying = false;
+	int32 ReplayedHitIndex = 0;
+	void Initialize_Recording();
+	void CaptureFrameInputs(FComponentSpacePoseContext& Output);
+	void RecordFrame(const TArray<FBoneTransform>& OutBoneTransforms);
+	void RecordHit(const FHitResult& Hit);
+	bool ReplayHit(FHitResult& OutHit);
+
+	// async traces
+	TSharedPtr<FSPW_AsyncTraceBatch, ESPMode::ThreadSafe> AsyncTraceBatch;
+	TArray<FSimpleProceduralWalk_LegAsyncTraceData> LegsAsyncTraceData;
+	TArray<FSPW_AsyncTraceRequest> AsyncTraceRequests;
+	void Initialize_AsyncTraces();
+	bool GetAsyncFootTraceResult(int32 LegIndex
+		, FVector StartLocation
+		, FVector EndLocation
+		, FVector StartLocationWithoutZOffset
+		, FHitResult& OutHit
+		, bool& bOutIsUsingBasic);
+	void SubmitAsyncFootTraces();
 
 	// CCDIK
 	void Initialize_CCDIK();
-	void Evaluate_CCDIKSolver(FComponentSpacePoseContext& Output);
+	void Initialize_LegChains(const FBoneContainer& RequiredBones);
+	void Evaluate_CCDIKSolver(FCSPose<FCompactPose>& Pose, TArray<FBoneTransform>& OutBoneTransforms);
 	FTransform CCDIK_GetTargetTransform(const FTransform& InComponentTransform
 		, FCSPose<FCompactPose>& MeshBases
-		, FBoneSocketTarget& InTarget
+		, const FBoneSocketTarget& InTarget
 		, const FVector& InOffset);
 
-	bool SolveCCDIK(TArray<FSPW_CCDIKChainLink>& InOutChain
-		, const FVector& TargetPosition
-		, bool bEnableRotationLimit
-		, const TArray<float>& RotationLimitPerJoints);
+	// CCDIK chains
+	TArray<FSPW_IKChain> LegsChains;
+	TArray<TArray<FBoneTransform>> LegsBoneTransforms;
+	TArray<FVector> LegsEffectorLocations;
+	// tips as output by the last frame, in world space (the input pose ones when not solved)
+	TArray<FVector> LegsOutputTipLocations;
+	TArray<FSPW_IKSolveResult> LegsSolveResults;
+	TArray<int32> GatheredLegIndices;
+	TArray<int32> SolvedLegIndices;
+	TArray<int32> SortedLegIndices;
+	FSPW_IKChainBatch IKChainBatch;
+	void GatherLegChains(FCSPose<FCompactPose>& Pose);
+	void GatherLegChain(FCSPose<FCompactPose>& Pose, int32 LegIndex);
+	void SolveLegChain(int32 LegIndex, const FSPW_IKSolveSettings& Settings);
+	bool SolveLegChainAnalytic(int32 LegIndex);
+	void SolveLegChainsParallel(const FSPW_IKSolveSettings& Settings);
+	void SolveLegChainsBatched(const FSPW_IKSolveSettings& Settings);
+	void ApplyLegChain(FCSPose<FCompactPose>& Pose, int32 LegIndex);
+
+	// CCDIK warm start
+	TArray<FSimpleProceduralWalk_LegIKCacheData> LegsIKCacheData;
+	bool WarmStartLegChain(int32 LegIndex);
+	void CacheLegChain(int32 LegIndex);
+	bool IsLegChainUnchanged(FCSPose<FCompactPose>& Pose, int32 LegIndex);
+	void CacheAppliedLegChain(FCSPose<FCompactPose>& Pose, int32 LegIndex);
+	FSPW_IKSolveSettings CCDIK_GetSolveSettings() const;
 };
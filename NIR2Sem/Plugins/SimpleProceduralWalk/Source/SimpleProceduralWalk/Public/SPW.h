@@ -5,10 +5,18 @@
 #include "CoreMinimal.h"
 #include "BoneContainer.h"
 #include "Kismet/KismetSystemLibrary.h"
+#include "WorldCollision.h"
 #include "SPW.generated.h"
 
 DECLARE_LOG_CATEGORY_EXTERN(LogSimpleProceduralWalk, Log, All);
 
+// stats
+DECLARE_STATS_GROUP(TEXT("SimpleProceduralWalk"), STATGROUP_SimpleProceduralWalk, STATCAT_Advanced);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Line Traces"), STAT_SimpleProceduralWalk_NumLineTraces, STATGROUP_SimpleProceduralWalk, SIMPLEPROCEDURALWALK_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Foothold Probes"), STAT_SimpleProceduralWalk_NumFootholdProbes, STATGROUP_SimpleProceduralWalk, SIMPLEPROCEDURALWALK_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Legs Solved"), STAT_SimpleProceduralWalk_NumLegsSolved, STATGROUP_SimpleProceduralWalk, SIMPLEPROCEDURALWALK_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("IK Iterations"), STAT_SimpleProceduralWalk_NumIKIterations, STATGROUP_SimpleProceduralWalk, SIMPLEPROCEDURALWALK_API);
+
 
 USTRUCT()
 struct SIMPLEPROCEDURALWALK_API FSimpleProceduralWalk_Leg
@@ -47,16 +55,6 @@ public:
 		TArray<int32> LegIndices;
 };
 
-USTRUCT()
-struct SIMPLEPROCEDURALWALK_API FSimpleProceduralWalk_RotationLimitsPerJoint
-{
-	GENERATED_USTRUCT_BODY()
-
-public:
-	UPROPERTY(EditAnyWhere, Category = "Skeletal Control")
-		TArray<float> RotationLimits;
-};
-
 USTRUCT()
 struct SIMPLEPROCEDURALWALK_API FSimpleProceduralWalk_LegData
 {
@@ -65,22 +63,86 @@ struct SIMPLEPROCEDURALWALK_API FSimpleProceduralWalk_LegData
 public:
 	FVector FootLocation = FVector(0.f);
 	FVector FootTarget = FVector(0.f);
+	FVector FootTargetRelLocation = FVector(0.f);
 	FRotator FootTargetRotation = FRotator(0.f);
 	FVector FootUnplantLocation = FVector(0.f);
 	FVector TipBoneOriginalRelLocation = FVector(0.f);
-	int32 GroupIndex = 0.f;
 	bool bIsForward = false;
 	bool bIsBackwards = false;
 	bool bIsRight = false;
 	bool bIsLeft = false;
 	float Length = 0.f;
 	bool bEnableIK = false;
+	// predictive placement: the trace start of the landing location of the current step
+	FVector PredictedTraceLocation = FVector(0.f);
+	bool bIsLandingPredicted = false;
 	// support
 	FHitResult LastHit;
-	UPrimitiveComponent* SupportComp = nullptr;
-	FTransform SupportCompPreviousTransform = FTransform(FRotator(0.f), FVector(0.f), FVector(1.f));
+	// entry in the support components table, none when not supported by a moving component
+	int32 SupportCompIndex = INDEX_NONE;
 	FVector SupportCompDelta = FVector(0.f);
 	FVector RelLocationToSupportComp = FVector(0.f);
+	// the component is not in the snapshot yet: its relative location is set from the next one
+	bool bIsSupportCompPending = false;
+	FVector SupportCompRefLocation = FVector(0.f);
+};
+
+USTRUCT()
+struct SIMPLEPROCEDURALWALK_API FSimpleProceduralWalk_LegChainData
+{
+	GENERATED_USTRUCT_BODY()
+
+public:
+	// bones from the parent's parent to the tip bone
+	TArray<FCompactPoseBoneIndex> BoneIndices;
+	// index in BoneIndices of each link (bones with a length in the reference pose, the first bone being always a link)
+	TArray<int32> LinkTransformIndices;
+	// rotation limit of each link, in radians
+	TArray<float> LinkRotationLimits;
+	// is the chain moved by the body bone?
+	bool bIsChildOfBody = false;
+
+	bool IsValid() const { return BoneIndices.Num() > 0; }
+	int32 GetTipTransformIndex() const { return BoneIndices.Num() - 1; }
+	// the leg's parent bone comes right after the first bone of the chain
+	bool HasLegBones() const { return BoneIndices.Num() > 1; }
+	FCompactPoseBoneIndex GetParentBoneIndex() const { return BoneIndices[1]; }
+	FCompactPoseBoneIndex GetTipBoneIndex() const { return BoneIndices.Last(); }
+};
+
+USTRUCT()
+struct SIMPLEPROCEDURALWALK_API FSimpleProceduralWalk_LegIKCacheData
+{
+	GENERATED_USTRUCT_BODY()
+
+public:
+	// rotation of each link relative to its gathered local rotation, as of the last converged solve
+	// (so that starting from it still follows the animated pose)
+	TArray<FQuat> LinkLocalRotationDeltas;
+	// local rotation of each link as gathered in the current frame, and as started from
+	TArray<FQuat> GatheredLinkLocalRotations;
+	TArray<FQuat> WarmStartLinkLocalRotations;
+	// the target of that solve, relative to the chain root
+	FVector RootRelTarget = FVector(0.f);
+	bool bIsValid = false;
+	// has the chain been started from this data in the current frame?
+	bool bIsWarmStarted = false;
+	// idle: input transforms of every bone of the chain & effector of the last applied solve, in component space
+	TArray<FTransform> AppliedInputTransforms;
+	FVector AppliedEffectorLocation = FVector(0.f);
+	bool bIsApplied = false;
+	// is the last applied solve used as is in the current frame?
+	bool bIsFrozen = false;
+};
+
+USTRUCT()
+struct SIMPLEPROCEDURALWALK_API FSimpleProceduralWalk_LegAsyncTraceData
+{
+	GENERATED_USTRUCT_BODY()
+
+public:
+	// should foothold probes be submitted along with the line trace?
+	bool bNeedsFootHoldTrace = false;
 };
 
 USTRUCT()
@@ -93,6 +155,20 @@ public:
 	float StepPercent = 0.f;
 };
 
+USTRUCT()
+struct SIMPLEPROCEDURALWALK_API FSimpleProceduralWalk_GaitState
+{
+	GENERATED_USTRUCT_BODY()
+
+public:
+	// the group that will unplant next
+	int32 CurrentGroupIndex = 0;
+	// step phase of each group
+	TArray<FSimpleProceduralWalk_LegGroupData> GroupsData;
+
+	bool IsValid() const { return GroupsData.Num() > 0; }
+};
+
 UENUM(BlueprintType)
 enum class ESimpleProceduralWalk_MeshForwardAxis : uint8
 {
@@ -108,3 +184,19 @@ enum class ESimpleProceduralWalk_SolverType : uint8
 	BASIC = 0 UMETA(DisplayName = "Basic"),
 	ADVANCED = 1 UMETA(DisplayName = "Advanced"),
 };
+
+UENUM(BlueprintType)
+enum class ESimpleProceduralWalk_IKSolverType : uint8
+{
+	CCDIK = 0 UMETA(DisplayName = "CCDIK"),
+	FABRIK = 1 UMETA(DisplayName = "FABRIK"),
+};
+
+UENUM(BlueprintType)
+enum class ESimpleProceduralWalk_LODTier : uint8
+{
+	FULL = 0 UMETA(DisplayName = "Full"),
+	REDUCED_TRACE = 1 UMETA(DisplayName = "Reduced Trace"),
+	REDUCED_IK = 2 UMETA(DisplayName = "Reduced IK"),
+	PHASE_ONLY = 3 UMETA(DisplayName = "Phase Only"),
+};
@@ -0,0 +1,25 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#if !UE_BUILD_SHIPPING
+
+/**
+ * Counts the heap allocations (and reallocations) made by the current thread in its scope.
+ * The first counter wraps the global allocator in a forwarding proxy, kept until exit: meant for tests & benchmarks.
+ */
+struct SIMPLEPROCEDURALWALK_API FSPW_ScopeAllocationCounter
+{
+	FSPW_ScopeAllocationCounter();
+	~FSPW_ScopeAllocationCounter();
+
+	int32 GetNumAllocations() const { return NumAllocations; }
+
+private:
+	int32 NumAllocations = 0;
+	int32* PreviousCounter = nullptr;
+};
+
+#endif
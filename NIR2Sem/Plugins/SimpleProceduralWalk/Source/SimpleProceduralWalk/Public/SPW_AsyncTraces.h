@@ -0,0 +1,96 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "WorldCollision.h"
+#include "CollisionQueryParams.h"
+
+class UWorld;
+
+
+/** A trace requested by a leg for the current frame. */
+struct FSPW_AsyncTraceRequest
+{
+	int32 LegIndex = INDEX_NONE;
+	FVector StartLocation = FVector(0.f);
+	FVector EndLocation = FVector(0.f);
+	/** Foothold probes have the index of their probe, the leg line trace has none. */
+	int32 ProbeIndex = INDEX_NONE;
+};
+
+/**
+ * The submitted traces of a leg line trace or probe that have not been gathered yet, oldest first.
+ * A trace is only done after the world has swapped its async trace buffers, which may take longer than a frame;
+ * the world keeps results for as many frames as it has buffers, so older traces are dropped.
+ */
+struct FSPW_PendingTraces
+{
+	static constexpr int32 MaxTraces = 2;
+
+	FTraceHandle Handles[MaxTraces];
+
+	/** Adds a trace, dropping the oldest one when full. */
+	void Add(const FTraceHandle& Handle);
+
+	/** Removes the trace at an index & the older ones. */
+	void RemoveUpTo(int32 Index);
+};
+
+/** The result of a submitted trace, as gathered by the game thread. */
+struct FSPW_AsyncTraceResult
+{
+	// is the trace done?
+	bool bIsAvailable = false;
+	// its blocking hit, if any
+	FHitResult Hit;
+};
+
+/**
+ * Batch of the feet traces of a node.
+ * The anim thread queues the requests of a frame, and the game thread submits them all at once as async traces;
+ * the game thread then gathers their results before the next evaluation, so that the anim thread never queries the world.
+ * Shared between both threads, so every access is guarded.
+ */
+class SIMPLEPROCEDURALWALK_API FSPW_AsyncTraceBatch
+{
+public:
+	void Initialize(int32 NumLegs
+		, int32 InNumProbes
+		, ECollisionChannel InTraceChannel
+		, const FCollisionQueryParams& InQueryParams);
+
+	/** Anim thread: hand over the requests of a frame (the array is swapped with an empty recycled one). */
+	void QueueRequests(TArray<FSPW_AsyncTraceRequest>& InOutRequests);
+
+	/** Game thread: submit the queued requests. Returns false if there was nothing to submit. */
+	bool Submit(UWorld* World);
+
+	/** Game thread: get the results of the newest submitted traces that are done, traces that are not done yet are kept. */
+	void GatherResults(UWorld* World);
+
+	/** Anim thread: get the last line trace result of a leg. Returns false if it was not available. */
+	bool GetLineResult(int32 LegIndex, FHitResult& OutHit);
+
+	/** Anim thread: get the blocking hits of the last foothold probes of a leg. */
+	void GetProbeHits(int32 LegIndex, TArray<FHitResult>& OutHits);
+
+private:
+	FCriticalSection CriticalSection;
+
+	ECollisionChannel TraceChannel = ECC_Visibility;
+	FCollisionQueryParams QueryParams;
+	int32 NumProbes = 0;
+
+	// per leg
+	TArray<FSPW_PendingTraces> LineTraces;
+	TArray<FSPW_AsyncTraceResult> LineResults;
+	// NumProbes per leg
+	TArray<FSPW_PendingTraces> ProbeTraces;
+	TArray<FSPW_AsyncTraceResult> ProbeResults;
+	// reused query result
+	FTraceDatum TraceDatum;
+	void GatherResult(UWorld* World, FSPW_PendingTraces& InOutTraces, FSPW_AsyncTraceResult& OutResult);
+	TArray<FSPW_AsyncTraceRequest> PendingRequests;
+	bool bHasPendingRequests = false;
+};
@@ -0,0 +1,58 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FRichCurve;
+
+
+/**
+ * A curve over [0, 1] baked into a piecewise linear table: knots are placed at the curve keys (on both sides of steps),
+ * then where the table is the furthest from the curve, until it follows it within a tolerance.
+ * A grid of cells points to the knots, so evaluating does not search the table.
+ * Plain data, so it can be evaluated from any thread without touching the curve asset.
+ */
+struct SIMPLEPROCEDURALWALK_API FSPW_CurveTable
+{
+	static constexpr int32 MaxKnots = 128;
+	static constexpr int32 NumCells = 64;
+
+	/** Bakes the curve, from time 0 to time 1, within Tolerance where the knots allow it. */
+	void Bake(const FRichCurve& Curve, float Tolerance = .001f);
+
+	/** Fills the table with a constant value. */
+	void SetConstant(float Value);
+
+	/** Evaluates the table, time being clamped to [0, 1]. */
+	FORCEINLINE float Eval(float Time) const
+	{
+		const float ClampedTime = FMath::Clamp(Time, 0.f, 1.f);
+		int32 KnotIndex = CellKnots[FMath::Min((int32)(ClampedTime * NumCells), NumCells - 1)];
+		while (KnotIndex < NumKnots - 2 && Times[KnotIndex + 1] <= ClampedTime)
+		{
+			KnotIndex++;
+		}
+
+		const float SegmentDuration = Times[KnotIndex + 1] - Times[KnotIndex];
+		const float Alpha = SegmentDuration > 0.f ? (ClampedTime - Times[KnotIndex]) / SegmentDuration : 1.f;
+		return FMath::Lerp(Values[KnotIndex], Values[KnotIndex + 1], FMath::Clamp(Alpha, 0.f, 1.f));
+	}
+
+	/** Maximum difference with the curve, checked at regular intervals. */
+	float GetMaxError(const FRichCurve& Curve, int32 NumChecks = 1024) const;
+
+	int32 Num() const { return NumKnots; }
+
+private:
+	// knots, by increasing time (two knots share the time of a step)
+	float Times[MaxKnots] = { 0.f, 1.f };
+	float Values[MaxKnots] = {};
+	int32 NumKnots = 2;
+	// the last knot at or before the start of each cell
+	uint8 CellKnots[NumCells] = {};
+
+	void AddKnot(float Time, float Value);
+	float GetSegmentError(const FRichCurve& Curve, int32 KnotIndex) const;
+	void BuildCells();
+};
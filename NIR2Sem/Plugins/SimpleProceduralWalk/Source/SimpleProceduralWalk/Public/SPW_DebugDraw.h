@@ -0,0 +1,54 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UWorld;
+
+
+enum class ESPW_DebugPrimitiveType : uint8
+{
+	Sphere,
+	Line,
+	SolidBox,
+	CoordinateSystem,
+};
+
+/** A debug shape, with the parameters of its DrawDebug function. */
+struct FSPW_DebugPrimitive
+{
+	ESPW_DebugPrimitiveType Type = ESPW_DebugPrimitiveType::Sphere;
+	// sphere center, line start, box & coordinate system transform
+	FTransform Transform = FTransform::Identity;
+	// line end, box extent
+	FVector Vector = FVector(0.f);
+	// sphere radius, coordinate system scale
+	float Size = 0.f;
+	FColor Color = FColor::White;
+	float LifeTime = -1.f;
+	float Thickness = 0.f;
+};
+
+/**
+ * The debug shapes of a node for a frame.
+ * The anim thread adds them, and they are drawn at once by a single game thread task.
+ */
+struct SIMPLEPROCEDURALWALK_API FSPW_DebugDrawBuffer
+{
+public:
+	void AddSphere(const FVector& Center, float Radius, const FColor& Color, float LifeTime = -1.f);
+	void AddLine(const FVector& Start, const FVector& End, const FColor& Color);
+	void AddSolidBox(const FBox& Box, const FColor& Color, const FTransform& Transform);
+	void AddCoordinateSystem(const FVector& Location, const FRotator& Rotation, float Scale, float Thickness);
+
+	/** Draws the shapes added since the last flush, in a game thread task. */
+	void Flush(UWorld* World);
+
+	int32 Num() const { return Primitives.Num(); }
+
+private:
+	TArray<FSPW_DebugPrimitive> Primitives;
+	FSPW_DebugPrimitive& AddPrimitive(ESPW_DebugPrimitiveType Type, const FColor& Color);
+	static void Draw(UWorld* World, const TArray<FSPW_DebugPrimitive>& InPrimitives);
+};
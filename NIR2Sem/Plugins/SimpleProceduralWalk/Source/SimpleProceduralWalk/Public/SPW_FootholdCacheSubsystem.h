@@ -0,0 +1,134 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "SPW_FootholdCacheSubsystem.generated.h"
+
+class ULevel;
+class UPrimitiveComponent;
+class UPhysicalMaterial;
+
+
+/**
+ * Caches the feet line traces hits on static geometry, in a spatial hash of the impact cells (in the XY plane).
+ * Each cell keeps the surface of its hits, and the area they were sampled in: traces reaching that area, from no higher
+ * than the cached traces started, are intersected with the surface. Cells whose hits disagree (by normal or height,
+ * e.g. across a step edge) are not reused. Hits are kept until their component stops being static, is destroyed,
+ * or its level is streamed out. Levels streaming in flush the cache.
+ * Nodes query & feed it from animation threads; components are only read on the game thread, when it ticks.
+ */
+UCLASS()
+class SIMPLEPROCEDURALWALK_API USPW_FootholdCacheSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// USubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/** Looks up the hit of a downwards trace from Start to End. */
+	bool FindHit(const FVector& Start
+		, const FVector& End
+		, ECollisionChannel TraceChannel
+		, bool bTraceComplex
+		, FHitResult& OutHit);
+
+	/** Stores the hit of a downwards trace from Start to End, it is kept on the next tick if it is on static geometry. */
+	void AddHit(const FVector& Start
+		, const FVector& End
+		, ECollisionChannel TraceChannel
+		, bool bTraceComplex
+		, const FHitResult& Hit);
+
+	void Flush();
+	int32 Num() const;
+
+	/** The ratio of FindHit calls that found a hit, since the last flush. */
+	float GetHitRate() const;
+
+private:
+	struct FCellKey
+	{
+		FIntPoint Cell = FIntPoint::ZeroValue;
+		uint8 TraceChannel = 0;
+		bool bTraceComplex = false;
+
+		bool operator==(const FCellKey& Other) const
+		{
+			return Cell == Other.Cell && TraceChannel == Other.TraceChannel && bTraceComplex == Other.bTraceComplex;
+		}
+
+		bool operator!=(const FCellKey& Other) const
+		{
+			return !(*this == Other);
+		}
+
+		friend uint32 GetTypeHash(const FCellKey& Key)
+		{
+			return HashCombine(GetTypeHash(Key.Cell), HashCombine(GetTypeHash(Key.TraceChannel), GetTypeHash(Key.bTraceComplex)));
+		}
+	};
+
+	struct FEntry
+	{
+		FVector ImpactPoint = FVector(0.f);
+		FVector ImpactNormal = FVector(0.f, 0.f, 1.f);
+		// the XY area of the hits on this surface
+		FBox2D SampleBounds = FBox2D(ForceInit);
+		// how high above the surface the traces started, nothing was hit below
+		float ClearHeight = 0.f;
+		// false once hits in this cell disagree
+		bool bIsUniform = true;
+		TWeakObjectPtr<UPrimitiveComponent> Component;
+		TWeakObjectPtr<UPhysicalMaterial> PhysMaterial;
+		// resolved on the game thread
+		TWeakObjectPtr<ULevel> Level;
+		FActorInstanceHandle HitObjectHandle;
+	};
+
+	struct FPendingHit
+	{
+		FCellKey Key;
+		FEntry Entry;
+	};
+
+	static FCellKey MakeKey(const FVector& Location, ECollisionChannel TraceChannel, bool bTraceComplex);
+	static bool IsStatic(const UPrimitiveComponent* Component);
+	static bool IsSameSurface(const FEntry& Entry, const FEntry& OtherEntry);
+
+	/** The cached surface in the cell of Key that the trace goes into, with the distance to it & the impact. */
+	const FEntry* FindSurface(const FCellKey& Key
+		, const FVector& Start
+		, const FVector& TraceDirection
+		, float& OutDistance
+		, FVector& OutImpactPoint) const;
+
+	void AddPendingHits();
+	void RemoveStaleEntries();
+
+	void OnLevelAdded(ULevel* Level, UWorld* World);
+	void OnLevelRemoved(ULevel* Level, UWorld* World);
+
+	mutable FRWLock Lock;
+	TMap<FCellKey, FEntry> Entries;
+	FDelegateHandle LevelAddedHandle;
+	FDelegateHandle LevelRemovedHandle;
+
+	// hits added since the last tick, swapped out on the game thread
+	FCriticalSection PendingHitsCriticalSection;
+	TArray<FPendingHit> PendingHits;
+	TArray<FPendingHit> PendingHitsToAdd;
+	float TimeSinceStaleEntriesRemoval = 0.f;
+
+	// hit rate
+	FThreadSafeCounter NumQueries;
+	FThreadSafeCounter NumQueryHits;
+};
@@ -0,0 +1,54 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+
+/**
+ * Structure-of-arrays foothold candidates, relative to the location the search is made from.
+ * Depends on Core only, so that scoring can run outside of any world.
+ */
+struct SIMPLEPROCEDURALWALK_API FSPW_FootholdCandidates
+{
+	static constexpr int32 NumLanes = 4;
+
+	/** The location the search is made from. */
+	FVector Origin = FVector(0.f);
+	/** Impact points, relative to the origin. */
+	TArray<float> ImpactsX, ImpactsY, ImpactsZ;
+	/** Impact normals. */
+	TArray<float> NormalsX, NormalsY, NormalsZ;
+
+	int32 Num() const { return ImpactsX.Num(); }
+
+	/** Empties the candidates, keeping their allocations. */
+	void Reset(const FVector& InOrigin);
+
+	/** Allocates room for a number of candidates, so that searching does not allocate. */
+	void Reserve(int32 NumCandidates);
+
+	SIZE_T GetAllocatedSize() const;
+
+	void Add(const FVector& ImpactPoint, const FVector& ImpactNormal);
+};
+
+namespace SPW_Foothold
+{
+	/**
+	 * Builds the offsets of a fixed number of probes covering a disk of radius 1, as (forward, right) pairs.
+	 * Probes follow a sunflower spiral, so they are evenly spread and the inner ones come first.
+	 */
+	SIMPLEPROCEDURALWALK_API void BuildProbePattern(int32 NumProbes, TArray<FVector2D>& OutOffsets);
+
+	/**
+	 * Returns the index of the best candidate, or INDEX_NONE.
+	 * Candidates must be closer than MaxDistance to the origin, and are scored by their distance along the up vector
+	 * weighted by their slope (1 - dot of their normal with the up vector, so that walls are less appealing).
+	 * The lowest score below MaxScore wins, the first one on ties.
+	 */
+	SIMPLEPROCEDURALWALK_API int32 FindBestCandidate(const FSPW_FootholdCandidates& Candidates
+		, const FVector& UpVector
+		, float MaxDistance
+		, float MaxScore);
+}
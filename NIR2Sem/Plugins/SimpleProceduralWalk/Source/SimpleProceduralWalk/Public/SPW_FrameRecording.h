@@ -0,0 +1,141 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BoneIndices.h"
+#include "HAL/PlatformTime.h"
+#include "SPW.h"
+
+struct FBoneTransform;
+
+
+/** The part of a trace result that the node reads. */
+struct SIMPLEPROCEDURALWALK_API FSPW_RecordedHit
+{
+	bool bBlockingHit = false;
+	float Time = 1.f;
+	float Distance = 0.f;
+	FVector Location = FVector(0.f);
+	FVector ImpactPoint = FVector(0.f);
+	FVector Normal = FVector(0.f);
+	FVector ImpactNormal = FVector(0.f);
+	FVector TraceStart = FVector(0.f);
+	FVector TraceEnd = FVector(0.f);
+
+	FSPW_RecordedHit() {}
+	explicit FSPW_RecordedHit(const FHitResult& Hit);
+
+	/** Hit without component nor material, so that the support of the foot is not tracked. */
+	void ToHitResult(FHitResult& OutHit) const;
+
+	friend FArchive& operator<<(FArchive& Ar, FSPW_RecordedHit& Hit);
+};
+
+/**
+ * Everything the node reads from the world in a frame.
+ * While playing it is captured from the pawn & the mesh before the evaluation, and completed by the world queries of the evaluation;
+ * while replaying the node reads it instead of the world.
+ */
+struct SIMPLEPROCEDURALWALK_API FSPW_FrameInputs
+{
+	float DeltaSeconds = 0.f;
+	// pawn
+	FTransform ActorTransform = FTransform::Identity;
+	FRotator ActorRotation = FRotator(0.f);
+	FVector Velocity = FVector(0.f);
+	// unique id of the movement base, 0 when none (i.e. falling)
+	uint32 MovementBaseId = 0;
+	// mesh
+	FTransform ComponentTransform = FTransform::Identity;
+	// per leg, in world space, from the input pose
+	TArray<FVector> ParentBoneLocations;
+	TArray<FVector> TipBoneLocations;
+	// results of the world queries, in the order they were made
+	ESimpleProceduralWalk_LODTier LODTier = ESimpleProceduralWalk_LODTier::FULL;
+	TArray<FVector> SupportCompDeltas;
+	TArray<FSPW_RecordedHit> Hits;
+	// input pose: mesh indices of the required bones (only when they changed since the previous frame) & local transforms
+	TArray<FBoneIndexType> RequiredBones;
+	TArray<FTransform> LocalPose;
+
+	/** Clears the frame, keeping the allocations. */
+	void Reset(int32 NumLegs);
+
+	const FTransform& GetActorTransform() const { return ActorTransform; }
+	FVector GetActorLocation() const { return ActorTransform.GetLocation(); }
+	FRotator GetActorRotation() const { return ActorRotation; }
+	FVector GetActorForwardVector() const { return ActorTransform.GetUnitAxis(EAxis::X); }
+	FVector GetActorRightVector() const { return ActorTransform.GetUnitAxis(EAxis::Y); }
+	FVector GetActorUpVector() const { return ActorTransform.GetUnitAxis(EAxis::Z); }
+	FVector GetVelocity() const { return Velocity; }
+	bool HasMovementBase() const { return MovementBaseId != 0; }
+
+	friend FArchive& operator<<(FArchive& Ar, FSPW_FrameInputs& Inputs);
+};
+
+/** The bone transforms output by the node in a frame, before blending. */
+struct SIMPLEPROCEDURALWALK_API FSPW_FrameOutputs
+{
+	TArray<int32> BoneIndices;
+	TArray<FTransform> Transforms;
+
+	void Set(const TArray<FBoneTransform>& BoneTransforms);
+	/** Are both outputs the same, bit for bit? */
+	bool IsIdentical(const FSPW_FrameOutputs& Other) const;
+
+	friend FArchive& operator<<(FArchive& Ar, FSPW_FrameOutputs& Outputs);
+};
+
+/** Cycles spent by a replay in each part of the node. */
+struct FSPW_ReplayTimings
+{
+	uint64 ComputationsCycles = 0;
+	uint64 BodySolverCycles = 0;
+	uint64 CCDIKSolverCycles = 0;
+};
+
+/** Adds the cycles spent in its scope to a counter, if any. */
+struct FSPW_ScopeReplayCycles
+{
+	uint64* Cycles;
+	uint64 StartCycles;
+
+	explicit FSPW_ScopeReplayCycles(uint64* InCycles)
+		: Cycles(InCycles)
+		, StartCycles(InCycles != nullptr ? FPlatformTime::Cycles64() : 0)
+	{
+	}
+
+	~FSPW_ScopeReplayCycles()
+	{
+		if (Cycles != nullptr)
+		{
+			*Cycles += FPlatformTime::Cycles64() - StartCycles;
+		}
+	}
+};
+
+/**
+ * A node run, from its initialization: its settings, the inputs of each frame & the outputs they produced.
+ * Replaying it evaluates the node again without a world, see FAnimNode_SPW::InitializeReplay.
+ */
+struct SIMPLEPROCEDURALWALK_API FSPW_FrameRecording
+{
+	static const int32 VERSION = 1;
+
+	// node properties, exported as text
+	FString NodeSettings;
+	FString SkeletalMeshPath;
+	// node state that does not come from its settings
+	float OwnerHalfHeight = 0.f;
+	int32 FramesSinceTracesRefresh = 0;
+	// one of each per frame
+	TArray<FSPW_FrameInputs> Frames;
+	TArray<FSPW_FrameOutputs> Outputs;
+
+	bool SaveToFile(const FString& Filename) const;
+	bool LoadFromFile(const FString& Filename);
+
+	friend FArchive& operator<<(FArchive& Ar, FSPW_FrameRecording& Recording);
+};
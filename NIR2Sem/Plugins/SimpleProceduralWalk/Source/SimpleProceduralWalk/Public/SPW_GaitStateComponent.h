@@ -0,0 +1,38 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SPW.h"
+#include "Components/ActorComponent.h"
+#include "SPW_GaitStateComponent.generated.h"
+
+
+/**
+ * Hands the gait phase over between the walk node and other owners of the gait (i.e. a crowd simulation).
+ * When present on the pawn, the node continues from any phase handed over to it, and publishes its own phase every frame.
+ * Game thread only: the node reads & writes it in its PreUpdate.
+ */
+UCLASS(ClassGroup = (Animation), meta = (BlueprintSpawnableComponent))
+class SIMPLEPROCEDURALWALK_API USPW_GaitStateComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	USPW_GaitStateComponent();
+
+	/** Hands a phase over to the walk node, which continues from it in its next update. */
+	void HandOverGaitState(const FSimpleProceduralWalk_GaitState& InGaitState);
+
+	/** Takes the phase handed over since the last call, returns false when there is none. */
+	bool ConsumeHandedOverGaitState(FSimpleProceduralWalk_GaitState& OutGaitState);
+
+	/** The phase of the walk node, as of its last update. */
+	void SetGaitState(const FSimpleProceduralWalk_GaitState& InGaitState);
+	const FSimpleProceduralWalk_GaitState& GetGaitState() const { return GaitState; }
+
+private:
+	FSimpleProceduralWalk_GaitState GaitState;
+	FSimpleProceduralWalk_GaitState HandedOverGaitState;
+	bool bHasHandedOverGaitState = false;
+};
@@ -0,0 +1,42 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+
+/**
+ * The step a pawn takes in a frame.
+ * Computed the same way by the walk node and by the crowd simulation, so that the gait continues unchanged when one hands it over to the other.
+ */
+struct SIMPLEPROCEDURALWALK_API FSPW_GaitStep
+{
+	float Speed = 0.f;
+	// -1 to 1, how much the pawn moves along its forward (right) axis
+	float ForwardPercent = 0.f;
+	float RightPercent = 0.f;
+	float StepLength = 0.f;
+	float StepDuration = 0.f;
+};
+
+namespace SPW_Gait
+{
+	/** Below this speed, the pawn is not moving. */
+	static constexpr float SPEED_THRESHOLD_MIN = 2.f;
+
+	/**
+	 * Computes the step from the pawn velocity and its yaw delta in this frame (in degrees).
+	 * SlopeMultiplier reduces the step length on slopes, 1 on flat ground.
+	 */
+	SIMPLEPROCEDURALWALK_API FSPW_GaitStep ComputeStep(FVector Velocity
+		, const FVector& ForwardVector
+		, const FVector& RightVector
+		, float YawDelta
+		, float StepDistanceForward
+		, float StepDistanceRight
+		, float SlopeMultiplier
+		, float MinStepDuration);
+
+	/** Advances the step percent of an unplanted group by a frame, clamped to [0, 1]. */
+	SIMPLEPROCEDURALWALK_API float AdvanceStepPercent(float StepPercent, float DeltaSeconds, float StepDuration);
+}
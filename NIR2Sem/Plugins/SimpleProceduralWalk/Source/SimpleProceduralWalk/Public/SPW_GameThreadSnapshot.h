@@ -0,0 +1,53 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SPW.h"
+
+class UPrimitiveComponent;
+
+
+/**
+ * The pawn & component state the node needs in a frame.
+ * It is taken on the game thread in PreUpdate, so that the evaluation never reads the world objects.
+ */
+struct FSPW_GameThreadSnapshot
+{
+	// is there a snapshot for the coming evaluation?
+	bool bIsValid = false;
+	// pawn
+	FTransform ActorTransform = FTransform::Identity;
+	FRotator ActorRotation = FRotator(0.f);
+	FVector Velocity = FVector(0.f);
+	// unique id of the movement base, 0 when none (i.e. falling)
+	uint32 MovementBaseId = 0;
+	// per entry of the support components table, the component (if still valid) & its transform
+	TArray<const UPrimitiveComponent*> SupportComps;
+	TArray<FTransform> SupportCompTransforms;
+	// LOD
+	bool bWasRecentlyRendered = true;
+	// from the mesh to the closest view rendered last frame, negative when there are no views
+	float ClosestViewDistanceSquared = -1.f;
+	// gait phase handed over to the node since the previous snapshot
+	bool bHasHandedOverGaitState = false;
+	FSimpleProceduralWalk_GaitState HandedOverGaitState;
+	// debug: size of the mesh bounds box, 0 when not debugging
+	float MeshBoxSize = 0.f;
+
+	/** Clears the snapshot, keeping the allocations. */
+	void Reset()
+	{
+		bIsValid = false;
+		ActorTransform = FTransform::Identity;
+		ActorRotation = FRotator(0.f);
+		Velocity = FVector(0.f);
+		MovementBaseId = 0;
+		SupportComps.Reset();
+		SupportCompTransforms.Reset();
+		bWasRecentlyRendered = true;
+		ClosestViewDistanceSquared = -1.f;
+		bHasHandedOverGaitState = false;
+		MeshBoxSize = 0.f;
+	}
+};
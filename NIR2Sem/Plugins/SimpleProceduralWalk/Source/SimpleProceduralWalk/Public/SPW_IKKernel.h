@@ -0,0 +1,133 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+
+/**
+ * Structure-of-arrays IK chain, from root to tip.
+ * Only links with a non-zero length are stored: zero length bones follow the link that precedes them.
+ * Depends on Core only, so it can be solved outside of any animation context.
+ */
+struct SIMPLEPROCEDURALWALK_API FSPW_IKChain
+{
+	/** Component space positions. */
+	TArray<FVector> Positions;
+	/** Component space rotations. */
+	TArray<FQuat> Rotations;
+	/** Translations relative to the previous link, in its (scaled) rotation frame. */
+	TArray<FVector> LocalOffsets;
+	/** Rotations relative to the previous link. */
+	TArray<FQuat> LocalRotations;
+	/** Rotation accumulated by each link during a solve (used by rotation limits). */
+	TArray<float> AngleDeltas;
+	/** Length of each link, i.e. the distance from the previous one (used by FABRIK). */
+	TArray<float> Lengths;
+	/** Rotation limit of each link, in radians. */
+	TArray<float> RotationLimits;
+	/** Index of each link in the transforms of the leg. */
+	TArray<int32> TransformIndices;
+	/** Should the accumulated rotation of each link be limited? */
+	bool bEnableRotationLimits = false;
+
+	int32 Num() const { return Positions.Num(); }
+
+	/** Empties the chain, keeping its allocations. */
+	void Reset();
+
+	/** Allocates room for a number of links, so that gathering them does not allocate. */
+	void Reserve(int32 NumLinks);
+
+	SIZE_T GetAllocatedSize() const;
+
+	/** Appends a link, given its component space and local space transforms. */
+	void AddLink(const FTransform& CSTransform, const FTransform& LocalTransform, int32 TransformIndex, float RotationLimitInRadians);
+
+private:
+	FVector LastLinkScale = FVector(1.f);
+};
+
+/** Solver settings shared by all the chains of a node. */
+struct SIMPLEPROCEDURALWALK_API FSPW_IKSolveSettings
+{
+	/** Tolerance for final tip location delta. */
+	float Precision = 1.f;
+	/** Maximum number of iterations. */
+	int32 MaxIterations = 10;
+	/** Iterate from the tip to the root. */
+	bool bStartFromTail = false;
+};
+
+/** Outcome of a chain solve. */
+struct SIMPLEPROCEDURALWALK_API FSPW_IKSolveResult
+{
+	/** Have any links been moved? */
+	bool bUpdated = false;
+	/** Number of iterations spent. */
+	int32 Iterations = 0;
+};
+
+/** Reusable storage for batched solves, with one SIMD lane per chain. */
+struct SIMPLEPROCEDURALWALK_API FSPW_IKChainBatch
+{
+	static constexpr int32 NumLanes = 4;
+
+	int32 NumLinks = 0;
+
+	// per link, each register holds one component for all lanes
+	TArray<VectorRegister4Float> PositionsX, PositionsY, PositionsZ;
+	TArray<VectorRegister4Float> RotationsX, RotationsY, RotationsZ, RotationsW;
+	TArray<VectorRegister4Float> LocalOffsetsX, LocalOffsetsY, LocalOffsetsZ;
+	TArray<VectorRegister4Float> LocalRotationsX, LocalRotationsY, LocalRotationsZ, LocalRotationsW;
+	TArray<VectorRegister4Float> AngleDeltas;
+	TArray<VectorRegister4Float> RotationLimits;
+
+	void SetNumLinks(int32 InNumLinks);
+
+	SIZE_T GetAllocatedSize() const;
+};
+
+namespace SPW_IK
+{
+	/** Solves a single chain with CCDIK. */
+	SIMPLEPROCEDURALWALK_API FSPW_IKSolveResult SolveCCDIK(FSPW_IKChain& InOutChain
+		, const FVector& TargetPosition
+		, const FSPW_IKSolveSettings& Settings);
+
+	/**
+	 * Solves a single chain with FABRIK, on the link positions only, then rotates the links to follow them.
+	 * With rotation limits, the rotation of each link is clamped after every iteration, so the next one starts from a valid pose.
+	 * bStartFromTail is ignored.
+	 */
+	SIMPLEPROCEDURALWALK_API FSPW_IKSolveResult SolveFABRIK(FSPW_IKChain& InOutChain
+		, const FVector& TargetPosition
+		, const FSPW_IKSolveSettings& Settings);
+
+	/**
+	 * Solves chains of two or three bones (4 or 5 links, the root being one) in closed form, bending in the plane of their current joints.
+	 * Three bones keep the angle of the first bone as close to the current one as the two others can reach.
+	 * Returns false and leaves the chain untouched for other chains, out of reach targets, or exceeded rotation limits.
+	 */
+	SIMPLEPROCEDURALWALK_API bool SolveAnalytic(FSPW_IKChain& InOutChain
+		, const FVector& TargetPosition
+		, FSPW_IKSolveResult& OutResult);
+
+	/**
+	 * Sets the local rotations of all the links but the root, and moves the links that follow (i.e. to start from a previous solve).
+	 * Accumulated rotations start from the angle to the gathered rotations, so rotation limits are still relative to the gathered pose.
+	 */
+	SIMPLEPROCEDURALWALK_API void SetLocalRotations(FSPW_IKChain& InOutChain, const TArray<FQuat>& LocalRotations);
+
+	/**
+	 * Solves up to FSPW_IKChainBatch::NumLanes chains at once with CCDIK, one chain per SIMD lane.
+	 * All the chains must have the same number of links.
+	 * Matches SolveCCDIK within the settings precision (lanes are computed in single precision).
+	 */
+	SIMPLEPROCEDURALWALK_API void SolveCCDIKBatch(FSPW_IKChain* const* InOutChains
+		, const FVector* TargetPositions
+		, int32 NumChains
+		, const FSPW_IKSolveSettings& Settings
+		, FSPW_IKChainBatch& Batch
+		, FSPW_IKSolveResult* OutResults);
+}
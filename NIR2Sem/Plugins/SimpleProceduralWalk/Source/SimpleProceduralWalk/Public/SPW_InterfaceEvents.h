@@ -0,0 +1,62 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/CircularQueue.h"
+#include "HAL/ThreadSafeCounter.h"
+
+
+/** The events of ISimpleProceduralWalkInterface. */
+enum class ESPW_InterfaceEventType : uint8
+{
+	FootDown,
+	FootUp,
+	GroupDown,
+	GroupUp,
+	PawnLanded,
+};
+
+/** An interface event, with its values as of when it happened. */
+struct FSPW_InterfaceEvent
+{
+	ESPW_InterfaceEventType Type = ESPW_InterfaceEventType::PawnLanded;
+	/** The leg or group index, none when landing. */
+	int32 Index = INDEX_NONE;
+	FName TipBone = NAME_None;
+	FVector Location = FVector(0.f);
+
+	FSPW_InterfaceEvent() {}
+	FSPW_InterfaceEvent(ESPW_InterfaceEventType InType, int32 InIndex, FName InTipBone, const FVector& InLocation)
+		: Type(InType)
+		, Index(InIndex)
+		, TipBone(InTipBone)
+		, Location(InLocation)
+	{
+	}
+};
+
+/**
+ * The interface events of a node, in a fixed capacity lock-free queue: the anim thread evaluating the node is the only
+ * producer, the game thread the only consumer. The capacity is two frames of events (rounded up to a power of two, minus one),
+ * so that queuing never allocates; events queued when it is full are dropped & counted.
+ */
+class SIMPLEPROCEDURALWALK_API FSPW_InterfaceEventQueue
+{
+public:
+	explicit FSPW_InterfaceEventQueue(int32 NumEventsPerFrame);
+
+	/** Returns false when the queue is full, and the event is dropped. */
+	bool Enqueue(const FSPW_InterfaceEvent& Event);
+
+	/** Calls each queued event on all the implementers of the interface, in the order the events happened. Game thread only. */
+	int32 Dispatch(TArrayView<const TWeakObjectPtr<UObject>> Implementers);
+
+	int32 GetCapacity() const { return Capacity; }
+
+private:
+	int32 Capacity;
+	TCircularQueue<FSPW_InterfaceEvent> Events;
+	// since the last dispatch
+	FThreadSafeCounter NumDroppedEvents;
+};
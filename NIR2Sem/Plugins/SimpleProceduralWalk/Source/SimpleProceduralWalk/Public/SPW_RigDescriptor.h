@@ -0,0 +1,49 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SPW.h"
+#include "BoneControllers/AnimNode_SkeletalControlBase.h"
+
+
+/**
+ * What a node derives from its settings and its bone container, and never changes afterwards.
+ * Shared by all the nodes with the same mesh, required bones and legs set up (i.e. a crowd of the same creature),
+ * so that instances only carry their per-frame state.
+ */
+struct SIMPLEPROCEDURALWALK_API FSPW_RigDescriptor
+{
+	// per leg: the parent's parent bone (CCDIK excludes the first bone of the chain), the tip bone and the effector
+	TArray<FBoneReference> ParentBones;
+	TArray<FBoneReference> TipBones;
+	TArray<FBoneSocketTarget> EffectorTargets;
+	// per leg: the bone chain, with rotation limits in radians
+	TArray<FSimpleProceduralWalk_LegChainData> LegsChainData;
+	// per leg: the index of its group
+	TArray<int32> LegsGroupIndex;
+
+	SIZE_T GetAllocatedSize() const;
+
+	/**
+	 * Returns the descriptor matching the settings & bone container, creating it if no other node holds it anymore.
+	 * Thread safe, nodes initialize their bones on worker threads.
+	 */
+	static TSharedRef<const FSPW_RigDescriptor, ESPMode::ThreadSafe> FindOrCreate(const TArray<FSimpleProceduralWalk_Leg>& Legs
+		, const TArray<FSimpleProceduralWalk_LegGroup>& LegGroups
+		, const FBoneReference& BodyBone
+		, const FBoneContainer& RequiredBones);
+
+private:
+	void Initialize(const TArray<FSimpleProceduralWalk_Leg>& Legs
+		, const TArray<FSimpleProceduralWalk_LegGroup>& LegGroups
+		, FBoneReference BodyBone
+		, const FBoneContainer& RequiredBones);
+
+	void InitializeLegBones(const FSimpleProceduralWalk_Leg& Leg, const FBoneContainer& RequiredBones);
+
+	void InitializeLegChain(int32 LegIndex
+		, const FSimpleProceduralWalk_Leg& Leg
+		, const FBoneReference& BodyBone
+		, const FBoneContainer& RequiredBones);
+};
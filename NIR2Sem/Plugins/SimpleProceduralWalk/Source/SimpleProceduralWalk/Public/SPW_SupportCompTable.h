@@ -0,0 +1,48 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UPrimitiveComponent;
+
+
+/** A component supporting some of the feet, with its transforms as of the last two snapshots. */
+struct FSPW_SupportComp
+{
+	// identity of the component, only dereferenced on the game thread
+	const UPrimitiveComponent* Component = nullptr;
+	// legs standing on it, the entry is free when none
+	int32 NumLegs = 0;
+	// none until the first snapshot of the component
+	bool bHasTransform = false;
+	bool bHasMoved = false;
+	FTransform PreviousTransform = FTransform::Identity;
+	FTransform Transform = FTransform::Identity;
+};
+
+/**
+ * The distinct components supporting the feet of a creature, so that each is read & compared once per frame
+ * however many legs stand on it. Static components never move, they are not tracked.
+ */
+struct SIMPLEPROCEDURALWALK_API FSPW_SupportCompTable
+{
+public:
+	/** Adds a leg standing on the component, returns its entry (none for no or static components). */
+	int32 AddLeg(const UPrimitiveComponent* Component);
+	/** Removes a leg from the entry, freeing it when it was the last one. */
+	void RemoveLeg(int32 Index);
+
+	/**
+	 * Sets the transforms of the components, as read by the game thread: per entry, the component if still valid & its transform.
+	 * Entries whose component is not the one read (i.e. added since, or destroyed) do not move.
+	 */
+	void Update(const TArray<const UPrimitiveComponent*>& InComponents, const TArray<FTransform>& InTransforms);
+
+	void Reset() { Entries.Reset(); }
+	int32 Num() const { return Entries.Num(); }
+	const FSPW_SupportComp& operator[](int32 Index) const { return Entries[Index]; }
+
+private:
+	TArray<FSPW_SupportComp, TInlineAllocator<4>> Entries;
+};
@@ -0,0 +1,218 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#include "SPW_BenchmarkCommandlet.h"
+#include "SimpleProceduralWalkEditor.h"
+#include "SPW_IKKernel.h"
+#include "HAL/PlatformTime.h"
+#include "Math/RandomStream.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Parse.h"
+
+// constants
+static const int32 BENCHMARK_CHAIN_DEPTHS[] = { 2, 3, 4, 5, 6, 7, 8 };
+static const int32 BENCHMARK_LEG_COUNTS[] = { 4, 8, 16, 32, 64 };
+static const int32 BENCHMARK_MAX_ITERATIONS[] = { 5, 10, 20 };
+static const float BENCHMARK_PRECISIONS[] = { .1f, 1.f };
+static const float BENCHMARK_BONE_LENGTH = 20.f;
+static const float BENCHMARK_ROTATION_LIMIT = 30.f;
+static const TCHAR* BENCHMARK_SOLVER_NAMES[] = { TEXT("Scalar"), TEXT("Batched"), TEXT("Analytic"), TEXT("FABRIK") };
+
+
+namespace SPW_Benchmark
+{
+	/**
+	 * A leg hanging from its root with slightly bent joints, and a target within reach.
+	 * Depth is the number of bones below the root (the root link is never rotated by the solver).
+	 */
+	static void MakeLeg(FRandomStream& Random, int32 Depth, bool bEnableRotationLimits, FSPW_IKChain& OutChain, FVector& OutTarget)
+	{
+		OutChain.Reset();
+		OutChain.bEnableRotationLimits = bEnableRotationLimits;
+
+		FTransform CSTransform = FTransform::Identity;
+		FVector FirstJointLocation = FVector(0.f);
+
+		for (int32 LinkIndex = 0; LinkIndex <= Depth; LinkIndex++)
+		{
+			FTransform LocalTransform = FTransform::Identity;
+			if (LinkIndex > 0)
+			{
+				FRotator LocalRotation(Random.FRandRange(-15.f, 15.f), 0.f, Random.FRandRange(-15.f, 15.f));
+				LocalTransform = FTransform(LocalRotation, FVector(0.f, 0.f, -BENCHMARK_BONE_LENGTH));
+				CSTransform = LocalTransform * CSTransform;
+			}
+			if (LinkIndex == 1)
+			{
+				FirstJointLocation = CSTransform.GetLocation();
+			}
+
+			OutChain.AddLink(CSTransform, LocalTransform, LinkIndex, LinkIndex > 0 ? FMath::DegreesToRadians(BENCHMARK_ROTATION_LIMIT) : 0.f);
+		}
+
+		// below the first joint that can rotate
+		const float Reach = BENCHMARK_BONE_LENGTH * (Depth - 1);
+		FVector Direction = Random.GetUnitVector();
+		Direction.Z = -FMath::Abs(Direction.Z);
+		OutTarget = FirstJointLocation + Direction * Random.FRandRange(.5f, .95f) * Reach;
+	}
+}
+
+USPW_BenchmarkCommandlet::USPW_BenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 USPW_BenchmarkCommandlet::Main(const FString& Params)
+{
+	int32 Repetitions = 100;
+	int32 Seed = 1;
+	FString OutputPath;
+	FParse::Value(*Params, TEXT("Repetitions="), Repetitions);
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+	FParse::Value(*Params, TEXT("Output="), OutputPath);
+	Repetitions = FMath::Max(Repetitions, 1);
+
+	UE_LOG(LogSimpleProceduralWalkEditor, Display, TEXT("CCDIK benchmark: %d repetitions, seed %d."), Repetitions, Seed);
+
+	FString Report = TEXT("Solver,Depth,Legs,MaxIterations,Precision,RotationLimits,StartFromTail,NsPerLegSolve,AverageIterations,ConvergedPercent\n");
+
+	// storage
+	TArray<FSPW_IKChain> SourceChains;
+	TArray<FSPW_IKChain> Chains;
+	TArray<FSPW_IKChain*> ChainPointers;
+	TArray<FVector> Targets;
+	TArray<FSPW_IKSolveResult> Results;
+	FSPW_IKChainBatch Batch;
+
+	for (int32 Depth : BENCHMARK_CHAIN_DEPTHS)
+	{
+		for (int32 NumLegs : BENCHMARK_LEG_COUNTS)
+		{
+			for (int32 RotationLimitsIndex = 0; RotationLimitsIndex < 2; RotationLimitsIndex++)
+			{
+				const bool bEnableRotationLimits = RotationLimitsIndex == 1;
+
+				// same legs for all settings
+				FRandomStream Random(Seed);
+				SourceChains.SetNum(NumLegs);
+				Chains.SetNum(NumLegs);
+				Targets.SetNum(NumLegs);
+				Results.SetNum(NumLegs);
+				ChainPointers.SetNum(NumLegs);
+				for (int32 LegIndex = 0; LegIndex < NumLegs; LegIndex++)
+				{
+					SPW_Benchmark::MakeLeg(Random, Depth, bEnableRotationLimits, SourceChains[LegIndex], Targets[LegIndex]);
+					ChainPointers[LegIndex] = &Chains[LegIndex];
+				}
+
+				for (int32 StartFromTailIndex = 0; StartFromTailIndex < 2; StartFromTailIndex++)
+				{
+					for (int32 MaxIterations : BENCHMARK_MAX_ITERATIONS)
+					{
+						for (float Precision : BENCHMARK_PRECISIONS)
+						{
+							FSPW_IKSolveSettings Settings;
+							Settings.Precision = Precision;
+							Settings.MaxIterations = MaxIterations;
+							Settings.bStartFromTail = StartFromTailIndex == 1;
+
+							for (int32 SolverIndex = 0; SolverIndex < UE_ARRAY_COUNT(BENCHMARK_SOLVER_NAMES); SolverIndex++)
+							{
+								const bool bBatched = SolverIndex == 1;
+								const bool bAnalytic = SolverIndex == 2;
+								const bool bFABRIK = SolverIndex == 3;
+								uint64 Cycles = 0;
+								int64 TotalIterations = 0;
+								int64 NumConverged = 0;
+
+								for (int32 Repetition = 0; Repetition < Repetitions; Repetition++)
+								{
+									// reset (not timed)
+									for (int32 LegIndex = 0; LegIndex < NumLegs; LegIndex++)
+									{
+										Chains[LegIndex] = SourceChains[LegIndex];
+									}
+
+									// solve
+									const uint64 StartCycles = FPlatformTime::Cycles64();
+									if (bBatched)
+									{
+										for (int32 FirstLegIndex = 0; FirstLegIndex < NumLegs; FirstLegIndex += FSPW_IKChainBatch::NumLanes)
+										{
+											SPW_IK::SolveCCDIKBatch(&ChainPointers[FirstLegIndex]
+												, &Targets[FirstLegIndex]
+												, FMath::Min(FSPW_IKChainBatch::NumLanes, NumLegs - FirstLegIndex)
+												, Settings
+												, Batch
+												, &Results[FirstLegIndex]);
+										}
+									}
+									else
+									{
+										for (int32 LegIndex = 0; LegIndex < NumLegs; LegIndex++)
+										{
+											if (bFABRIK)
+											{
+												Results[LegIndex] = SPW_IK::SolveFABRIK(Chains[LegIndex], Targets[LegIndex], Settings);
+											}
+											else if (!bAnalytic || !SPW_IK::SolveAnalytic(Chains[LegIndex], Targets[LegIndex], Results[LegIndex]))
+											{
+												Results[LegIndex] = SPW_IK::SolveCCDIK(Chains[LegIndex], Targets[LegIndex], Settings);
+											}
+										}
+									}
+									Cycles += FPlatformTime::Cycles64() - StartCycles;
+
+									// convergence
+									for (int32 LegIndex = 0; LegIndex < NumLegs; LegIndex++)
+									{
+										TotalIterations += Results[LegIndex].Iterations;
+										if (FVector::Dist(Chains[LegIndex].Positions.Last(), Targets[LegIndex]) <= Precision)
+										{
+											++NumConverged;
+										}
+									}
+								}
+
+								const double NumSolves = (double)Repetitions * NumLegs;
+								const double NsPerLegSolve = FPlatformTime::ToSeconds64(Cycles) * 1e9 / NumSolves;
+								const double AverageIterations = TotalIterations / NumSolves;
+								const double ConvergedPercent = 100.0 * NumConverged / NumSolves;
+
+								FString Line = FString::Printf(TEXT("%s,%d,%d,%d,%.2f,%d,%d,%.1f,%.2f,%.1f")
+									, BENCHMARK_SOLVER_NAMES[SolverIndex]
+									, Depth
+									, NumLegs
+									, MaxIterations
+									, Precision
+									, bEnableRotationLimits
+									, Settings.bStartFromTail
+									, NsPerLegSolve
+									, AverageIterations
+									, ConvergedPercent);
+
+								UE_LOG(LogSimpleProceduralWalkEditor, Display, TEXT("%s"), *Line);
+								Report += Line + TEXT("\n");
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	if (!OutputPath.IsEmpty())
+	{
+		if (!FFileHelper::SaveStringToFile(Report, *OutputPath))
+		{
+			UE_LOG(LogSimpleProceduralWalkEditor, Error, TEXT("Could not write benchmark results to %s."), *OutputPath);
+			return 1;
+		}
+		UE_LOG(LogSimpleProceduralWalkEditor, Display, TEXT("Benchmark results written to %s."), *OutputPath);
+	}
+
+	return 0;
+}
@@ -0,0 +1,163 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#include "SPW_ReplayCommandlet.h"
+#include "SimpleProceduralWalkEditor.h"
+#include "AnimNode_SPW.h"
+#include "SPW_FrameRecording.h"
+#include "BonePose.h"
+#include "Engine/SkeletalMesh.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Parse.h"
+
+
+namespace SPW_Replay
+{
+	static double ToMicroseconds(uint64 Cycles, int32 Repetitions)
+	{
+		return FPlatformTime::ToSeconds64(Cycles) * 1e6 / Repetitions;
+	}
+}
+
+USPW_ReplayCommandlet::USPW_ReplayCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 USPW_ReplayCommandlet::Main(const FString& Params)
+{
+	FString RecordingPath;
+	int32 Repetitions = 10;
+	FString OutputPath;
+	FParse::Value(*Params, TEXT("Recording="), RecordingPath);
+	FParse::Value(*Params, TEXT("Repetitions="), Repetitions);
+	FParse::Value(*Params, TEXT("Output="), OutputPath);
+	Repetitions = FMath::Max(Repetitions, 1);
+
+	FSPW_FrameRecording Recording;
+	if (RecordingPath.IsEmpty() || !Recording.LoadFromFile(RecordingPath))
+	{
+		UE_LOG(LogSimpleProceduralWalkEditor, Error, TEXT("A valid recording must be specified with -Recording=<file.spwrec>."));
+		return 1;
+	}
+
+	USkeletalMesh* SkeletalMesh = LoadObject<USkeletalMesh>(nullptr, *Recording.SkeletalMeshPath);
+	if (SkeletalMesh == nullptr)
+	{
+		UE_LOG(LogSimpleProceduralWalkEditor, Error, TEXT("Could not load the recorded skeletal mesh %s."), *Recording.SkeletalMeshPath);
+		return 1;
+	}
+
+	UE_LOG(LogSimpleProceduralWalkEditor, Display, TEXT("Replaying %d frames of %s, %d repetitions."), Recording.Frames.Num(), *RecordingPath, Repetitions);
+
+	// storage
+	TArray<FSPW_ReplayTimings> FramesTimings;
+	FramesTimings.SetNum(Recording.Frames.Num());
+	FBoneContainer BoneContainer;
+	FCompactPose LocalPose;
+	FCSPose<FCompactPose> Pose;
+	TArray<FBoneTransform> BoneTransforms;
+	FSPW_FrameOutputs Outputs;
+	int32 NumMismatches = 0;
+
+	for (int32 Repetition = 0; Repetition < Repetitions; Repetition++)
+	{
+		// a new node each time, as when the pawn spawned
+		FAnimNode_SPW Node;
+		FAnimNode_SPW::StaticStruct()->ImportText(*Recording.NodeSettings, &Node, nullptr, PPF_None, GWarn, FAnimNode_SPW::StaticStruct()->GetName());
+		if (!Node.InitializeReplay(Recording))
+		{
+			return 1;
+		}
+
+		for (int32 FrameIndex = 0; FrameIndex < Recording.Frames.Num(); FrameIndex++)
+		{
+			const FSPW_FrameInputs& Inputs = Recording.Frames[FrameIndex];
+
+			// input pose (not timed)
+			if (Inputs.RequiredBones.Num() > 0)
+			{
+				BoneContainer.InitializeTo(Inputs.RequiredBones, FCurveEvaluationOption(false), *SkeletalMesh);
+				Node.InitializeBoneReferences(BoneContainer);
+			}
+
+			LocalPose.ResetToRefPose(BoneContainer);
+			if (LocalPose.GetNumBones() != Inputs.LocalPose.Num())
+			{
+				UE_LOG(LogSimpleProceduralWalkEditor, Error, TEXT("Frame %d: the recorded pose does not match the skeletal mesh."), FrameIndex);
+				return 1;
+			}
+			for (FCompactPoseBoneIndex BoneIndex : LocalPose.ForEachBoneIndex())
+			{
+				LocalPose[BoneIndex] = Inputs.LocalPose[BoneIndex.GetInt()];
+			}
+			Pose.InitPose(LocalPose);
+
+			// evaluate
+			BoneTransforms.Reset();
+			Node.ReplayFrame(Inputs, Pose, BoneTransforms, &FramesTimings[FrameIndex]);
+
+			// compare
+			if (Repetition == 0)
+			{
+				Outputs.Set(BoneTransforms);
+				if (!Outputs.IsIdentical(Recording.Outputs[FrameIndex]))
+				{
+					if (NumMismatches == 0)
+					{
+						UE_LOG(LogSimpleProceduralWalkEditor, Warning, TEXT("Frame %d is the first frame whose outputs differ from the recorded ones."), FrameIndex);
+					}
+					++NumMismatches;
+				}
+			}
+		}
+	}
+
+	// report
+	FString Report = TEXT("Frame,ComputationsUs,BodySolverUs,CCDIKSolverUs\n");
+	FSPW_ReplayTimings TotalTimings;
+
+	for (int32 FrameIndex = 0; FrameIndex < FramesTimings.Num(); FrameIndex++)
+	{
+		const FSPW_ReplayTimings& Timings = FramesTimings[FrameIndex];
+		TotalTimings.ComputationsCycles += Timings.ComputationsCycles;
+		TotalTimings.BodySolverCycles += Timings.BodySolverCycles;
+		TotalTimings.CCDIKSolverCycles += Timings.CCDIKSolverCycles;
+
+		Report += FString::Printf(TEXT("%d,%.2f,%.2f,%.2f\n")
+			, FrameIndex
+			, SPW_Replay::ToMicroseconds(Timings.ComputationsCycles, Repetitions)
+			, SPW_Replay::ToMicroseconds(Timings.BodySolverCycles, Repetitions)
+			, SPW_Replay::ToMicroseconds(Timings.CCDIKSolverCycles, Repetitions));
+	}
+
+	const int32 NumFrameRuns = FMath::Max(Recording.Frames.Num(), 1) * Repetitions;
+	UE_LOG(LogSimpleProceduralWalkEditor, Display, TEXT("Per frame: computations %.2f us, body solver %.2f us, CCDIK solver %.2f us.")
+		, SPW_Replay::ToMicroseconds(TotalTimings.ComputationsCycles, NumFrameRuns)
+		, SPW_Replay::ToMicroseconds(TotalTimings.BodySolverCycles, NumFrameRuns)
+		, SPW_Replay::ToMicroseconds(TotalTimings.CCDIKSolverCycles, NumFrameRuns));
+
+	if (NumMismatches > 0)
+	{
+		UE_LOG(LogSimpleProceduralWalkEditor, Warning, TEXT("Outputs differ from the recorded ones in %d of %d frames."), NumMismatches, Recording.Frames.Num());
+	}
+	else
+	{
+		UE_LOG(LogSimpleProceduralWalkEditor, Display, TEXT("Outputs are identical to the recorded ones."));
+	}
+
+	if (!OutputPath.IsEmpty())
+	{
+		if (!FFileHelper::SaveStringToFile(Report, *OutputPath))
+		{
+			UE_LOG(LogSimpleProceduralWalkEditor, Error, TEXT("Could not write replay results to %s."), *OutputPath);
+			return 1;
+		}
+		UE_LOG(LogSimpleProceduralWalkEditor, Display, TEXT("Replay results written to %s."), *OutputPath);
+	}
+
+	return NumMismatches > 0 ? 1 : 0;
+}
@@ -2,6 +2,9 @@
 
 #include "SimpleProceduralWalkEditor.h"
 
+// log
+DEFINE_LOG_CATEGORY(LogSimpleProceduralWalkEditor);
+
 #define LOCTEXT_NAMESPACE "FSimpleProceduralWalkEditor"
 
 void FSimpleProceduralWalkEditor::StartupModule()
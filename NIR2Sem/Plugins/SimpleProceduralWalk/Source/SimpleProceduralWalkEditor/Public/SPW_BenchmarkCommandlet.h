@@ -0,0 +1,26 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "SPW_BenchmarkCommandlet.generated.h"
+
+
+/**
+ * Headless benchmark of the CCDIK kernel, so that solver changes can be compared on any editor platform.
+ * Usage: UnrealEditor-Cmd <Project> -run=SPW_Benchmark [-Repetitions=200] [-Seed=1] [-Output=<file.csv>]
+ * Sweeps chain depth, leg count, max iterations, precision, rotation limits & start from tail,
+ * and reports ns per leg solve and iterations to convergence, for the scalar, batched & analytic CCDIK solvers and FABRIK.
+ */
+UCLASS()
+class SIMPLEPROCEDURALWALKEDITOR_API USPW_BenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	USPW_BenchmarkCommandlet();
+
+	// UCommandlet interface
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,26 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "SPW_ReplayCommandlet.generated.h"
+
+
+/**
+ * Headless replay of a node recording (see bRecordFrames), so that the same walk can be run through different builds.
+ * Usage: UnrealEditor-Cmd <Project> -run=SPW_Replay -Recording=<file.spwrec> [-Repetitions=10] [-Output=<file.csv>]
+ * Evaluates the recorded frames without a world, reports the time spent in the computations, the body solver & the CCDIK solver,
+ * and checks bit for bit that the outputs are the recorded ones.
+ */
+UCLASS()
+class SIMPLEPROCEDURALWALKEDITOR_API USPW_ReplayCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	USPW_ReplayCommandlet();
+
+	// UCommandlet interface
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,55 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#include "SPW_MassFragments.h"
+#include "SimpleProceduralWalkMass.h"
+#include "Curves/CurveFloat.h"
+
+
+void FSPW_MassGaitSharedFragment::BakeCurveTables()
+{
+	if (!IsValid(Parameters.SpeedCurve) || !IsValid(Parameters.HeightCurve))
+	{
+		UE_LOG(LogSimpleProceduralWalkMass, Error, TEXT("Speed Curve and Height Curve must be set, feet will not move."));
+	}
+
+	// as the walk node: without curves feet do not move
+	if (IsValid(Parameters.SpeedCurve))
+	{
+		SpeedCurveTable.Bake(Parameters.SpeedCurve->FloatCurve);
+	}
+	else
+	{
+		SpeedCurveTable.SetConstant(0.f);
+	}
+
+	if (IsValid(Parameters.HeightCurve))
+	{
+		HeightCurveTable.Bake(Parameters.HeightCurve->FloatCurve);
+	}
+	else
+	{
+		HeightCurveTable.SetConstant(0.f);
+	}
+}
+
+void FSPW_MassGaitFragment::GetGaitState(FSimpleProceduralWalk_GaitState& OutGaitState) const
+{
+	OutGaitState.CurrentGroupIndex = CurrentGroupIndex;
+	OutGaitState.GroupsData.Reset(GroupsData.Num());
+	OutGaitState.GroupsData.Append(GroupsData);
+}
+
+bool FSPW_MassGaitFragment::SetGaitState(const FSimpleProceduralWalk_GaitState& InGaitState)
+{
+	if (InGaitState.GroupsData.Num() != GroupsData.Num() || !GroupsData.IsValidIndex(InGaitState.CurrentGroupIndex))
+	{
+		return false;
+	}
+
+	CurrentGroupIndex = InGaitState.CurrentGroupIndex;
+	for (int32 GroupIndex = 0; GroupIndex < GroupsData.Num(); GroupIndex++)
+	{
+		GroupsData[GroupIndex] = InGaitState.GroupsData[GroupIndex];
+	}
+	return true;
+}
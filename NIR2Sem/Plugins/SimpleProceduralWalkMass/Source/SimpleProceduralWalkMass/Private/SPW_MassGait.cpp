@@ -0,0 +1,182 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#include "SPW_MassGait.h"
+#include "SPW_MassFragments.h"
+#include "SPW_GaitStep.h"
+
+
+namespace SPW_MassGait
+{
+	static void UpdatePawnVariables(const FSPW_MassGaitParameters& Parameters, const FTransform& Transform, const FVector& Velocity, FSPW_MassGaitFragment& Gait)
+	{
+		// rotation
+		const float Yaw = Transform.Rotator().Yaw;
+		const float YawDelta = FRotator::NormalizeAxis(Yaw - Gait.PreviousYaw);
+		Gait.PreviousYaw = Yaw;
+
+		// step, as the walk node (on the entity ground plane, so without slope reduction)
+		const FSPW_GaitStep Step = SPW_Gait::ComputeStep(Velocity
+			, Transform.GetUnitAxis(EAxis::X)
+			, Transform.GetUnitAxis(EAxis::Y)
+			, YawDelta
+			, Parameters.StepDistanceForward
+			, Parameters.StepDistanceRight
+			, 1.f
+			, Parameters.MinStepDuration);
+		Gait.Speed = Step.Speed;
+		Gait.ForwardPercent = Step.ForwardPercent;
+		Gait.RightPercent = Step.RightPercent;
+		Gait.CurrentStepDuration = Step.StepDuration;
+	}
+
+	static void SetFeetTargets(const FSPW_MassGaitParameters& Parameters, const FTransform& Transform, FSPW_MassGaitFragment& Gait)
+	{
+		const FVector StepOffset(Parameters.StepDistanceForward * Gait.ForwardPercent, Parameters.StepDistanceRight * Gait.RightPercent, 0.f);
+
+		for (int32 LegIndex = 0; LegIndex < Gait.Feet.Num(); LegIndex++)
+		{
+			Gait.Feet[LegIndex].Target = Transform.TransformPosition(Parameters.FeetRestLocations[LegIndex] + StepOffset);
+		}
+	}
+
+	static void SetCurrentGroupUnplanted(const FSPW_MassGaitParameters& Parameters, FSPW_MassGaitFragment& Gait)
+	{
+		const TArrayView<FSimpleProceduralWalk_LegGroupData> GroupsData = Gait.GroupsData;
+		int32& CurrentGroupIndex = Gait.CurrentGroupIndex;
+
+		if (GroupsData[CurrentGroupIndex].bIsUnplanted)
+		{
+			return;
+		}
+
+		// is any foot in current group distant enough to unplant?
+		const TArray<int32>& LegIndices = Parameters.LegGroups[CurrentGroupIndex].LegIndices;
+		const bool bIsAtLeastOneFootFarEnough = LegIndices.ContainsByPredicate([&Parameters, &Gait](int32 LegIndex) {
+			return Gait.Feet.IsValidIndex(LegIndex) && FVector::Dist(Gait.Feet[LegIndex].Location, Gait.Feet[LegIndex].Target) >= Parameters.MinDistanceToUnplant;
+		});
+		if (!bIsAtLeastOneFootFarEnough)
+		{
+			return;
+		}
+
+		// is previous group far enough along the step percentage?
+		const int32 PreviousGroupIndex = (CurrentGroupIndex + GroupsData.Num() - 1) % GroupsData.Num();
+		if (GroupsData[PreviousGroupIndex].bIsUnplanted && GroupsData[PreviousGroupIndex].StepPercent < Parameters.StepSequencePercent)
+		{
+			return;
+		}
+
+		GroupsData[CurrentGroupIndex].bIsUnplanted = true;
+		GroupsData[CurrentGroupIndex].StepPercent = 0.f;
+		for (int32 LegIndex : LegIndices)
+		{
+			if (Gait.Feet.IsValidIndex(LegIndex))
+			{
+				Gait.Feet[LegIndex].UnplantLocation = Gait.Feet[LegIndex].Location;
+			}
+		}
+
+		CurrentGroupIndex = (CurrentGroupIndex + 1) % GroupsData.Num();
+	}
+
+	static void ComputeFeet(const FSPW_MassGaitSharedFragment& SharedGait, const FTransform& Transform, float DeltaSeconds, FSPW_MassGaitFragment& Gait)
+	{
+		const FSPW_MassGaitParameters& Parameters = SharedGait.Parameters;
+		const FVector UpVector = Transform.GetUnitAxis(EAxis::Z);
+
+		for (int32 GroupIndex = 0; GroupIndex < Gait.GroupsData.Num(); GroupIndex++)
+		{
+			FSimpleProceduralWalk_LegGroupData& GroupData = Gait.GroupsData[GroupIndex];
+			if (!GroupData.bIsUnplanted)
+			{
+				continue;
+			}
+
+			GroupData.StepPercent = SPW_Gait::AdvanceStepPercent(GroupData.StepPercent, DeltaSeconds, Gait.CurrentStepDuration);
+
+			const float InterpSpeed = SharedGait.SpeedCurveTable.Eval(GroupData.StepPercent);
+			const float RelativeZ = SharedGait.HeightCurveTable.Eval(GroupData.StepPercent) * Parameters.StepHeight;
+
+			for (int32 LegIndex : Parameters.LegGroups[GroupIndex].LegIndices)
+			{
+				if (Gait.Feet.IsValidIndex(LegIndex))
+				{
+					FSPW_MassFoot& Foot = Gait.Feet[LegIndex];
+					Foot.Location = FMath::Lerp(Foot.UnplantLocation, Foot.Target, InterpSpeed) + RelativeZ * UpVector;
+				}
+			}
+
+			// plant
+			if (GroupData.StepPercent == 1.f)
+			{
+				GroupData.bIsUnplanted = false;
+			}
+		}
+	}
+
+	static void ComputeBodyOffset(const FSPW_MassGaitParameters& Parameters, const FTransform& Transform, FSPW_MassGaitFragment& Gait)
+	{
+		if (Gait.Feet.Num() == 0)
+		{
+			return;
+		}
+
+		// bounce with the average feet height
+		const FVector UpVector = Transform.GetUnitAxis(EAxis::Z);
+		float FeetHeightSum = 0.f;
+		for (const FSPW_MassFoot& Foot : Gait.Feet)
+		{
+			FeetHeightSum += FVector::DotProduct(Foot.Location - Foot.Target, UpVector);
+		}
+
+		Gait.BodyZOffset = FeetHeightSum / Gait.Feet.Num() * Parameters.BodyBounceMultiplier;
+	}
+}
+
+void SPW_MassGait::ResetFeet(const FSPW_MassGaitSharedFragment& SharedGait, const FTransform& Transform, FSPW_MassGaitFragment& Gait)
+{
+	const FSPW_MassGaitParameters& Parameters = SharedGait.Parameters;
+
+	Gait.Feet.SetNum(Parameters.FeetRestLocations.Num());
+	for (int32 LegIndex = 0; LegIndex < Gait.Feet.Num(); LegIndex++)
+	{
+		FSPW_MassFoot& Foot = Gait.Feet[LegIndex];
+		Foot.Location = Transform.TransformPosition(Parameters.FeetRestLocations[LegIndex]);
+		Foot.Target = Foot.Location;
+		Foot.UnplantLocation = Foot.Location;
+	}
+
+	// steps in progress continue from where the feet are now
+	if (Gait.GroupsData.Num() != Parameters.LegGroups.Num())
+	{
+		Gait.GroupsData.Reset();
+		Gait.GroupsData.SetNum(Parameters.LegGroups.Num());
+		Gait.CurrentGroupIndex = 0;
+	}
+}
+
+void SPW_MassGait::Advance(const FSPW_MassGaitSharedFragment& SharedGait
+	, const FTransform& Transform
+	, const FVector& Velocity
+	, float DeltaSeconds
+	, FSPW_MassGaitFragment& Gait)
+{
+	const FSPW_MassGaitParameters& Parameters = SharedGait.Parameters;
+
+	if (Parameters.LegGroups.Num() == 0)
+	{
+		return;
+	}
+
+	if (Gait.Feet.Num() != Parameters.FeetRestLocations.Num() || Gait.GroupsData.Num() != Parameters.LegGroups.Num())
+	{
+		ResetFeet(SharedGait, Transform, Gait);
+		Gait.PreviousYaw = Transform.Rotator().Yaw;
+	}
+
+	UpdatePawnVariables(Parameters, Transform, Velocity, Gait);
+	SetFeetTargets(Parameters, Transform, Gait);
+	SetCurrentGroupUnplanted(Parameters, Gait);
+	ComputeFeet(SharedGait, Transform, DeltaSeconds, Gait);
+	ComputeBodyOffset(Parameters, Transform, Gait);
+}
@@ -0,0 +1,133 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#include "SPW_MassGaitProcessors.h"
+#include "SPW_MassFragments.h"
+#include "SPW_MassGait.h"
+#include "SPW_GaitStateComponent.h"
+#include "MassActorSubsystem.h"
+#include "MassCommonFragments.h"
+#include "MassCommonTypes.h"
+#include "MassExecutionContext.h"
+#include "MassMovementFragments.h"
+
+// stats
+DECLARE_CYCLE_STAT(TEXT("Mass Gait"), STAT_SimpleProceduralWalk_MassGait, STATGROUP_SimpleProceduralWalk);
+DECLARE_CYCLE_STAT(TEXT("Mass Gait Actor Sync"), STAT_SimpleProceduralWalk_MassGaitActorSync, STATGROUP_SimpleProceduralWalk);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Mass Gait Entities"), STAT_SimpleProceduralWalk_NumMassGaitEntities, STATGROUP_SimpleProceduralWalk);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Mass Gait Entities Driven By Actors"), STAT_SimpleProceduralWalk_NumMassGaitActorEntities, STATGROUP_SimpleProceduralWalk);
+
+
+// ---------- \/ actor sync ----------
+USPW_MassGaitActorSyncProcessor::USPW_MassGaitActorSyncProcessor()
+	: EntityQuery(*this)
+{
+	ExecutionFlags = (int32)(EProcessorExecutionFlags::Client | EProcessorExecutionFlags::Standalone);
+	ProcessingPhase = EMassProcessingPhase::PrePhysics;
+	ExecutionOrder.ExecuteBefore.Add(USPW_MassGaitProcessor::StaticClass()->GetFName());
+	// actors & components
+	bRequiresGameThreadExecution = true;
+}
+
+void USPW_MassGaitActorSyncProcessor::ConfigureQueries()
+{
+	EntityQuery.AddRequirement<FSPW_MassGaitFragment>(EMassFragmentAccess::ReadWrite);
+	EntityQuery.AddRequirement<FTransformFragment>(EMassFragmentAccess::ReadOnly);
+	EntityQuery.AddRequirement<FMassActorFragment>(EMassFragmentAccess::ReadWrite);
+	EntityQuery.AddConstSharedRequirement<FSPW_MassGaitSharedFragment>();
+}
+
+void USPW_MassGaitActorSyncProcessor::Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context)
+{
+	SCOPE_CYCLE_COUNTER(STAT_SimpleProceduralWalk_MassGaitActorSync);
+
+	EntityQuery.ForEachEntityChunk(EntityManager, Context, [this](FMassExecutionContext& Context) {
+		const FSPW_MassGaitSharedFragment& SharedGait = Context.GetConstSharedFragment<FSPW_MassGaitSharedFragment>();
+		const TConstArrayView<FTransformFragment> TransformList = Context.GetFragmentView<FTransformFragment>();
+		const TArrayView<FSPW_MassGaitFragment> GaitList = Context.GetMutableFragmentView<FSPW_MassGaitFragment>();
+		const TArrayView<FMassActorFragment> ActorList = Context.GetMutableFragmentView<FMassActorFragment>();
+
+		for (int32 EntityIndex = 0; EntityIndex < Context.GetNumEntities(); EntityIndex++)
+		{
+			FSPW_MassGaitFragment& Gait = GaitList[EntityIndex];
+			AActor* Actor = ActorList[EntityIndex].GetMutable();
+			USPW_GaitStateComponent* GaitStateComponent = Actor ? Actor->FindComponentByClass<USPW_GaitStateComponent>() : nullptr;
+
+			if (GaitStateComponent == nullptr)
+			{
+				if (Gait.bIsDrivenByActor)
+				{
+					/* -> demoted: keep the phase, feet are back on the entity */
+					Gait.bIsDrivenByActor = false;
+					SPW_MassGait::ResetFeet(SharedGait, TransformList[EntityIndex].GetTransform(), Gait);
+				}
+				continue;
+			}
+
+			if (!Gait.bIsDrivenByActor)
+			{
+				/* -> promoted: the walk node starts from the entity phase */
+				Gait.bIsDrivenByActor = true;
+				if (Gait.GroupsData.Num() > 0)
+				{
+					Gait.GetGaitState(HandedOverGaitState);
+					GaitStateComponent->HandOverGaitState(HandedOverGaitState);
+				}
+			}
+			else
+			{
+				/* -> follow the walk node */
+				Gait.SetGaitState(GaitStateComponent->GetGaitState());
+			}
+
+			INC_DWORD_STAT(STAT_SimpleProceduralWalk_NumMassGaitActorEntities);
+		}
+	});
+}
+
+// ---------- \/ gait ----------
+USPW_MassGaitProcessor::USPW_MassGaitProcessor()
+	: EntityQuery(*this)
+{
+	ExecutionFlags = (int32)(EProcessorExecutionFlags::Client | EProcessorExecutionFlags::Standalone);
+	ProcessingPhase = EMassProcessingPhase::PrePhysics;
+	ExecutionOrder.ExecuteInGroup = UE::Mass::ProcessorGroupNames::Tasks;
+}
+
+void USPW_MassGaitProcessor::ConfigureQueries()
+{
+	EntityQuery.AddRequirement<FSPW_MassGaitFragment>(EMassFragmentAccess::ReadWrite);
+	EntityQuery.AddRequirement<FTransformFragment>(EMassFragmentAccess::ReadOnly);
+	EntityQuery.AddRequirement<FMassVelocityFragment>(EMassFragmentAccess::ReadOnly);
+	EntityQuery.AddConstSharedRequirement<FSPW_MassGaitSharedFragment>();
+}
+
+void USPW_MassGaitProcessor::Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context)
+{
+	SCOPE_CYCLE_COUNTER(STAT_SimpleProceduralWalk_MassGait);
+
+	EntityQuery.ForEachEntityChunk(EntityManager, Context, [](FMassExecutionContext& Context) {
+		const float DeltaSeconds = Context.GetDeltaTimeSeconds();
+		const FSPW_MassGaitSharedFragment& SharedGait = Context.GetConstSharedFragment<FSPW_MassGaitSharedFragment>();
+		const TConstArrayView<FTransformFragment> TransformList = Context.GetFragmentView<FTransformFragment>();
+		const TConstArrayView<FMassVelocityFragment> VelocityList = Context.GetFragmentView<FMassVelocityFragment>();
+		const TArrayView<FSPW_MassGaitFragment> GaitList = Context.GetMutableFragmentView<FSPW_MassGaitFragment>();
+
+		if (SharedGait.Parameters.LegGroups.Num() == 0 || DeltaSeconds <= 0.f)
+		{
+			return;
+		}
+
+		for (int32 EntityIndex = 0; EntityIndex < Context.GetNumEntities(); EntityIndex++)
+		{
+			FSPW_MassGaitFragment& Gait = GaitList[EntityIndex];
+			if (Gait.bIsDrivenByActor)
+			{
+				continue;
+			}
+
+			SPW_MassGait::Advance(SharedGait, TransformList[EntityIndex].GetTransform(), VelocityList[EntityIndex].Value, DeltaSeconds, Gait);
+		}
+
+		INC_DWORD_STAT_BY(STAT_SimpleProceduralWalk_NumMassGaitEntities, Context.GetNumEntities());
+	});
+}
@@ -0,0 +1,25 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#include "SPW_MassGaitTrait.h"
+#include "MassCommonFragments.h"
+#include "MassEntityTemplateRegistry.h"
+#include "MassEntityUtils.h"
+#include "MassMovementFragments.h"
+
+
+void USPW_MassGaitTrait::BuildTemplate(FMassEntityTemplateBuildContext& BuildContext, const UWorld& World) const
+{
+	FMassEntityManager& EntityManager = UE::Mass::Utils::GetEntityManagerChecked(World);
+
+	BuildContext.AddFragment<FTransformFragment>();
+	BuildContext.AddFragment<FMassVelocityFragment>();
+	BuildContext.AddFragment<FSPW_MassGaitFragment>();
+
+	// one shared fragment per gait set up
+	FSPW_MassGaitSharedFragment SharedFragment;
+	SharedFragment.Parameters = Gait;
+	SharedFragment.BakeCurveTables();
+
+	const uint32 ParametersHash = UE::StructUtils::GetStructCrc32(FConstStructView::Make(Gait));
+	BuildContext.AddConstSharedFragment(EntityManager.GetOrCreateConstSharedFragment(ParametersHash, SharedFragment));
+}
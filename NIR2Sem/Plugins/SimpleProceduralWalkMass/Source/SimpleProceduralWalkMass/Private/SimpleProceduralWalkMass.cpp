@@ -0,0 +1,23 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#include "SimpleProceduralWalkMass.h"
+
+// log
+DEFINE_LOG_CATEGORY(LogSimpleProceduralWalkMass);
+
+#define LOCTEXT_NAMESPACE "FSimpleProceduralWalkMass"
+
+void FSimpleProceduralWalkMass::StartupModule()
+{
+	// This code will execute after your module is loaded into memory; the exact timing is specified in the .uplugin file per-module
+}
+
+void FSimpleProceduralWalkMass::ShutdownModule()
+{
+	// This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
+	// we call this function before unloading the module.
+}
+
+#undef LOCTEXT_NAMESPACE
+
+IMPLEMENT_MODULE(FSimpleProceduralWalkMass, SimpleProceduralWalkMass)
@@ -0,0 +1,78 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+#include "SPW_MassFragments.h"
+#include "SPW_MassGait.h"
+#include "Curves/RichCurve.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSPW_MassGaitManyLegsTest, "SimpleProceduralWalk.Mass.Gait.ManyLegs", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FSPW_MassGaitManyLegsTest::RunTest(const FString& Parameters)
+{
+	static const int32 NUM_FEET = 40;
+	static const float SPEED = 100.f;
+	static const float DELTA_SECONDS = 1.f / 60.f;
+	static const int32 NUM_FRAMES = 600;
+
+	/* -> centipede: pairs of feet, stepping as a wave from head to tail */
+	FSPW_MassGaitSharedFragment SharedGait;
+	SharedGait.Parameters.StepDistanceForward = 30.f;
+	SharedGait.Parameters.StepSequencePercent = .2f;
+	for (int32 PairIndex = 0; PairIndex < NUM_FEET / 2; PairIndex++)
+	{
+		const int32 LeftLegIndex = SharedGait.Parameters.FeetRestLocations.Add(FVector(-10.f * PairIndex, -20.f, 0.f));
+		const int32 RightLegIndex = SharedGait.Parameters.FeetRestLocations.Add(FVector(-10.f * PairIndex, 20.f, 0.f));
+
+		FSimpleProceduralWalk_LegGroup& LegGroup = SharedGait.Parameters.LegGroups.AddDefaulted_GetRef();
+		LegGroup.LegIndices.Add(LeftLegIndex);
+		LegGroup.LegIndices.Add(RightLegIndex);
+	}
+
+	FRichCurve SpeedCurve;
+	SpeedCurve.AddKey(0.f, 0.f);
+	SpeedCurve.AddKey(1.f, 1.f);
+	SharedGait.SpeedCurveTable.Bake(SpeedCurve);
+
+	FRichCurve HeightCurve;
+	HeightCurve.AddKey(0.f, 0.f);
+	HeightCurve.AddKey(.5f, 1.f);
+	HeightCurve.AddKey(1.f, 0.f);
+	SharedGait.HeightCurveTable.Bake(HeightCurve);
+
+	/* -> walk forward */
+	FSPW_MassGaitFragment Gait;
+	FTransform Transform = FTransform::Identity;
+	const FVector Velocity(SPEED, 0.f, 0.f);
+
+	SPW_MassGait::ResetFeet(SharedGait, Transform, Gait);
+	TArray<FVector> InitialFeetLocations;
+	for (const FSPW_MassFoot& Foot : Gait.Feet)
+	{
+		InitialFeetLocations.Add(Foot.Location);
+	}
+
+	for (int32 FrameIndex = 0; FrameIndex < NUM_FRAMES; FrameIndex++)
+	{
+		Transform.AddToTranslation(Velocity * DELTA_SECONDS);
+		SPW_MassGait::Advance(SharedGait, Transform, Velocity, DELTA_SECONDS, Gait);
+	}
+
+	/* -> every foot followed the body */
+	if (!TestEqual(TEXT("Number of feet"), Gait.Feet.Num(), NUM_FEET))
+	{
+		return false;
+	}
+
+	const float MinFootDistance = .5f * SPEED * DELTA_SECONDS * NUM_FRAMES;
+	for (int32 LegIndex = 0; LegIndex < NUM_FEET; LegIndex++)
+	{
+		const float FootDistance = Gait.Feet[LegIndex].Location.X - InitialFeetLocations[LegIndex].X;
+		TestTrue(FString::Printf(TEXT("Foot %d moved %f, at least %f"), LegIndex, FootDistance, MinFootDistance), FootDistance >= MinFootDistance);
+	}
+
+	return true;
+}
+
+#endif
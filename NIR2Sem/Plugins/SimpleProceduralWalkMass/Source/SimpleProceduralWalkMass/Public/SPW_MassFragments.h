@@ -0,0 +1,131 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassEntityTypes.h"
+#include "SPW.h"
+#include "SPW_CurveTable.h"
+#include "SPW_MassFragments.generated.h"
+
+class UCurveFloat;
+
+
+/** The gait set up of a creature, shared by all the entities of that creature. */
+USTRUCT()
+struct SIMPLEPROCEDURALWALKMASS_API FSPW_MassGaitParameters
+{
+	GENERATED_USTRUCT_BODY()
+
+public:
+	/** The location of each foot at rest, relative to the entity (X forward, Z up). */
+	UPROPERTY(EditAnywhere, Category = "Skeletal Control")
+		TArray<FVector> FeetRestLocations;
+
+	/** Defines the leg groups, with indices in FeetRestLocations (the legs in a group will unplant at the same time). */
+	UPROPERTY(EditAnywhere, Category = "Walk Cycle")
+		TArray<FSimpleProceduralWalk_LegGroup> LegGroups;
+
+	/** How hight should the step be above the ground. */
+	UPROPERTY(EditAnywhere, Category = "Walk Cycle", meta = (ClampMin = "0.0"))
+		float StepHeight = 20.f;
+
+	/** How far should the step move forward (and backwards) */
+	UPROPERTY(EditAnywhere, Category = "Walk Cycle", meta = (ClampMin = "0.0"))
+		float StepDistanceForward = 50.f;
+
+	/** How far should the step move sideways */
+	UPROPERTY(EditAnywhere, Category = "Walk Cycle", meta = (ClampMin = "0.0"))
+		float StepDistanceRight = 30.f;
+
+	/** Defines at which percentage of a step the next group of legs will unplant. */
+	UPROPERTY(EditAnywhere, Category = "Walk Cycle", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+		float StepSequencePercent = 1.f;
+
+	/** The minimum step duration (steps should never take less than this amount of time). */
+	UPROPERTY(EditAnywhere, AdvancedDisplay, Category = "Walk Cycle", meta = (ClampMin = "0.0"))
+		float MinStepDuration = .15f;
+
+	/** How far should the foot desired position be from the foot before a step is taken. */
+	UPROPERTY(EditAnywhere, AdvancedDisplay, Category = "Walk Cycle", meta = (ClampMin = "0.0"))
+		float MinDistanceToUnplant = 5.f;
+
+	/** The curve that defines the foot acceleration evolution during a step. */
+	UPROPERTY(EditAnywhere, AdvancedDisplay, Category = "Walk Cycle")
+		UCurveFloat* SpeedCurve = nullptr;
+
+	/** The curve that defines the foot height evolution during a step. */
+	UPROPERTY(EditAnywhere, AdvancedDisplay, Category = "Walk Cycle")
+		UCurveFloat* HeightCurve = nullptr;
+
+	/** How much should the body bounce up and down while walking (0 disables it). */
+	UPROPERTY(EditAnywhere, Category = "Body Location", meta = (ClampMin = "0.0"))
+		float BodyBounceMultiplier = .5f;
+};
+
+/** Gait parameters, with the step curves baked so that processors never touch the curve assets. */
+USTRUCT()
+struct SIMPLEPROCEDURALWALKMASS_API FSPW_MassGaitSharedFragment : public FMassSharedFragment
+{
+	GENERATED_USTRUCT_BODY()
+
+public:
+	UPROPERTY()
+		FSPW_MassGaitParameters Parameters;
+
+	FSPW_CurveTable SpeedCurveTable;
+	FSPW_CurveTable HeightCurveTable;
+
+	void BakeCurveTables();
+};
+
+USTRUCT()
+struct SIMPLEPROCEDURALWALKMASS_API FSPW_MassFoot
+{
+	GENERATED_USTRUCT_BODY()
+
+public:
+	FVector Location = FVector(0.f);
+	FVector Target = FVector(0.f);
+	FVector UnplantLocation = FVector(0.f);
+};
+
+/**
+ * The gait state of an entity: what FAnimNode_SPW computes before solving the skeleton.
+ * Feet & groups are sized from the shared fragment; most creatures fit inline, many-legged ones spill to the heap.
+ */
+USTRUCT()
+struct SIMPLEPROCEDURALWALKMASS_API FSPW_MassGaitFragment : public FMassFragment
+{
+	GENERATED_USTRUCT_BODY()
+
+public:
+	static constexpr int32 NumInlineFeet = 8;
+	static constexpr int32 NumInlineGroups = 4;
+
+	// pawn
+	float Speed = 0.f;
+	float ForwardPercent = 0.f;
+	float RightPercent = 0.f;
+	float PreviousYaw = 0.f;
+	float CurrentStepDuration = 0.f;
+
+	// feet, in world space
+	TArray<FSPW_MassFoot, TInlineAllocator<NumInlineFeet>> Feet;
+
+	// groups
+	TArray<FSimpleProceduralWalk_LegGroupData, TInlineAllocator<NumInlineGroups>> GroupsData;
+	int32 CurrentGroupIndex = 0;
+
+	// body offset along the entity up axis
+	float BodyZOffset = 0.f;
+
+	// has the entity been promoted to an actor, whose walk node owns the gait?
+	bool bIsDrivenByActor = false;
+
+	/** Copies the groups phase, to hand it over to the walk node. */
+	void GetGaitState(FSimpleProceduralWalk_GaitState& OutGaitState) const;
+
+	/** Continues from the groups phase of the walk node, returns false when its groups do not match. */
+	bool SetGaitState(const FSimpleProceduralWalk_GaitState& InGaitState);
+};
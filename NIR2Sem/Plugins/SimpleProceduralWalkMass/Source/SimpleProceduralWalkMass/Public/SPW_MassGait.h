@@ -0,0 +1,26 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FSPW_MassGaitSharedFragment;
+struct FSPW_MassGaitFragment;
+
+
+/**
+ * The gait of an entity, as computed by FAnimNode_SPW before solving the skeleton.
+ * Feet & groups of the entity are sized from the shared fragment, so creatures can have any number of legs.
+ */
+namespace SPW_MassGait
+{
+	/** Places the feet at rest and sizes them from the shared fragment. The phase is kept, unless the groups changed. */
+	SIMPLEPROCEDURALWALKMASS_API void ResetFeet(const FSPW_MassGaitSharedFragment& SharedGait, const FTransform& Transform, FSPW_MassGaitFragment& Gait);
+
+	/** Advances the gait of an entity by a frame: pawn variables, feet targets, steps phases & body offset. */
+	SIMPLEPROCEDURALWALKMASS_API void Advance(const FSPW_MassGaitSharedFragment& SharedGait
+		, const FTransform& Transform
+		, const FVector& Velocity
+		, float DeltaSeconds
+		, FSPW_MassGaitFragment& Gait);
+}
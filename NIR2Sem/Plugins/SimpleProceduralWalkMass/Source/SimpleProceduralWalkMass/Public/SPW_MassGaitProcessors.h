@@ -0,0 +1,52 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassProcessor.h"
+#include "SPW.h"
+#include "SPW_MassGaitProcessors.generated.h"
+
+
+/**
+ * Hands the gait over between entities and their actors, on the game thread.
+ * Promoted entities pass their phase to the actor walk node, then follow it until they are demoted.
+ */
+UCLASS()
+class SIMPLEPROCEDURALWALKMASS_API USPW_MassGaitActorSyncProcessor : public UMassProcessor
+{
+	GENERATED_BODY()
+
+public:
+	USPW_MassGaitActorSyncProcessor();
+
+protected:
+	virtual void ConfigureQueries() override;
+	virtual void Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context) override;
+
+private:
+	FMassEntityQuery EntityQuery;
+
+	// reused to hand the phase over
+	FSimpleProceduralWalk_GaitState HandedOverGaitState;
+};
+
+/**
+ * Advances the gait of the entities that are not driven by an actor: pawn variables, feet targets, steps phases & body offset.
+ * Mirrors the computations of FAnimNode_SPW, without traces (feet are placed on the entity ground plane) nor IK.
+ */
+UCLASS()
+class SIMPLEPROCEDURALWALKMASS_API USPW_MassGaitProcessor : public UMassProcessor
+{
+	GENERATED_BODY()
+
+public:
+	USPW_MassGaitProcessor();
+
+protected:
+	virtual void ConfigureQueries() override;
+	virtual void Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context) override;
+
+private:
+	FMassEntityQuery EntityQuery;
+};
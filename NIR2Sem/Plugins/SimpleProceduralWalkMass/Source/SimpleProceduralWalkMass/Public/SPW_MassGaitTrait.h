@@ -0,0 +1,27 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassEntityTraitBase.h"
+#include "SPW_MassFragments.h"
+#include "SPW_MassGaitTrait.generated.h"
+
+
+/**
+ * Procedural walk of a crowd of creatures, without skeletons: step phases, feet and body offset are simulated per entity.
+ * Pair it with a representation trait that spawns the creature actor when close enough (the actor needs a USPW_GaitStateComponent):
+ * the walk node of the actor then continues the gait of the entity, and the entity continues the gait of the actor once demoted.
+ */
+UCLASS(meta = (DisplayName = "Simple Procedural Walk"))
+class SIMPLEPROCEDURALWALKMASS_API USPW_MassGaitTrait : public UMassEntityTraitBase
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, Category = "Gait")
+		FSPW_MassGaitParameters Gait;
+
+protected:
+	virtual void BuildTemplate(FMassEntityTemplateBuildContext& BuildContext, const UWorld& World) const override;
+};
@@ -0,0 +1,57 @@
+// Copyright Roberto Ostinelli, 2021. All Rights Reserved.
+
+using UnrealBuildTool;
+
+public class SimpleProceduralWalkMass : ModuleRules
+{
+	public SimpleProceduralWalkMass(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PCHUsage = ModuleRules.PCHUsageMode.UseExplicitOrSharedPCHs;
+
+		PublicIncludePaths.AddRange(
+			new string[] {
+				// ... add public include paths required here ...
+			}
+			);
+
+
+		PrivateIncludePaths.AddRange(
+			new string[] {
+				// ... add other private include paths required here ...
+			}
+			);
+
+
+		PublicDependencyModuleNames.AddRange(
+			new string[]
+			{
+				"Core",
+				"CoreUObject",
+				"Engine",
+				"MassEntity",
+				"MassCommon",
+				"MassMovement",
+				"MassActors",
+				"MassSpawner",
+				"StructUtils",
+				"SimpleProceduralWalk",
+			}
+			);
+
+
+		PrivateDependencyModuleNames.AddRange(
+			new string[]
+			{
+				// ... add private dependencies that you statically link with here ...
+			}
+			);
+
+
+		DynamicallyLoadedModuleNames.AddRange(
+			new string[]
+			{
+				// ... add any modules that your module loads dynamically here ...
+			}
+			);
+	}
+}